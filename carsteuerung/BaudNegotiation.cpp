@@ -0,0 +1,285 @@
+#include "BaudNegotiation.h"
+
+#include "FrameSender.h"
+#include "SerialTransport.h"
+
+#include <algorithm>
+
+namespace
+{
+
+const size_t probeCount = 16;
+const unsigned maxCommitAttempts = 3;
+
+const BaudNegotiation::Clock::duration proposeTimeout = std::chrono::milliseconds(500);
+const BaudNegotiation::Clock::duration settleTime = std::chrono::milliseconds(20);
+const BaudNegotiation::Clock::duration echoTimeout = std::chrono::milliseconds(200);
+
+//BAUD_COMMIT_TIMEOUT of the MC with some margin
+const BaudNegotiation::Clock::duration fallbackTime = std::chrono::milliseconds(1500);
+
+//the MC sends its status several times per second
+const BaudNegotiation::Clock::duration silenceTimeout = std::chrono::seconds(3);
+
+}
+
+BaudNegotiation::BaudNegotiation(SerialTransport& transport, FrameSender& sender)
+	: m_transport(transport)
+	, m_sender(sender)
+{
+}
+
+std::vector<uint32_t> BaudNegotiation::getSupportedBaudRates()
+{
+	//the 24 MHz bus clock of the MC / 16 / an integer prescaler, the tty sets them through BOTHER
+	return { 115200, 250000, 500000, 1500000 };
+}
+
+void BaudNegotiation::start(uint32_t maxBaudRate, Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (m_state != State::Idle)
+		return;
+
+	m_candidates.clear();
+	for (uint32_t baudRate : getSupportedBaudRates())
+	{
+		if (baudRate > m_baudRate && baudRate <= maxBaudRate)
+		{
+			m_candidates.push_back(baudRate);
+		}
+	}
+	if (m_candidates.empty())
+		return;
+
+	m_sender.pause();
+	proposeNext(now);
+}
+
+void BaudNegotiation::reset()
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (m_state != State::Idle)
+	{
+		m_sender.resume();
+	}
+	m_state = State::Idle;
+	m_baudRate = defaultBaudRate;
+}
+
+void BaudNegotiation::receive(const RequestDataPacket<BaudAcceptPayload>& data, Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (m_state != State::Proposing || !data.checksumIsOk || data.payload.baudRate() != m_proposedBaudRate)
+		return;
+
+	if (!data.payload.accepted)
+	{
+		proposeNext(now);
+		return;
+	}
+
+	//the Accept was the last frame at the old rate
+	if (!m_transport.setBaudRate(m_proposedBaudRate))
+	{
+		revert(now);
+		return;
+	}
+	m_state = State::Settling;
+	m_deadline = now + settleTime;
+}
+
+void BaudNegotiation::receive(const RequestDataPacket<BaudProbePayload>& data, Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (m_state != State::Probing || !data.checksumIsOk || data.payload.seq >= m_echoedProbes.size())
+		return;
+
+	for (size_t i = 0; i < sizeof(data.payload.pattern); ++i)
+	{
+		if (data.payload.pattern[i] != getProbePattern(data.payload.seq, i))
+			return;
+	}
+
+	m_echoedProbes[data.payload.seq] = true;
+	if (std::find(m_echoedProbes.begin(), m_echoedProbes.end(), false) == m_echoedProbes.end())
+	{
+		m_commitAttempts = 0;
+		sendCommit(now);
+	}
+}
+
+void BaudNegotiation::receive(const RequestDataPacket<BaudCommitPayload>& data, Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (m_state != State::Committing || !data.checksumIsOk || data.payload.baudRate() != m_proposedBaudRate)
+		return;
+
+	m_baudRate = m_proposedBaudRate;
+	m_lastValidFrame = now;
+	finish();
+}
+
+void BaudNegotiation::countFrame(bool checksumIsOk, Clock::time_point now)
+{
+	if (!checksumIsOk)
+		return;
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_lastValidFrame = now;
+}
+
+BaudNegotiation::Clock::time_point BaudNegotiation::poll(Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	switch (m_state)
+	{
+	case State::Idle:
+		if (m_baudRate != defaultBaudRate)
+		{
+			if (now - m_lastValidFrame >= silenceTimeout)
+			{
+				m_transport.setBaudRate(defaultBaudRate);
+				m_baudRate = defaultBaudRate;
+				return Clock::time_point::max();
+			}
+			return m_lastValidFrame + silenceTimeout;
+		}
+		return Clock::time_point::max();
+
+	case State::Proposing:
+		//the Accept may have been lost after the MC switched
+		if (now >= m_deadline)
+		{
+			revert(now);
+		}
+		break;
+
+	case State::Settling:
+		if (now >= m_deadline)
+		{
+			sendProbes(now);
+		}
+		break;
+
+	case State::Probing:
+		if (now >= m_deadline)
+		{
+			revert(now);
+		}
+		break;
+
+	case State::Committing:
+		if (now >= m_deadline)
+		{
+			if (m_commitAttempts < maxCommitAttempts)
+			{
+				sendCommit(now);
+			}
+			else
+			{
+				revert(now);
+			}
+		}
+		break;
+
+	case State::Reverting:
+		if (now >= m_deadline)
+		{
+			proposeNext(now);
+		}
+		break;
+	}
+	return m_state == State::Idle ? Clock::time_point::max() : m_deadline;
+}
+
+uint32_t BaudNegotiation::getBaudRate() const
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_baudRate;
+}
+
+bool BaudNegotiation::isNegotiating() const
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_state != State::Idle;
+}
+
+void BaudNegotiation::proposeNext(Clock::time_point now)
+{
+	if (m_candidates.empty())
+	{
+		finish();
+		return;
+	}
+
+	m_proposedBaudRate = m_candidates.back();
+	m_candidates.pop_back();
+
+	BaudProposePayload payload;
+	payload.setBaudRate(m_proposedBaudRate);
+	write(encodeFrame(RequestDataPacket<BaudProposePayload>(payload)));
+
+	m_state = State::Proposing;
+	m_deadline = now + proposeTimeout;
+}
+
+void BaudNegotiation::sendProbes(Clock::time_point now)
+{
+	m_echoedProbes.assign(probeCount, false);
+	for (size_t seq = 0; seq < probeCount; ++seq)
+	{
+		BaudProbePayload payload;
+		payload.seq = uint8_t(seq);
+		for (size_t i = 0; i < sizeof(payload.pattern); ++i)
+		{
+			payload.pattern[i] = getProbePattern(payload.seq, i);
+		}
+		write(encodeFrame(RequestDataPacket<BaudProbePayload>(payload)));
+	}
+
+	//the burst goes out and comes back at 10 bits per byte
+	const std::chrono::microseconds burstTime(probeCount * getMaxCobsFrameSize() * 10 * 1000000 / m_proposedBaudRate);
+	m_state = State::Probing;
+	m_deadline = now + 2 * burstTime + echoTimeout;
+}
+
+void BaudNegotiation::sendCommit(Clock::time_point now)
+{
+	BaudCommitPayload payload = {};
+	payload.setBaudRate(m_proposedBaudRate);
+	write(encodeFrame(RequestDataPacket<BaudCommitPayload>(payload)));
+
+	++m_commitAttempts;
+	m_state = State::Committing;
+	m_deadline = now + echoTimeout;
+}
+
+void BaudNegotiation::revert(Clock::time_point now)
+{
+	//the MC returns to the old rate when the Commit does not come
+	m_transport.setBaudRate(m_baudRate);
+	m_state = State::Reverting;
+	m_deadline = now + fallbackTime;
+}
+
+void BaudNegotiation::finish()
+{
+	m_state = State::Idle;
+	m_sender.resume();
+}
+
+void BaudNegotiation::write(const Frame& frame)
+{
+	//the sender is paused, the transport is ours
+	uint8_t wireFrame[getMaxCobsFrameSize()];
+	m_transport.write(wireFrame, encodeWireFrame(m_sender.getFraming(), frame, wireFrame));
+}
+
+uint8_t BaudNegotiation::getProbePattern(uint8_t seq, size_t index)
+{
+	//alternating bits, long runs of the same bit and their transitions are the first to break at a wrong rate
+	static const uint8_t patterns[] = { 0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x33, 0xCC, 0x01, 0x80 };
+	return uint8_t(patterns[(index + seq) % sizeof(patterns)] ^ (seq & 0x10 ? 0xFF : 0));
+}
@@ -0,0 +1,111 @@
+#ifndef BAUDNEGOTIATION_H
+#define BAUDNEGOTIATION_H
+
+#include "FrameCodec.h"
+
+#include <boost/thread/mutex.hpp>
+
+#include <chrono>
+#include <vector>
+
+class FrameSender;
+class SerialTransport;
+
+/**
+Switches the link to a faster rate at runtime, the host side of baudNegotiation.c of the firmware.
+
+The host proposes a rate and holds back everything else, so the Propose is the last frame at the old rate.
+The MC accepts and switches right after its Accept, which is the last frame at the old rate in the other
+direction. At the new rate the host sends a burst of probes and commits only if every probe came back intact.
+Otherwise it returns to the old rate and waits until the MC has given up on the Commit, then tries the next
+slower rate.
+
+After a switch, the host falls back to the default rate on its own if nothing valid arrives for a while
+(e.g. the MC was reset), the MC does the same when it sees framing errors.
+
+start() may be called from any thread, receive(), countFrame() and poll() are expected from the receive thread.
+*/
+class BaudNegotiation
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	enum { defaultBaudRate = 115200 };
+
+	BaudNegotiation(SerialTransport& transport, FrameSender& sender);
+
+	BaudNegotiation(const BaudNegotiation&) = delete;
+	BaudNegotiation& operator =(const BaudNegotiation&) = delete;
+
+	/**
+	The rates the MC supports, from baudNegotiation.c
+	*/
+	static std::vector<uint32_t> getSupportedBaudRates();
+
+	/**
+	Tries the supported rates up to maxBaudRate, fastest first. Does nothing while a negotiation is running.
+	*/
+	void start(uint32_t maxBaudRate, Clock::time_point now = Clock::now());
+
+	/**
+	Forgets the negotiated rate, for a port that has just been opened at defaultBaudRate
+	*/
+	void reset();
+
+	void receive(const RequestDataPacket<BaudAcceptPayload>& data, Clock::time_point now = Clock::now());
+	void receive(const RequestDataPacket<BaudProbePayload>& data, Clock::time_point now = Clock::now());
+	void receive(const RequestDataPacket<BaudCommitPayload>& data, Clock::time_point now = Clock::now());
+
+	/**
+	Every frame received, a link that stays silent at a negotiated rate is given up
+	*/
+	void countFrame(bool checksumIsOk, Clock::time_point now = Clock::now());
+
+	/**
+	Handles the timeouts
+	@returns when poll() has to be called again at the latest
+	*/
+	Clock::time_point poll(Clock::time_point now = Clock::now());
+
+	uint32_t getBaudRate() const;
+	bool isNegotiating() const;
+
+private:
+	enum class State
+	{
+		Idle,
+		Proposing,		///< waiting for the Accept
+		Settling,		///< both sides switched, the tty may still deliver bytes of the old rate
+		Probing,		///< waiting for the echoes
+		Committing,		///< waiting for the echo of the Commit
+		Reverting		///< back at the old rate, waiting for the MC to get there as well
+	};
+
+	void proposeNext(Clock::time_point now);
+	void sendProbes(Clock::time_point now);
+	void sendCommit(Clock::time_point now);
+	void revert(Clock::time_point now);
+	void finish();
+	void write(const Frame& frame);
+
+	static uint8_t getProbePattern(uint8_t seq, size_t index);
+
+private:
+	SerialTransport& m_transport;
+	FrameSender& m_sender;
+
+	mutable boost::mutex m_mutex;
+
+	uint32_t m_baudRate = defaultBaudRate;
+	State m_state = State::Idle;
+	Clock::time_point m_deadline;
+
+	std::vector<uint32_t> m_candidates;	///< still to try, fastest last
+	uint32_t m_proposedBaudRate = 0;
+	std::vector<bool> m_echoedProbes;
+	unsigned m_commitAttempts = 0;
+
+	Clock::time_point m_lastValidFrame;
+};
+
+#endif // BAUDNEGOTIATION_H
@@ -0,0 +1,60 @@
+#ifndef BYTESPAN_H
+#define BYTESPAN_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+Non-owning view onto a contiguous range of bytes.
+Stands in for std::span<const uint8_t>, which the toolchain used for this project does not provide.
+*/
+class ConstByteSpan
+{
+public:
+	ConstByteSpan()
+	{ }
+
+	ConstByteSpan(const uint8_t* pData, size_t size)
+		: m_pData(pData)
+		, m_size(size)
+	{ }
+
+	template <size_t N>
+	ConstByteSpan(const std::array<uint8_t, N>& data)
+		: m_pData(data.data())
+		, m_size(N)
+	{ }
+
+	ConstByteSpan(const std::vector<uint8_t>& data)
+		: m_pData(data.data())
+		, m_size(data.size())
+	{ }
+
+	const uint8_t* data() const { return m_pData; }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+
+	const uint8_t* begin() const { return m_pData; }
+	const uint8_t* end() const { return m_pData + m_size; }
+
+	uint8_t operator [](size_t index) const
+	{
+		assert(index < m_size);
+		return m_pData[index];
+	}
+
+	ConstByteSpan subspan(size_t offset, size_t count) const
+	{
+		assert(offset + count <= m_size);
+		return ConstByteSpan(m_pData + offset, count);
+	}
+
+private:
+	const uint8_t* m_pData = nullptr;
+	size_t m_size = 0;
+};
+
+#endif // BYTESPAN_H
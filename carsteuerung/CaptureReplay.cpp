@@ -0,0 +1,104 @@
+#include "CaptureReplay.h"
+
+#include "TelemetryReader.h"
+
+#include <boost/thread.hpp>
+
+#include <chrono>
+
+CaptureReplay::CaptureReplay(const HostCommandDispatcher& dispatcher)
+	: m_dispatcher(dispatcher)
+{
+}
+
+CaptureReplay::Report CaptureReplay::run(const TelemetryReader& reader, Mode mode, double speed)
+{
+	Report report;
+	if (reader.getRecordCount() == 0)
+		return report;
+
+	FrameParser parser(HostCommandDispatcher::getKnownCommands());
+	m_expectedBegin = 0;
+	m_expectedEnd = 0;
+
+	const double timeScale = mode == Mode::Scaled ? 1 / speed : 1;
+	const uint64_t firstTimestamp = reader.getRecord(0).timestamp;
+	const auto start = std::chrono::steady_clock::now();
+
+	for (size_t recordNo = 0; recordNo < reader.getRecordCount(); ++recordNo)
+	{
+		boost::this_thread::interruption_point();
+
+		const TelemetryRecord& record = reader.getRecord(recordNo);
+		if (record.direction != TelemetryDirection::Rx)
+		{
+			++report.txRecords;
+			continue;
+		}
+		++report.rxRecords;
+
+		if (mode != Mode::AsFastAsPossible && record.timestamp > firstTimestamp)
+		{
+			const auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+						std::chrono::duration<double, std::nano>((record.timestamp - firstTimestamp) * timeScale));
+			const auto now = std::chrono::steady_clock::now();
+			if (due > now)
+			{
+				boost::this_thread::sleep(boost::posix_time::microseconds(std::chrono::duration_cast<std::chrono::microseconds>(due - now).count()));
+			}
+		}
+
+		if (m_expectedEnd - m_expectedBegin == m_expectedFrames.size())
+		{
+			//the parser swallowed a whole lot of frames
+			++m_expectedBegin;
+			++report.divergentFrames;
+		}
+		std::copy(std::begin(record.frame), std::end(record.frame), m_expectedFrames[m_expectedEnd++ % m_expectedFrames.size()].begin());
+
+		parser.feed(record.frame, sizeof(record.frame));
+
+		Frame frame;
+		bool checksumIsOk;
+		while (parser.nextFrame(frame, checksumIsOk))
+		{
+			compareWithRecorded(frame, report);
+			if (!checksumIsOk)
+			{
+				++report.checksumFailures;
+				continue;
+			}
+
+			const auto dispatchStart = std::chrono::steady_clock::now();
+			m_dispatcher.dispatch(frame);
+			const auto dispatchStop = std::chrono::steady_clock::now();
+
+			CommandStatistics& statistics = report.commands[getFrameCommand(frame)];
+			++statistics.frames;
+			statistics.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(dispatchStop - dispatchStart).count();
+			++report.dispatchedFrames;
+		}
+	}
+
+	report.divergentFrames += m_expectedEnd - m_expectedBegin;
+	report.resyncEvents = parser.getResyncEvents();
+	report.discardedBytes = parser.getDiscardedBytes();
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return report;
+}
+
+void CaptureReplay::compareWithRecorded(const Frame& frame, Report& report)
+{
+	while (m_expectedBegin != m_expectedEnd)
+	{
+		const Frame& expected = m_expectedFrames[m_expectedBegin++ % m_expectedFrames.size()];
+		if (expected == frame)
+			return;
+
+		//recorded, but the parser did not deliver it
+		++report.divergentFrames;
+	}
+
+	//delivered, but never recorded like that
+	++report.divergentFrames;
+}
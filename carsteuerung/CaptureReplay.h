@@ -0,0 +1,69 @@
+#ifndef CAPTUREREPLAY_H
+#define CAPTUREREPLAY_H
+
+#include "CommandDispatcher.h"
+#include "FrameParser.h"
+
+#include <array>
+#include <cstdint>
+
+class TelemetryReader;
+
+/**
+Feeds the received frames of a capture through a FrameParser into a dispatcher, the way the receive thread does.
+
+Frames recorded as sent by the host are skipped, as are frames with a bad checksum, which are counted only.
+Replay runs in real time, scaled in time by speed, or as fast as possible.
+Frames the parser delivers differently from how they were recorded are counted as divergent.
+Interruptible by boost::thread::interrupt().
+*/
+class CaptureReplay
+{
+public:
+	enum class Mode
+	{
+		RealTime,
+		Scaled,
+		AsFastAsPossible
+	};
+
+	struct CommandStatistics
+	{
+		uint64_t frames = 0;
+		uint64_t nanoseconds = 0;	///< time spent in the handlers of the cmd
+	};
+
+	struct Report
+	{
+		uint64_t rxRecords = 0;
+		uint64_t txRecords = 0;
+		uint64_t dispatchedFrames = 0;
+		uint64_t divergentFrames = 0;
+		uint64_t checksumFailures = 0;	///< frames not dispatched
+		uint64_t resyncEvents = 0;
+		uint64_t discardedBytes = 0;
+		double seconds = 0;
+		std::array<CommandStatistics, 256> commands;
+
+		double getFramesPerSecond() const { return seconds > 0 ? dispatchedFrames / seconds : 0; }
+	};
+
+	explicit CaptureReplay(const HostCommandDispatcher& dispatcher);
+
+	/**
+	@param speed factor on the recorded timing in Mode::Scaled, e.g. 2 for twice as fast
+	*/
+	Report run(const TelemetryReader& reader, Mode mode, double speed = 1);
+
+private:
+	void compareWithRecorded(const Frame& frame, Report& report);
+
+private:
+	const HostCommandDispatcher& m_dispatcher;
+
+	std::array<Frame, 64> m_expectedFrames; //recorded frames fed into the parser but not delivered yet
+	size_t m_expectedBegin = 0;
+	size_t m_expectedEnd = 0;
+};
+
+#endif // CAPTUREREPLAY_H
@@ -0,0 +1,71 @@
+#ifndef COBS_H
+#define COBS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+Consistent Overhead Byte Stuffing: removes every zero byte from a block, so a zero byte can delimit blocks on
+the link. Each run of up to 254 non-zero bytes is preceded by a code byte holding its length + 1, a code below
+0xFF stands for a zero byte after its run. That costs one byte per 254 bytes, one byte for short blocks.
+*/
+constexpr size_t getMaxCobsEncodedSize(size_t size) { return size + size / 254 + 1; }
+
+/**
+Encodes size bytes at pData into pTarget, which has to provide getMaxCobsEncodedSize(size) bytes.
+No delimiter is appended.
+@returns the size of the encoded block
+*/
+inline size_t cobsEncode(const uint8_t* pData, size_t size, uint8_t* pTarget)
+{
+	size_t codePos = 0;
+	size_t targetSize = 1;
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (pData[i] != 0)
+		{
+			pTarget[targetSize++] = pData[i];
+		}
+		if (pData[i] == 0 || targetSize - codePos == 0xFF)
+		{
+			pTarget[codePos] = uint8_t(targetSize - codePos);
+			codePos = targetSize++;
+		}
+	}
+	pTarget[codePos] = uint8_t(targetSize - codePos);
+	return targetSize;
+}
+
+/**
+Decodes the block of size bytes at pData, without its delimiter, into pTarget
+@returns false if the block is malformed or decodes to more than targetSize bytes
+*/
+inline bool cobsDecode(const uint8_t* pData, size_t size, uint8_t* pTarget, size_t targetSize, size_t& decodedSize)
+{
+	decodedSize = 0;
+	size_t i = 0;
+	while (i < size)
+	{
+		const size_t code = pData[i++];
+		if (code == 0 || code - 1 > size - i || code - 1 > targetSize - decodedSize)
+			return false;
+
+		for (size_t end = i + code - 1; i < end; ++i)
+		{
+			if (pData[i] == 0)
+				return false;
+			pTarget[decodedSize++] = pData[i];
+		}
+
+		//the zero a code stands for is implied at the end of the block
+		if (code != 0xFF && i < size)
+		{
+			if (decodedSize == targetSize)
+				return false;
+			pTarget[decodedSize++] = 0;
+		}
+	}
+	return true;
+}
+
+#endif // COBS_H
@@ -0,0 +1,177 @@
+#ifndef COMMANDDISPATCHER_H
+#define COMMANDDISPATCHER_H
+
+#include "FrameCodec.h"
+
+#include <bitset>
+#include <functional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+template <typename... Payloads>
+constexpr bool areCommandIdsUnique()
+{
+	const int ids[] = { -1, int(Payloads::cmd_id)... };
+	for (size_t i = 1; i < sizeof(ids) / sizeof(ids[0]); ++i)
+	{
+		for (size_t j = i + 1; j < sizeof(ids) / sizeof(ids[0]); ++j)
+		{
+			if (ids[i] == ids[j])
+				return false;
+		}
+	}
+	return true;
+}
+
+template <typename... Payloads>
+constexpr bool doCommandIdsFitIntoAByte()
+{
+	const int ids[] = { 0, int(Payloads::cmd_id)... };
+	for (int id : ids)
+	{
+		if (id < 0 || id > 0xFF)
+			return false;
+	}
+	return true;
+}
+
+template <typename... Payloads>
+constexpr bool doPayloadsFitIntoAFrame()
+{
+	const size_t sizes[] = { 0, sizeof(Payloads)... };
+	for (size_t size : sizes)
+	{
+		if (size > getPayloadSize())
+			return false;
+	}
+	return true;
+}
+
+/**
+Routes received frames to the handlers registered for their payload type.
+
+The 256 entry jump table from cmd to decoder is built at compile time out of the payload type list,
+so dispatching costs one table lookup no matter how many commands there are.
+Each subsystem registers the handlers it is interested in, several handlers per command are called in registration order.
+*/
+template <typename... Payloads>
+class CommandDispatcher
+{
+	static_assert(areCommandIdsUnique<Payloads...>(), "cmd_id used by more than one payload");
+	static_assert(doCommandIdsFitIntoAByte<Payloads...>(), "cmd_id out of range");
+	static_assert(doPayloadsFitIntoAFrame<Payloads...>(), "Payload too big");
+
+public:
+	template <typename Payload>
+	using Handler = std::function<void(const RequestDataPacket<Payload>&)>;
+	typedef std::function<void(ConstByteSpan frame)> UnknownCommandHandler;
+	typedef std::bitset<256> CommandSet;
+
+	template <typename Payload>
+	void registerHandler(Handler<Payload> handler)
+	{
+		std::get<std::vector<Handler<Payload>>>(m_handlers).push_back(std::move(handler));
+	}
+
+	void setUnknownCommandHandler(UnknownCommandHandler handler)
+	{
+		m_unknownCommandHandler = std::move(handler);
+	}
+
+	/**
+	@returns false if the cmd of frame is not in the payload type list
+	*/
+	bool dispatch(ConstByteSpan frame) const
+	{
+		const Decoder decoder = s_jumpTable.decoders[getFrameCommand(frame)];
+		if (!decoder)
+		{
+			if (m_unknownCommandHandler)
+			{
+				m_unknownCommandHandler(frame);
+			}
+			return false;
+		}
+
+		decoder(*this, frame);
+		return true;
+	}
+
+	static bool isKnownCommand(uint8_t cmd)
+	{
+		return s_jumpTable.decoders[cmd] != nullptr;
+	}
+
+	static CommandSet getKnownCommands()
+	{
+		CommandSet commands;
+		for (uint8_t cmd : { uint8_t(Payloads::cmd_id)... })
+		{
+			commands.set(cmd);
+		}
+		return commands;
+	}
+
+private:
+	typedef void (*Decoder)(const CommandDispatcher& dispatcher, ConstByteSpan frame);
+
+	struct JumpTable
+	{
+		Decoder decoders[256];
+	};
+
+	template <size_t Index>
+	static void decodeAndCallHandlers(const CommandDispatcher& dispatcher, ConstByteSpan frame)
+	{
+		typedef typename std::tuple_element<Index, std::tuple<Payloads...>>::type Payload;
+
+		RequestDataPacket<Payload> dataPacket;
+		decodeFrame(frame, dataPacket);
+		for (const auto& handler : std::get<Index>(dispatcher.m_handlers))
+		{
+			handler(dataPacket);
+		}
+	}
+
+	template <size_t... Indices>
+	static constexpr JumpTable makeJumpTable(std::index_sequence<Indices...>)
+	{
+		JumpTable jumpTable = {};
+		const uint8_t ids[] = { 0, uint8_t(Payloads::cmd_id)... };
+		const Decoder decoders[] = { nullptr, &decodeAndCallHandlers<Indices>... };
+		for (size_t i = 1; i < sizeof(ids); ++i)
+		{
+			jumpTable.decoders[ids[i]] = decoders[i];
+		}
+		return jumpTable;
+	}
+
+	static const JumpTable s_jumpTable;
+
+	std::tuple<std::vector<Handler<Payloads>>...> m_handlers;
+	UnknownCommandHandler m_unknownCommandHandler;
+};
+
+template <typename... Payloads>
+constexpr typename CommandDispatcher<Payloads...>::JumpTable CommandDispatcher<Payloads...>::s_jumpTable
+	= CommandDispatcher<Payloads...>::makeJumpTable(std::index_sequence_for<Payloads...>());
+
+/**
+Commands the host receives from the MC
+*/
+typedef CommandDispatcher<
+	NotifyVersionPayload,
+	WriteDataPayload,
+	RequestDataPayload,
+	ResourcePayload,
+	StatusPayload,
+	ReliablePayload,
+	AckPayload,
+	ReliableWriteDataPayload,
+	BaudAcceptPayload,
+	BaudProbePayload,
+	BaudCommitPayload,
+	FramingAcceptPayload> HostCommandDispatcher;
+
+#endif // COMMANDDISPATCHER_H
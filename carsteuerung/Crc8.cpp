@@ -0,0 +1,187 @@
+#include "Crc8.h"
+
+#include "FrameCodec.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC8_HAVE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace
+{
+
+constexpr uint8_t calculateCrc8TableEntry(uint8_t value)
+{
+	uint8_t crc = value;
+	for (int bit = 0; bit < 8; ++bit)
+	{
+		crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ getCrc8Polynomial()) : static_cast<uint8_t>(crc << 1);
+	}
+	return crc;
+}
+
+constexpr Crc8Tables makeCrc8Tables()
+{
+	Crc8Tables tables = {};
+	for (int i = 0; i < 256; ++i)
+	{
+		tables.slices[0][i] = calculateCrc8TableEntry(static_cast<uint8_t>(i));
+	}
+	for (size_t slice = 1; slice < getCrc8SliceCount(); ++slice)
+	{
+		for (int i = 0; i < 256; ++i)
+		{
+			tables.slices[slice][i] = tables.slices[0][tables.slices[slice - 1][i]];
+		}
+	}
+	return tables;
+}
+
+}
+
+constexpr Crc8Tables crc8Tables = makeCrc8Tables();
+
+static_assert(crc8Tables.slices[0][1] == getCrc8Polynomial(), "crc table generation broken");
+
+uint8_t crc8UpdateSliceBy4(uint8_t crc, const uint8_t* pData, size_t size)
+{
+	static_assert(getCrc8SliceCount() == 4, "unrolled for 4 slices");
+
+	for (; size >= 4; size -= 4, pData += 4)
+	{
+		crc = crc8Tables.slices[3][crc ^ pData[0]]
+			^ crc8Tables.slices[2][pData[1]]
+			^ crc8Tables.slices[1][pData[2]]
+			^ crc8Tables.slices[0][pData[3]];
+	}
+	return crc8Update(crc, pData, size);
+}
+
+namespace
+{
+
+bool isFrameValid(const uint8_t* pFrame)
+{
+	return crc8UpdateSliceBy4(0, pFrame + 1, getPayloadSize()) == pFrame[getFrameSize() - 1];
+}
+
+#ifdef CRC8_HAVE_SSSE3
+/**
+Runs the crc of 16 frames in parallel, one frame per byte lane.
+As the crc is linear, a table lookup splits into one lookup per nibble, which fits pshufb.
+Reads 16 bytes per frame, so 4 bytes past the last frame have to be readable.
+@returns bit i set if frame i is valid
+*/
+__attribute__((target("ssse3"), always_inline))
+inline uint16_t validate16Frames(const uint8_t* pFrames, __m128i lowTable, __m128i highTable)
+{
+	static_assert(getFrameSize() <= 16, "a frame has to fit into one vector");
+
+	const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+
+	//transpose 16 frames into 16 columns. The unpack network leaves column c in columns[bitReversed(c)]
+	__m128i columns[16];
+	__m128i tmp[16];
+	for (int i = 0; i < 16; ++i)
+	{
+		columns[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pFrames + i * getFrameSize()));
+	}
+	for (int i = 0; i < 8; ++i)
+	{
+		tmp[i] = _mm_unpacklo_epi8(columns[2 * i], columns[2 * i + 1]);
+		tmp[i + 8] = _mm_unpackhi_epi8(columns[2 * i], columns[2 * i + 1]);
+	}
+	for (int i = 0; i < 8; ++i)
+	{
+		columns[i] = _mm_unpacklo_epi16(tmp[2 * i], tmp[2 * i + 1]);
+		columns[i + 8] = _mm_unpackhi_epi16(tmp[2 * i], tmp[2 * i + 1]);
+	}
+	for (int i = 0; i < 8; ++i)
+	{
+		tmp[i] = _mm_unpacklo_epi32(columns[2 * i], columns[2 * i + 1]);
+		tmp[i + 8] = _mm_unpackhi_epi32(columns[2 * i], columns[2 * i + 1]);
+	}
+	for (int i = 0; i < 8; ++i)
+	{
+		columns[i] = _mm_unpacklo_epi64(tmp[2 * i], tmp[2 * i + 1]);
+		columns[i + 8] = _mm_unpackhi_epi64(tmp[2 * i], tmp[2 * i + 1]);
+	}
+	static const int bitReversed[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+
+	__m128i crc = _mm_setzero_si128();
+	for (size_t byte = 1; byte <= getPayloadSize(); ++byte)
+	{
+		const __m128i index = _mm_xor_si128(crc, columns[bitReversed[byte]]);
+		crc = _mm_xor_si128(
+			_mm_shuffle_epi8(lowTable, _mm_and_si128(index, nibbleMask)),
+			_mm_shuffle_epi8(highTable, _mm_and_si128(_mm_srli_epi16(index, 4), nibbleMask)));
+	}
+
+	const __m128i received = columns[bitReversed[getFrameSize() - 1]];
+	return static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(crc, received)));
+}
+
+/**
+@returns the amount of frames processed, which are all but the last up to 16
+*/
+__attribute__((target("ssse3")))
+size_t validateFramesSsse3(const uint8_t* pFrames, size_t frameCount, uint64_t* pValidBitmap, size_t& validFrames)
+{
+	alignas(16) uint8_t lowNibbleTable[16];
+	alignas(16) uint8_t highNibbleTable[16];
+	for (int i = 0; i < 16; ++i)
+	{
+		lowNibbleTable[i] = crc8Tables.slices[0][i];
+		highNibbleTable[i] = crc8Tables.slices[0][i << 4];
+	}
+	const __m128i lowTable = _mm_load_si128(reinterpret_cast<const __m128i*>(lowNibbleTable));
+	const __m128i highTable = _mm_load_si128(reinterpret_cast<const __m128i*>(highNibbleTable));
+
+	//the vector loads run 4 bytes into the frame following the block
+	size_t i = 0;
+	for (; i + 16 < frameCount; i += 16)
+	{
+		const uint64_t validMask = validate16Frames(pFrames + i * getFrameSize(), lowTable, highTable);
+		pValidBitmap[i / 64] |= validMask << (i % 64);
+		validFrames += __builtin_popcount(static_cast<unsigned>(validMask));
+	}
+	return i;
+}
+
+bool cpuHasSsse3()
+{
+	static const bool hasSsse3 = __builtin_cpu_supports("ssse3");
+	return hasSsse3;
+}
+#endif
+
+}
+
+size_t crc8ValidateFrames(const uint8_t* pFrames, size_t frameCount, uint64_t* pValidBitmap)
+{
+	size_t validFrames = 0;
+	size_t i = 0;
+
+	for (size_t word = 0; word < (frameCount + 63) / 64; ++word)
+	{
+		pValidBitmap[word] = 0;
+	}
+
+#ifdef CRC8_HAVE_SSSE3
+	if (cpuHasSsse3())
+	{
+		i = validateFramesSsse3(pFrames, frameCount, pValidBitmap, validFrames);
+	}
+#endif
+
+	for (; i < frameCount; ++i)
+	{
+		if (isFrameValid(pFrames + i * getFrameSize()))
+		{
+			pValidBitmap[i / 64] |= uint64_t(1) << (i % 64);
+			++validFrames;
+		}
+	}
+
+	return validFrames;
+}
@@ -0,0 +1,52 @@
+#ifndef CRC8_H
+#define CRC8_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+CRC-8 as used on the link to the MC: polynomial 0x9B, init 0, no reflection, no final xor
+(equivalent to boost::crc_optimal<8, 0x9B, 0, 0, false, false>).
+*/
+constexpr uint8_t getCrc8Polynomial() { return 0x9B; }
+
+constexpr size_t getCrc8SliceCount() { return 4; }
+
+/**
+slices[0] is the classic byte-wise table, slices[n][b] is the crc of b followed by n zero bytes
+*/
+struct Crc8Tables
+{
+	uint8_t slices[getCrc8SliceCount()][256];
+};
+
+extern const Crc8Tables crc8Tables;
+
+inline uint8_t crc8Update(uint8_t crc, const uint8_t* pData, size_t size)
+{
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc = crc8Tables.slices[0][crc ^ pData[i]];
+	}
+	return crc;
+}
+
+inline uint8_t crc8(const uint8_t* pData, size_t size)
+{
+	return crc8Update(0, pData, size);
+}
+
+/**
+Processes getCrc8SliceCount() bytes per table round, pays off for longer blocks
+*/
+uint8_t crc8UpdateSliceBy4(uint8_t crc, const uint8_t* pData, size_t size);
+
+/**
+Validates the checksums of frameCount frames of getFrameSize() bytes each, lying back to back at pFrames.
+Bit (i % 64) of pValidBitmap[i / 64] is set if frame i is valid, pValidBitmap needs to hold (frameCount + 63) / 64 words.
+Uses SSSE3 to check 16 frames at once where the CPU supports it.
+@returns the amount of valid frames
+*/
+size_t crc8ValidateFrames(const uint8_t* pFrames, size_t frameCount, uint64_t* pValidBitmap);
+
+#endif // CRC8_H
@@ -0,0 +1,134 @@
+#ifndef DEFERREDCALL_H
+#define DEFERREDCALL_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+A move-only void() callable like std::function, but callables of up to inlineSize bytes
+(a lambda capturing a payload and this) are stored inside the object instead of on the heap.
+*/
+class DeferredCall
+{
+public:
+	enum { inlineSize = 48 };
+
+	DeferredCall() = default;
+
+	template <typename Fn, typename = typename std::enable_if<!std::is_same<typename std::decay<Fn>::type, DeferredCall>::value>::type>
+	explicit DeferredCall(Fn&& fn)
+	{
+		typedef typename std::decay<Fn>::type Callable;
+		construct<Callable>(std::forward<Fn>(fn), std::integral_constant<bool, sizeof(Callable) <= inlineSize && alignof(Callable) <= alignof(std::max_align_t)>());
+	}
+
+	DeferredCall(DeferredCall&& other)
+	{
+		moveFrom(other);
+	}
+
+	DeferredCall& operator =(DeferredCall&& other)
+	{
+		if (this != &other)
+		{
+			reset();
+			moveFrom(other);
+		}
+		return *this;
+	}
+
+	~DeferredCall()
+	{
+		reset();
+	}
+
+	void operator ()()
+	{
+		m_pOperations->invoke(&m_storage);
+	}
+
+	explicit operator bool() const { return m_pOperations != nullptr; }
+
+	void reset()
+	{
+		if (m_pOperations)
+		{
+			m_pOperations->destroy(&m_storage);
+			m_pOperations = nullptr;
+		}
+	}
+
+private:
+	typedef typename std::aligned_storage<inlineSize, alignof(std::max_align_t)>::type Storage;
+
+	struct Operations
+	{
+		void (*invoke)(void* pStorage);
+		void (*moveTo)(void* pFrom, void* pTo);
+		void (*destroy)(void* pStorage);
+	};
+
+	template <typename Callable>
+	struct Inline
+	{
+		static void invoke(void* pStorage) { (*static_cast<Callable*>(pStorage))(); }
+		static void moveTo(void* pFrom, void* pTo)
+		{
+			new (pTo) Callable(std::move(*static_cast<Callable*>(pFrom)));
+			static_cast<Callable*>(pFrom)->~Callable();
+		}
+		static void destroy(void* pStorage) { static_cast<Callable*>(pStorage)->~Callable(); }
+	};
+
+	template <typename Callable>
+	struct Heap
+	{
+		static void invoke(void* pStorage) { (**static_cast<Callable**>(pStorage))(); }
+		static void moveTo(void* pFrom, void* pTo) { *static_cast<Callable**>(pTo) = *static_cast<Callable**>(pFrom); }
+		static void destroy(void* pStorage) { delete *static_cast<Callable**>(pStorage); }
+	};
+
+	template <typename Callable>
+	static constexpr Operations s_inlineOperations = { &Inline<Callable>::invoke, &Inline<Callable>::moveTo, &Inline<Callable>::destroy };
+
+	template <typename Callable>
+	static constexpr Operations s_heapOperations = { &Heap<Callable>::invoke, &Heap<Callable>::moveTo, &Heap<Callable>::destroy };
+
+	template <typename Callable, typename Fn>
+	void construct(Fn&& fn, /*fitsInline = */ std::true_type)
+	{
+		new (&m_storage) Callable(std::forward<Fn>(fn));
+		m_pOperations = &s_inlineOperations<Callable>;
+	}
+
+	template <typename Callable, typename Fn>
+	void construct(Fn&& fn, /*fitsInline = */ std::false_type)
+	{
+		*reinterpret_cast<Callable**>(&m_storage) = new Callable(std::forward<Fn>(fn));
+		m_pOperations = &s_heapOperations<Callable>;
+	}
+
+	void moveFrom(DeferredCall& other)
+	{
+		m_pOperations = other.m_pOperations;
+		if (m_pOperations)
+		{
+			m_pOperations->moveTo(&other.m_storage, &m_storage);
+			other.m_pOperations = nullptr;
+		}
+	}
+
+private:
+	Storage m_storage;
+	const Operations* m_pOperations = nullptr;
+};
+
+template <typename Callable>
+constexpr DeferredCall::Operations DeferredCall::s_inlineOperations;
+
+template <typename Callable>
+constexpr DeferredCall::Operations DeferredCall::s_heapOperations;
+
+#endif // DEFERREDCALL_H
@@ -0,0 +1,253 @@
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include "ByteSpan.h"
+#include "Cobs.h"
+#include "Crc8.h"
+#include "Payload.h"
+
+#include <array>
+#include <cstring>
+
+constexpr size_t getFrameSize() { return 1 /*cmd*/ + getPayloadSize() + 1 /*crc*/; }
+
+typedef std::array<uint8_t, getFrameSize()> Frame;
+
+/**
+How frames travel on the link. After a reset of the MC, every frame takes getFrameSize() bytes.
+Once negotiated (FramingProposePayload), both directions use COBS instead: the zeros at the end of the payload
+are dropped, cmd, the rest of the payload and the crc are COBS encoded and a zero byte ends the frame.
+A Move takes 5 bytes then. The crc still covers the padded payload, so both framings carry the same Frame.
+*/
+enum class Framing
+{
+	Fixed = 0,
+	Cobs = 1
+};
+
+constexpr size_t getMaxCobsFrameSize() { return getMaxCobsEncodedSize(getFrameSize()) + 1 /*delimiter*/; }
+
+/**
+In COBS framing the MC packs its telemetry into super-frames, which may be longer than a frame:
+getSuperFrameCommand(), then per message a header byte (its cmd in the upper nibble, the size of its payload
+in the lower one) and the payload without padding, then a crc over everything after getSuperFrameCommand().
+See framing.h of the firmware.
+*/
+constexpr uint8_t getSuperFrameCommand() { return 0x1C; }
+constexpr uint8_t getMaxSuperFrameMessageCommand() { return 0x0F; }
+constexpr size_t getMaxSuperFrameContentSize() { return 24; }
+constexpr size_t getMaxSuperFrameMessages() { return getMaxSuperFrameContentSize(); }	//a message takes its header at least
+constexpr size_t getMaxCobsSuperFrameSize() { return getMaxCobsEncodedSize(1 + getMaxSuperFrameContentSize() + 1) + 1 /*delimiter*/; }
+
+/**
+Checksum of a frame as calculated by the MC: covers payload and padding, but neither cmd nor crc.
+*/
+inline uint8_t calculateFrameChecksum(const uint8_t* pFrame)
+{
+	return crc8(pFrame + 1, getPayloadSize());
+}
+
+inline uint8_t getFrameCommand(ConstByteSpan frame)
+{
+	assert(frame.size() >= getFrameSize());
+	return frame[0];
+}
+
+inline bool isFrameChecksumOk(ConstByteSpan frame)
+{
+	assert(frame.size() >= getFrameSize());
+	return calculateFrameChecksum(frame.data()) == frame[getFrameSize() - 1];
+}
+
+/**
+Encodes cmd, payload, padding and checksum into pFrame, which has to provide getFrameSize() bytes
+*/
+template <typename Payload>
+void encodeFrame(const RequestDataPacket<Payload>& dataPacket, uint8_t* pFrame)
+{
+	pFrame[0] = static_cast<uint8_t>(Payload::cmd_id);
+	std::memcpy(pFrame + 1, &dataPacket.payload, sizeof(Payload));
+	std::memset(pFrame + 1 + sizeof(Payload), 0, getPayloadSize() - sizeof(Payload));
+	pFrame[getFrameSize() - 1] = calculateFrameChecksum(pFrame);
+}
+
+template <typename Payload>
+Frame encodeFrame(const RequestDataPacket<Payload>& dataPacket)
+{
+	Frame frame;
+	encodeFrame(dataPacket, frame.data());
+	return frame;
+}
+
+/**
+Encodes the packets [begin, end) back to back into pBuffer.
+@returns the amount of frames written, which is limited by bufferSize
+*/
+template <typename PacketIterator>
+size_t encodeFrames(PacketIterator begin, PacketIterator end, uint8_t* pBuffer, size_t bufferSize)
+{
+	size_t framesWritten = 0;
+	for (; begin != end && bufferSize >= getFrameSize(); ++begin)
+	{
+		encodeFrame(*begin, pBuffer);
+		pBuffer += getFrameSize();
+		bufferSize -= getFrameSize();
+		++framesWritten;
+	}
+	return framesWritten;
+}
+
+/**
+Encodes frame in COBS framing including the delimiter into pTarget, which has to provide getMaxCobsFrameSize() bytes
+@returns the size on the wire
+*/
+inline size_t encodeCobsFrame(const Frame& frame, uint8_t* pTarget)
+{
+	size_t contentSize = getFrameSize() - 1;
+	while (contentSize > 1 && frame[contentSize - 1] == 0)
+	{
+		--contentSize;
+	}
+
+	uint8_t content[getFrameSize()];
+	std::memcpy(content, frame.data(), contentSize);
+	content[contentSize++] = frame[getFrameSize() - 1];
+
+	const size_t size = cobsEncode(content, contentSize, pTarget);
+	pTarget[size] = 0;
+	return size + 1;
+}
+
+/**
+Turns the content of a COBS frame (cmd, payload without its trailing zeros, crc) back into a frame
+@returns false if the content does not fit a frame, which includes content without cmd and crc
+*/
+inline bool decodeFrameContent(const uint8_t* pContent, size_t size, Frame& frame)
+{
+	if (size < 2 || size > getFrameSize())
+		return false;
+
+	frame.fill(0);
+	std::memcpy(frame.data(), pContent, size - 1);
+	frame[getFrameSize() - 1] = pContent[size - 1];
+	return true;
+}
+
+/**
+Decodes a COBS frame without its delimiter and pads the payload with zeros again
+@returns false if the frame is malformed, which includes frames without cmd and crc
+*/
+inline bool decodeCobsFrame(const uint8_t* pData, size_t size, Frame& frame)
+{
+	uint8_t content[getFrameSize()];
+	size_t contentSize;
+	return cobsDecode(pData, size, content, sizeof(content), contentSize) && decodeFrameContent(content, contentSize, frame);
+}
+
+/**
+Packs the messages of count frames into a super-frame in COBS framing including the delimiter
+@param pTarget getMaxCobsSuperFrameSize() bytes
+@returns the size on the wire, 0 if the messages do not fit or a cmd exceeds getMaxSuperFrameMessageCommand()
+*/
+inline size_t encodeCobsSuperFrame(const Frame* pFrames, size_t count, uint8_t* pTarget)
+{
+	uint8_t content[1 + getMaxSuperFrameContentSize() + 1];
+	size_t contentSize = 0;
+	content[contentSize++] = getSuperFrameCommand();
+	for (size_t i = 0; i < count; ++i)
+	{
+		size_t payloadSize = getPayloadSize();
+		while (payloadSize > 0 && pFrames[i][payloadSize] == 0)
+		{
+			--payloadSize;
+		}
+		if (pFrames[i][0] > getMaxSuperFrameMessageCommand() || contentSize + 1 + payloadSize > 1 + getMaxSuperFrameContentSize())
+			return 0;
+
+		content[contentSize++] = uint8_t(pFrames[i][0] << 4 | payloadSize);
+		std::memcpy(content + contentSize, pFrames[i].data() + 1, payloadSize);
+		contentSize += payloadSize;
+	}
+	content[contentSize] = crc8(content + 1, contentSize - 1);
+	++contentSize;
+
+	const size_t size = cobsEncode(content, contentSize, pTarget);
+	pTarget[size] = 0;
+	return size + 1;
+}
+
+/**
+Unpacks the content of a super-frame (getSuperFrameCommand() up to the crc) into frames. Their checksums
+are ok if the one of the super-frame is, so the handlers see a broken super-frame as broken frames.
+Messages of any cmd are unpacked, the header tells their size.
+@param pFrames, pContentSizes getMaxSuperFrameMessages() entries, the bytes each message took in the super-frame
+@returns false if the super-frame is malformed
+*/
+inline bool decodeSuperFrame(const uint8_t* pContent, size_t size, Frame* pFrames, size_t* pContentSizes, size_t& count)
+{
+	if (size < 2 || pContent[0] != getSuperFrameCommand())
+		return false;
+
+	const bool checksumIsOk = crc8(pContent + 1, size - 2) == pContent[size - 1];
+	count = 0;
+	for (size_t pos = 1; pos < size - 1; ++count)
+	{
+		if (count == getMaxSuperFrameMessages())
+			return false;
+
+		const size_t payloadSize = pContent[pos] & 0x0F;
+		if (payloadSize > getPayloadSize() || payloadSize > size - 1 - pos - 1)
+			return false;
+
+		Frame& frame = pFrames[count];
+		frame.fill(0);
+		frame[0] = pContent[pos] >> 4;
+		std::memcpy(frame.data() + 1, pContent + pos + 1, payloadSize);
+		frame[getFrameSize() - 1] = uint8_t(calculateFrameChecksum(frame.data()) ^ (checksumIsOk ? 0 : 0xFF));
+
+		pContentSizes[count] = 1 + payloadSize;
+		pos += 1 + payloadSize;
+	}
+	return true;
+}
+
+/**
+Encodes frame for the link into pTarget, which has to provide getMaxCobsFrameSize() bytes
+@returns the size on the wire
+*/
+inline size_t encodeWireFrame(Framing framing, const Frame& frame, uint8_t* pTarget)
+{
+	if (framing == Framing::Cobs)
+		return encodeCobsFrame(frame, pTarget);
+
+	std::memcpy(pTarget, frame.data(), frame.size());
+	return frame.size();
+}
+
+/**
+Returns the payload of a frame without copying it.
+The frame has to carry Payload::cmd_id and outlive the returned reference.
+*/
+template <typename Payload>
+const Payload& getFramePayload(ConstByteSpan frame)
+{
+	static_assert(alignof(Payload) == 1, "Payload has to be packed");
+	assert(frame.size() >= getFrameSize() && frame[0] == Payload::cmd_id);
+	return *reinterpret_cast<const Payload*>(frame.data() + 1);
+}
+
+/**
+@returns false if frame is too short or does not carry Payload::cmd_id
+*/
+template <typename Payload>
+bool decodeFrame(ConstByteSpan frame, RequestDataPacket<Payload>& dataPacket)
+{
+	if (frame.size() < getFrameSize() || frame[0] != Payload::cmd_id)
+		return false;
+
+	std::memcpy(&dataPacket.payload, frame.data() + 1, sizeof(Payload));
+	dataPacket.checksumIsOk = isFrameChecksumOk(frame);
+	return true;
+}
+
+#endif // FRAMECODEC_H
@@ -0,0 +1,224 @@
+#include "FrameParser.h"
+
+#include <algorithm>
+#include <cstring>
+
+FrameParser::FrameParser(CommandSet knownCommands)
+	: m_knownCommands(std::move(knownCommands))
+{
+	static_assert((std::tuple_size<decltype(m_ring)>::value & (std::tuple_size<decltype(m_ring)>::value - 1)) == 0, "ring size has to be a power of two");
+}
+
+size_t FrameParser::feed(const uint8_t* pData, size_t size)
+{
+	size = std::min(size, getFreeSpace());
+
+	const size_t writeIndex = m_writePos & (m_ring.size() - 1);
+	const size_t firstPart = std::min(size, m_ring.size() - writeIndex);
+	std::memcpy(&m_ring[writeIndex], pData, firstPart);
+	std::memcpy(&m_ring[0], pData + firstPart, size - firstPart);
+	m_writePos += size;
+
+	return size;
+}
+
+uint8_t* FrameParser::getWritePointer(size_t& contiguousSize)
+{
+	const size_t writeIndex = m_writePos & (m_ring.size() - 1);
+	contiguousSize = std::min(getFreeSpace(), m_ring.size() - writeIndex);
+	return &m_ring[writeIndex];
+}
+
+void FrameParser::commitWrite(size_t size)
+{
+	assert(size <= getFreeSpace());
+	m_writePos += size;
+}
+
+bool FrameParser::nextFrame(Frame& frame, bool& checksumIsOk)
+{
+	return m_framing == Framing::Cobs ? nextCobsFrame(frame, checksumIsOk) : nextFixedFrame(frame, checksumIsOk);
+}
+
+bool FrameParser::nextFixedFrame(Frame& frame, bool& checksumIsOk)
+{
+	while (getBufferedBytes() >= getFrameSize())
+	{
+		if (m_knownCommands[peek(0)])
+		{
+			copyOut(frame);
+			checksumIsOk = isFrameChecksumOk(frame);
+
+			//while searching a boundary, the cmd of the following frame confirms it, if it has arrived
+			const bool isConfirmed = m_isLocked || getBufferedBytes() == getFrameSize() || m_knownCommands[peek(getFrameSize())];
+			if (checksumIsOk && isConfirmed)
+			{
+				m_isLocked = true;
+				m_readPos += getFrameSize();
+				m_lastFrameWireSize = getFrameSize();
+				return true;
+			}
+
+			//payload bytes are known cmds often enough (0x01 Move, 0x03 ConfigPID), after a lost byte
+			//only the checksum tells the frame boundary from them
+			if (m_isLocked)
+			{
+				m_checksumFailures.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		else if (m_isLocked)
+		{
+			m_unknownCommands.fetch_add(1, std::memory_order_relaxed);
+		}
+		discardByte();
+	}
+
+	return false;
+}
+
+bool FrameParser::nextCobsFrame(Frame& frame, bool& checksumIsOk)
+{
+	for (;;)
+	{
+		if (nextSuperFrameMessage(frame, checksumIsOk))
+			return true;
+
+		//a frame longer than getMaxCobsSuperFrameSize() is broken, no need to look further for its end
+		const size_t searchSize = std::min(getBufferedBytes(), getMaxCobsSuperFrameSize());
+		size_t size = 0;
+		while (size < searchSize && peek(size) != 0)
+		{
+			++size;
+		}
+
+		if (size == searchSize)
+		{
+			if (size < getMaxCobsSuperFrameSize())
+				return false;
+
+			discardBytes(size);
+			continue;
+		}
+
+		//a delimiter right after the previous one carries no frame
+		if (size == 0)
+		{
+			++m_readPos;
+			continue;
+		}
+
+		uint8_t encoded[getMaxCobsSuperFrameSize()];
+		for (size_t i = 0; i < size; ++i)
+		{
+			encoded[i] = peek(i);
+		}
+		uint8_t content[1 + getMaxSuperFrameContentSize() + 1];
+		size_t contentSize;
+		if (!cobsDecode(encoded, size, content, sizeof(content), contentSize) || contentSize < 2)
+		{
+			discardBytes(size + 1);
+			continue;
+		}
+
+		if (content[0] == getSuperFrameCommand())
+		{
+			if (!decodeSuperFrame(content, contentSize, m_superFrameMessages.data(), m_superFrameWireSizes.data(), m_superFrameMessageCount))
+			{
+				m_superFrameMessageCount = 0;
+				discardBytes(size + 1);
+				continue;
+			}
+
+			//the first message carries the overhead of the super-frame, so the wire sizes add up
+			size_t contentSizes = 0;
+			for (size_t i = 0; i < m_superFrameMessageCount; ++i)
+			{
+				contentSizes += m_superFrameWireSizes[i];
+			}
+			if (m_superFrameMessageCount > 0)
+			{
+				m_superFrameWireSizes[0] += size + 1 - contentSizes;
+			}
+			m_nextSuperFrameMessage = 0;
+			m_isLocked = true;
+			m_readPos += size + 1;
+			continue;
+		}
+
+		if (!decodeFrameContent(content, contentSize, frame))
+		{
+			discardBytes(size + 1);
+			continue;
+		}
+
+		if (!m_knownCommands[frame[0]])
+		{
+			m_unknownCommands.fetch_add(1, std::memory_order_relaxed);
+			discardBytes(size + 1);
+			continue;
+		}
+
+		checksumIsOk = isFrameChecksumOk(frame);
+		if (!checksumIsOk)
+		{
+			m_checksumFailures.fetch_add(1, std::memory_order_relaxed);
+		}
+		m_isLocked = true;
+		m_readPos += size + 1;
+		m_lastFrameWireSize = size + 1;
+		return true;
+	}
+}
+
+bool FrameParser::nextSuperFrameMessage(Frame& frame, bool& checksumIsOk)
+{
+	while (m_nextSuperFrameMessage < m_superFrameMessageCount)
+	{
+		const size_t index = m_nextSuperFrameMessage++;
+		if (!m_knownCommands[m_superFrameMessages[index][0]])
+		{
+			m_unknownCommands.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+
+		frame = m_superFrameMessages[index];
+		checksumIsOk = isFrameChecksumOk(frame);
+		if (!checksumIsOk)
+		{
+			m_checksumFailures.fetch_add(1, std::memory_order_relaxed);
+		}
+		m_lastFrameWireSize = m_superFrameWireSizes[index];
+		return true;
+	}
+	return false;
+}
+
+void FrameParser::copyOut(Frame& frame) const
+{
+	const size_t readIndex = m_readPos & (m_ring.size() - 1);
+	const size_t firstPart = std::min(frame.size(), m_ring.size() - readIndex);
+	std::memcpy(frame.data(), &m_ring[readIndex], firstPart);
+	std::memcpy(frame.data() + firstPart, &m_ring[0], frame.size() - firstPart);
+}
+
+void FrameParser::discardByte()
+{
+	if (m_isLocked)
+	{
+		m_isLocked = false;
+		m_resyncEvents.fetch_add(1, std::memory_order_relaxed);
+	}
+	++m_readPos;
+	m_discardedBytes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameParser::discardBytes(size_t count)
+{
+	if (m_isLocked)
+	{
+		m_isLocked = false;
+		m_resyncEvents.fetch_add(1, std::memory_order_relaxed);
+	}
+	m_readPos += count;
+	m_discardedBytes.fetch_add(count, std::memory_order_relaxed);
+}
@@ -0,0 +1,99 @@
+#ifndef FRAMEPARSER_H
+#define FRAMEPARSER_H
+
+#include "FrameCodec.h"
+
+#include <array>
+#include <atomic>
+#include <bitset>
+
+/**
+Cuts a received byte stream into frames and finds the frame boundaries again after bytes got lost or inserted on the link.
+
+A frame is taken if its cmd is known and its checksum is ok, everything else is discarded byte by byte.
+While searching a boundary, the frame following it has to start with a known cmd as well, if it has arrived.
+The checksum does not cover cmd and matches one in 256 misaligned frames by chance, such a frame gets through.
+A bad checksum or an unknown cmd where the parser expected the next frame counts as checksum failure or
+unknown command and drops the lock, so a corrupted frame is lost, but the frame after it is found again.
+
+In COBS framing the delimiters mark the boundaries, a malformed or overlong frame is discarded up to the next one.
+A super-frame is unpacked into the frames of its messages, which nextFrame() returns one after the other.
+*/
+class FrameParser
+{
+public:
+	typedef std::bitset<256> CommandSet;
+
+	explicit FrameParser(CommandSet knownCommands);
+
+	/**
+	Appends received bytes to the receive ring.
+	@returns the amount of bytes taken, which is less than size if the ring is full
+	*/
+	size_t feed(const uint8_t* pData, size_t size);
+
+	/**
+	Lets a transport read directly into the receive ring: returns the start of the free region
+	and its contiguous size. Bytes written there are taken over by commitWrite().
+	*/
+	uint8_t* getWritePointer(size_t& contiguousSize);
+	void commitWrite(size_t size);
+
+	/**
+	@param checksumIsOk always set in fixed framing, where the checksum finds the frame boundaries
+	@returns false if more data is needed for the next frame
+	*/
+	bool nextFrame(Frame& frame, bool& checksumIsOk);
+
+	/**
+	Applies to the bytes not taken by nextFrame() yet
+	*/
+	void setFraming(Framing framing) { m_framing = framing; }
+	Framing getFraming() const { return m_framing; }
+
+	/**
+	Bytes the last frame returned by nextFrame() took on the wire
+	*/
+	size_t getLastFrameWireSize() const { return m_lastFrameWireSize; }
+
+	size_t getBufferedBytes() const { return m_writePos - m_readPos; }
+	size_t getFreeSpace() const { return m_ring.size() - getBufferedBytes(); }
+	bool isLocked() const { return m_isLocked; }
+
+	uint64_t getResyncEvents() const { return m_resyncEvents.load(std::memory_order_relaxed); }
+	uint64_t getDiscardedBytes() const { return m_discardedBytes.load(std::memory_order_relaxed); }
+	uint64_t getChecksumFailures() const { return m_checksumFailures.load(std::memory_order_relaxed); }
+	uint64_t getUnknownCommands() const { return m_unknownCommands.load(std::memory_order_relaxed); }
+
+private:
+	uint8_t peek(size_t offset) const { return m_ring[(m_readPos + offset) & (m_ring.size() - 1)]; }
+	bool nextFixedFrame(Frame& frame, bool& checksumIsOk);
+	bool nextCobsFrame(Frame& frame, bool& checksumIsOk);
+	bool nextSuperFrameMessage(Frame& frame, bool& checksumIsOk);
+	void copyOut(Frame& frame) const;
+	void discardByte();
+	void discardBytes(size_t count);
+
+private:
+	const CommandSet m_knownCommands;
+
+	std::array<uint8_t, 4096> m_ring;
+	size_t m_readPos = 0; //read and write position grow continuously, masking maps them into the ring
+	size_t m_writePos = 0;
+	bool m_isLocked = false;
+	Framing m_framing = Framing::Fixed;
+	size_t m_lastFrameWireSize = 0;
+
+	//messages of the last super-frame not returned yet
+	std::array<Frame, getMaxSuperFrameMessages()> m_superFrameMessages;
+	std::array<size_t, getMaxSuperFrameMessages()> m_superFrameWireSizes;
+	size_t m_superFrameMessageCount = 0;
+	size_t m_nextSuperFrameMessage = 0;
+
+	std::atomic<uint64_t> m_resyncEvents{0};
+	std::atomic<uint64_t> m_discardedBytes{0};
+	std::atomic<uint64_t> m_checksumFailures{0};
+	std::atomic<uint64_t> m_unknownCommands{0};
+};
+
+#endif // FRAMEPARSER_H
@@ -0,0 +1,159 @@
+#include "FrameSender.h"
+
+#include "SerialTransport.h"
+#include "TelemetryRecorder.h"
+#include "TrafficCounters.h"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+
+int64_t toNanoseconds(std::chrono::steady_clock::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+}
+
+FrameSender::FrameSender(SerialTransport& transport, TelemetryRecorder* pRecorder, TrafficCounters* pTrafficCounters)
+	: m_transport(transport)
+	, m_pRecorder(pRecorder)
+	, m_pTrafficCounters(pTrafficCounters)
+{
+}
+
+void FrameSender::send(const Frame& frame)
+{
+	while (!m_queue.tryPush(frame))
+	{
+		wakeUp();
+		boost::this_thread::yield();
+	}
+	wakeUp();
+}
+
+void FrameSender::sendMove(const MovePayload& payload, std::chrono::steady_clock::time_point inputTime)
+{
+	//only the first input of a coalesced burst sets the time
+	int64_t noInputTime = 0;
+	m_pendingMoveInputTime.compare_exchange_strong(noInputTime, toNanoseconds(inputTime));
+
+	if (m_pendingMove.exchange(movePending | payload.direction) & movePending)
+	{
+		m_coalescedMoves.fetch_add(1, std::memory_order_relaxed);
+	}
+	wakeUp();
+}
+
+void FrameSender::pause()
+{
+	m_isPaused.store(true);
+	boost::mutex::scoped_lock lock(m_writeMutex);
+}
+
+void FrameSender::resume()
+{
+	m_isPaused.store(false);
+	wakeUp();
+}
+
+void FrameSender::run()
+{
+	std::array<Frame, 64> frames;
+	std::array<size_t, 64> wireSizes;
+	std::array<uint8_t, 64 * getMaxCobsFrameSize()> batch;
+
+	for (;;)
+	{
+		waitForWork();
+
+		//pause() may have come in between
+		boost::mutex::scoped_lock writeLock(m_writeMutex);
+		if (m_isPaused.load())
+			continue;
+
+		size_t frameCount = 0;
+		int64_t moveInputTime = 0;
+		const uint16_t move = m_pendingMove.exchange(0);
+		if (move & movePending)
+		{
+			moveInputTime = m_pendingMoveInputTime.exchange(0);
+			frames[frameCount++] = encodeFrame(RequestDataPacket<MovePayload>(MovePayload{uint8_t(move)}));
+		}
+
+		while (frameCount < frames.size() && m_queue.tryPop(frames[frameCount]))
+		{
+			++frameCount;
+		}
+
+		const Framing framing = m_framing.load();
+		size_t size = 0;
+		for (size_t i = 0; i < frameCount; ++i)
+		{
+			wireSizes[i] = encodeWireFrame(framing, frames[i], &batch[size]);
+			size += wireSizes[i];
+		}
+
+		//frames sent while the port is closed are dropped
+		const int64_t writeStart = toNanoseconds(std::chrono::steady_clock::now());
+		if (m_transport.write(batch.data(), size))
+		{
+			//a Move arriving while this loop took the previous one finds the old time still set and goes without, its sample is lost
+			if (moveInputTime != 0)
+			{
+				const int64_t written = toNanoseconds(std::chrono::steady_clock::now());
+				m_moveLatency.record(uint64_t(std::max<int64_t>(0, written - moveInputTime)));
+				m_moveWriteTime.record(uint64_t(written - writeStart));
+			}
+
+			//captures hold the frames, whatever the framing
+			for (size_t i = 0; i < frameCount; ++i)
+			{
+				const ConstByteSpan frame(frames[i].data(), frames[i].size());
+				if (m_pRecorder)
+				{
+					m_pRecorder->record(TelemetryDirection::Tx, 0, frame);
+				}
+				if (m_pTrafficCounters)
+				{
+					m_pTrafficCounters->countFrame(TelemetryDirection::Tx, frame, true, wireSizes[i]);
+				}
+			}
+			m_sentFrames.fetch_add(frameCount, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool FrameSender::hasWork() const
+{
+	return !m_isPaused.load() && ((m_pendingMove.load() & movePending) || !m_queue.isEmpty());
+}
+
+void FrameSender::waitForWork()
+{
+	boost::this_thread::interruption_point();
+	if (hasWork())
+		return;
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_isWaiting.store(true);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	while (!hasWork())
+	{
+		m_wakeupCondition.wait(lock);
+	}
+	m_isWaiting.store(false);
+}
+
+void FrameSender::wakeUp()
+{
+	//producers only pay for the lock if the transmit thread is asleep
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_isWaiting.load())
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_wakeupCondition.notify_one();
+	}
+}
@@ -0,0 +1,120 @@
+#ifndef FRAMESENDER_H
+#define FRAMESENDER_H
+
+#include "FrameCodec.h"
+#include "LatencyHistogram.h"
+#include "MpscQueue.h"
+
+#include <boost/thread.hpp>
+
+#include <atomic>
+#include <chrono>
+
+class SerialTransport;
+class TelemetryRecorder;
+class TrafficCounters;
+
+/**
+The only writer of the serial transport, so frames from different threads never interleave on the wire.
+
+Any thread hands frames over through a lock-free queue, run() on the transmit thread writes everything
+that has piled up with a single write call. Move commands only matter with their newest direction,
+so they go into a slot that each new one overwrites: a burst of key events leaves one frame, which is
+sent ahead of the queued frames.
+
+For each Move, the time from the input that caused it until the write() containing it returned goes
+into a latency histogram. If several inputs were coalesced, the oldest of them counts.
+*/
+class FrameSender
+{
+public:
+	/**
+	@param pRecorder if given, every frame sent is recorded
+	@param pTrafficCounters if given, every frame sent is counted
+	*/
+	explicit FrameSender(SerialTransport& transport, TelemetryRecorder* pRecorder = nullptr, TrafficCounters* pTrafficCounters = nullptr);
+
+	FrameSender(const FrameSender&) = delete;
+	FrameSender& operator =(const FrameSender&) = delete;
+
+	/**
+	Queues a frame, waits while the queue is full
+	*/
+	void send(const Frame& frame);
+
+	template <typename Payload>
+	void send(const RequestDataPacket<Payload>& dataPacket)
+	{
+		send(encodeFrame(dataPacket));
+	}
+
+	/**
+	Replaces a Move that has not been sent yet
+	@param inputTime when the input happened that caused the Move
+	*/
+	void sendMove(const MovePayload& payload, std::chrono::steady_clock::time_point inputTime = std::chrono::steady_clock::now());
+
+	/**
+	Holds back everything queued until resume(). When pause() returns, no write is in progress anymore,
+	so the caller has the transport to itself.
+	*/
+	void pause();
+	void resume();
+
+	/**
+	Applies from the next batch on, so a caller switching while paused knows which frames go in which framing
+	*/
+	void setFraming(Framing framing) { m_framing.store(framing); }
+	Framing getFraming() const { return m_framing.load(); }
+
+	/**
+	The transmit loop, returns when the thread is interrupted
+	*/
+	void run();
+
+	uint64_t getSentFrames() const { return m_sentFrames.load(std::memory_order_relaxed); }
+	uint64_t getCoalescedMoves() const { return m_coalescedMoves.load(std::memory_order_relaxed); }
+
+	/**
+	From the input until the Move was handed to the kernel
+	*/
+	LatencyHistogram& getMoveLatency() { return m_moveLatency; }
+
+	/**
+	The part of getMoveLatency() spent in the write() call
+	*/
+	LatencyHistogram& getMoveWriteTime() { return m_moveWriteTime; }
+
+private:
+	bool hasWork() const;
+	void waitForWork();
+	void wakeUp();
+
+private:
+	//bit 8 marks a pending Move, the low byte is its direction
+	static const uint16_t movePending = 0x100;
+
+	SerialTransport& m_transport;
+	TelemetryRecorder* m_pRecorder;
+	TrafficCounters* m_pTrafficCounters;
+
+	MpscQueue<Frame, 1024> m_queue;
+	std::atomic<uint16_t> m_pendingMove{0};
+	std::atomic<int64_t> m_pendingMoveInputTime{0}; //ns of steady_clock, 0 if unknown
+
+	boost::mutex m_mutex;
+	boost::condition_variable m_wakeupCondition;
+	std::atomic<bool> m_isWaiting{false};
+
+	boost::mutex m_writeMutex; //held by run() while it writes a batch
+	std::atomic<bool> m_isPaused{false};
+	std::atomic<Framing> m_framing{Framing::Fixed};
+
+	std::atomic<uint64_t> m_sentFrames{0};
+	std::atomic<uint64_t> m_coalescedMoves{0};
+
+	LatencyHistogram m_moveLatency;
+	LatencyHistogram m_moveWriteTime;
+};
+
+#endif // FRAMESENDER_H
@@ -0,0 +1,148 @@
+#include "FramingNegotiation.h"
+
+#include "FrameParser.h"
+#include "FrameSender.h"
+#include "SerialTransport.h"
+
+namespace
+{
+
+const unsigned maxProposeAttempts = 3;
+const FramingNegotiation::Clock::duration proposeTimeout = std::chrono::milliseconds(300);
+
+//the MC sends its status several times per second
+const FramingNegotiation::Clock::duration silenceTimeout = std::chrono::seconds(3);
+
+}
+
+FramingNegotiation::FramingNegotiation(SerialTransport& transport, FrameSender& sender, FrameParser& parser)
+	: m_transport(transport)
+	, m_sender(sender)
+	, m_parser(parser)
+{
+}
+
+void FramingNegotiation::start(Framing framing, Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (m_isProposing || framing == m_framing)
+		return;
+
+	m_sender.pause();
+	m_isProposing = true;
+	m_proposedFraming = framing;
+	m_proposeAttempts = 0;
+	propose(now);
+}
+
+void FramingNegotiation::reset()
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (m_isProposing)
+	{
+		m_isProposing = false;
+		m_sender.resume();
+	}
+
+	//the parser follows in poll(), on the receive thread
+	m_framing = Framing::Fixed;
+	m_sender.setFraming(Framing::Fixed);
+}
+
+void FramingNegotiation::receive(const RequestDataPacket<FramingAcceptPayload>& data, Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (!m_isProposing || !data.checksumIsOk || data.payload.framing != uint8_t(m_proposedFraming))
+		return;
+
+	if (data.payload.accepted)
+	{
+		//whatever follows the Accept is in the new framing already
+		switchTo(m_proposedFraming);
+		m_lastValidFrame = now;
+	}
+	finish();
+}
+
+void FramingNegotiation::countFrame(bool checksumIsOk, Clock::time_point now)
+{
+	if (!checksumIsOk)
+		return;
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_lastValidFrame = now;
+}
+
+FramingNegotiation::Clock::time_point FramingNegotiation::poll(Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_parser.setFraming(m_framing);
+
+	if (m_isProposing)
+	{
+		if (now >= m_deadline)
+		{
+			//the MC may have switched without its Accept getting through, it falls back when the next Propose arrives broken
+			if (m_proposeAttempts < maxProposeAttempts)
+			{
+				propose(now);
+			}
+			else
+			{
+				finish();
+				return Clock::time_point::max();
+			}
+		}
+		return m_deadline;
+	}
+
+	if (m_framing != Framing::Fixed)
+	{
+		if (now - m_lastValidFrame >= silenceTimeout)
+		{
+			switchTo(Framing::Fixed);
+			return Clock::time_point::max();
+		}
+		return m_lastValidFrame + silenceTimeout;
+	}
+	return Clock::time_point::max();
+}
+
+Framing FramingNegotiation::getFraming() const
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_framing;
+}
+
+bool FramingNegotiation::isNegotiating() const
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_isProposing;
+}
+
+void FramingNegotiation::propose(Clock::time_point now)
+{
+	FramingProposePayload payload;
+	payload.framing = uint8_t(m_proposedFraming);
+
+	//the sender is paused, the transport is ours
+	uint8_t wireFrame[getMaxCobsFrameSize()];
+	const size_t size = encodeWireFrame(m_framing, encodeFrame(RequestDataPacket<FramingProposePayload>(payload)), wireFrame);
+	m_transport.write(wireFrame, size);
+
+	++m_proposeAttempts;
+	m_deadline = now + proposeTimeout;
+}
+
+void FramingNegotiation::switchTo(Framing framing)
+{
+	m_framing = framing;
+	m_parser.setFraming(framing);
+	m_sender.setFraming(framing);
+}
+
+void FramingNegotiation::finish()
+{
+	m_isProposing = false;
+	m_sender.resume();
+}
@@ -0,0 +1,84 @@
+#ifndef FRAMINGNEGOTIATION_H
+#define FRAMINGNEGOTIATION_H
+
+#include "FrameCodec.h"
+
+#include <boost/thread/mutex.hpp>
+
+#include <chrono>
+
+class FrameParser;
+class FrameSender;
+class SerialTransport;
+
+/**
+Switches the link to COBS framing (see FrameCodec.h), the host side of framing.c of the firmware.
+
+The host proposes the framing and holds back everything else, so the Propose is the last frame in the old
+framing. The MC accepts and switches right after its Accept, which is the last frame in the old framing in the
+other direction. A firmware that does not know the Propose ignores it, the link stays at fixed framing then.
+
+After a switch, the host falls back to fixed framing on its own if nothing valid arrives for a while
+(e.g. the MC was reset), the MC does the same when it receives nothing but broken frames.
+
+start() may be called from any thread, receive(), countFrame() and poll() are expected from the receive thread,
+which owns the parser.
+*/
+class FramingNegotiation
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	FramingNegotiation(SerialTransport& transport, FrameSender& sender, FrameParser& parser);
+
+	FramingNegotiation(const FramingNegotiation&) = delete;
+	FramingNegotiation& operator =(const FramingNegotiation&) = delete;
+
+	/**
+	Does nothing while a negotiation is running or framing is in use already
+	*/
+	void start(Framing framing, Clock::time_point now = Clock::now());
+
+	/**
+	Back to fixed framing, for a port that has just been opened
+	*/
+	void reset();
+
+	void receive(const RequestDataPacket<FramingAcceptPayload>& data, Clock::time_point now = Clock::now());
+
+	/**
+	Every frame received, a link that stays silent in COBS framing is given up
+	*/
+	void countFrame(bool checksumIsOk, Clock::time_point now = Clock::now());
+
+	/**
+	Handles the timeouts
+	@returns when poll() has to be called again at the latest
+	*/
+	Clock::time_point poll(Clock::time_point now = Clock::now());
+
+	Framing getFraming() const;
+	bool isNegotiating() const;
+
+private:
+	void propose(Clock::time_point now);
+	void switchTo(Framing framing);
+	void finish();
+
+private:
+	SerialTransport& m_transport;
+	FrameSender& m_sender;
+	FrameParser& m_parser;
+
+	mutable boost::mutex m_mutex;
+
+	Framing m_framing = Framing::Fixed;
+	bool m_isProposing = false;
+	Framing m_proposedFraming = Framing::Fixed;
+	unsigned m_proposeAttempts = 0;
+	Clock::time_point m_deadline;
+
+	Clock::time_point m_lastValidFrame;
+};
+
+#endif // FRAMINGNEGOTIATION_H
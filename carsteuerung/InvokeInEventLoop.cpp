@@ -1,13 +1,16 @@
 #include "InvokeInEventLoop.h"
 
 #include "DoAtScopeExit.h"
+#include "MpscQueue.h"
 
 #include <QObject>
 #include <QEvent>
 #include <QCoreApplication>
 #include <QThread>
 
-#include <queue>
+#include <atomic>
+#include <deque>
+#include <map>
 #include <memory>
 
 #include <boost/thread.hpp>
@@ -15,43 +18,47 @@
 class FnCallDeferrer : public QObject
 {
 public:
-	typedef std::function<void()> DeferredFn;
-	typedef std::queue<DeferredFn>	QueueType;
-
 	explicit FnCallDeferrer(QObject* /*parent*/ = 0)
 	{
 	}
 
 	/**
-	Calls all deferred calls
+	Calls the deferred calls that were pending when the event arrived. Calls queued meanwhile
+	(also by the calls themselves) are left for the next event, so the event loop keeps running.
 	*/
 	void callDeferredFnCalls()
 	{
-		QueueType queue;
-		//copy because:
-		//- events can add new event while being processed.
-		//- Ensures reentrancy and protects from endless loops
-		//- A deferred fn can delete the CallDeferrer itself (Being used in case of the global callFnDeferred fn)
-		std::swap(queue, m_deferredFnCalls);
-		while (!queue.empty())
+		const size_t pendingCalls = m_pendingCalls.load(std::memory_order_acquire);
+		size_t processedCalls = 0;
+		DeferredCall call;
+		while (processedCalls < pendingCalls && popCall(call))
 		{
-			DeferredFn fn = queue.front();
-            assert(fn);
-			fn();
-			queue.pop();
+			++processedCalls;
+			call();
+			call.reset();
+		}
+
+		if (m_pendingCalls.fetch_sub(processedCalls, std::memory_order_acq_rel) != processedCalls)
+		{
+			postWakeUpEvent();
 		}
 	}
 
-	void callFnDeferred(const DeferredFn& fn)
+	void callFnDeferred(DeferredCall call)
 	{
-        assert(fn);
-		m_deferredFnCalls.push(fn);
-		QCoreApplication::postEvent(this, new QEvent(QEvent::Type(QEvent::User + 100)));
+		assert(call);
+		pushCall(std::move(call));
+
+		//only the call that makes the queue non-empty needs to wake up the target thread
+		if (m_pendingCalls.fetch_add(1, std::memory_order_acq_rel) == 0)
+		{
+			postWakeUpEvent();
+		}
 	}
 
 	size_t	getQueueSize()
 	{
-		return m_deferredFnCalls.size();
+		return m_pendingCalls.load(std::memory_order_relaxed);
 	}
 
 	bool event(QEvent* pEvent) override
@@ -62,18 +69,82 @@ public:
 	}
 
 private:
-	QueueType m_deferredFnCalls;
+	void postWakeUpEvent()
+	{
+		QCoreApplication::postEvent(this, new QEvent(QEvent::Type(QEvent::User + 100)));
+	}
+
+	void pushCall(DeferredCall&& call)
+	{
+		//calls go to the overflow list while it is in use, so the calls of each thread keep their order
+		if (!m_isOverflowing.load(std::memory_order_acquire) && m_queue.tryPush(std::move(call)))
+			return;
+
+		boost::mutex::scoped_lock lock(m_overflowMutex);
+		m_overflow.push_back(std::move(call));
+		m_isOverflowing.store(true, std::memory_order_release);
+	}
+
+	bool popCall(DeferredCall& call)
+	{
+		if (m_queue.tryPop(call))
+			return true;
+
+		if (!m_isOverflowing.load(std::memory_order_acquire))
+			return false;
+
+		boost::mutex::scoped_lock lock(m_overflowMutex);
+		if (m_overflow.empty())
+			return false;
+
+		call = std::move(m_overflow.front());
+		m_overflow.pop_front();
+		if (m_overflow.empty())
+		{
+			m_isOverflowing.store(false, std::memory_order_release);
+		}
+		return true;
+	}
+
+private:
+	MpscQueue<DeferredCall, 1024> m_queue;
+	std::atomic<size_t> m_pendingCalls{0};
+
+	std::atomic<bool> m_isOverflowing{false};
+	boost::mutex m_overflowMutex;
+	std::deque<DeferredCall> m_overflow;
 };
 
-void callFnDeferredAsync(QObject* pTargetThread, const std::function<void()>& fn)
+/**
+The deferrer of a thread is created on first use and lives as long as the program
+*/
+static FnCallDeferrer& getFnCallDeferrer(QThread* pThread)
 {
-	FnCallDeferrer* pTmpDeferrer = new FnCallDeferrer();
-	pTmpDeferrer->moveToThread(pTargetThread->thread());
-	pTmpDeferrer->callFnDeferred([=]
+	//the target is almost always the same (GUI) thread, which saves the lookup
+	thread_local QThread* pCachedThread = nullptr;
+	thread_local FnCallDeferrer* pCachedDeferrer = nullptr;
+	if (pThread == pCachedThread)
+		return *pCachedDeferrer;
+
+	static boost::mutex deferrersMutex;
+	static std::map<QThread*, FnCallDeferrer*> deferrers;
+
+	boost::mutex::scoped_lock lock(deferrersMutex);
+	FnCallDeferrer*& pDeferrer = deferrers[pThread];
+	if (!pDeferrer)
 	{
-		DoAtScopeExit atExit([&]{ delete pTmpDeferrer; });
-		fn();
-	});
+		pDeferrer = new FnCallDeferrer();
+		pDeferrer->moveToThread(pThread);
+	}
+
+	pCachedThread = pThread;
+	pCachedDeferrer = pDeferrer;
+	return *pDeferrer;
+}
+
+void postDeferredCall(QObject* pTargetThread, DeferredCall call)
+{
+	getFnCallDeferrer(pTargetThread->thread()).callFnDeferred(std::move(call));
 }
 
 struct AsyncCallData
@@ -92,16 +163,25 @@ struct AsyncCallData
 	bool requestAbort = false;
 };
 
-void callFnDeferredSync(QObject* pTargetThread, const std::function<void()>& fn)
+void callFnDeferredSync(QObject* pTargetThread, void (*pInvoke)(void* pFn), void* pFn)
 {
 	if (pTargetThread->thread() == QThread::currentThread())
 	{
-		fn();
+		pInvoke(pFn);
 	}
 	else
 	{
-		auto ptrAsyncCallData = std::make_shared<AsyncCallData>();
-		callFnDeferredAsync(pTargetThread, [=]
+		//reused unless a call that was abandoned by an interruption still holds it
+		thread_local std::shared_ptr<AsyncCallData> ptrCachedAsyncCallData;
+		if (!ptrCachedAsyncCallData || ptrCachedAsyncCallData.use_count() != 1)
+		{
+			ptrCachedAsyncCallData = std::make_shared<AsyncCallData>();
+		}
+		std::shared_ptr<AsyncCallData> ptrAsyncCallData = ptrCachedAsyncCallData;
+		ptrAsyncCallData->state = AsyncCallData::State::Idle;
+		ptrAsyncCallData->requestAbort = false;
+
+		postDeferredCall(pTargetThread, DeferredCall([=]
 		{
 			DoAtScopeExit atExit([&]
 			{
@@ -120,8 +200,8 @@ void callFnDeferredSync(QObject* pTargetThread, const std::function<void()>& fn)
 				ptrAsyncCallData->condition.notify_all();
 			}
 
-			fn();
-		});
+			pInvoke(pFn);
+		}));
 
 		try
 		{
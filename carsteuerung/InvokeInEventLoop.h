@@ -1,12 +1,35 @@
 #ifndef INVOKEINEVENTLOOP_H
 #define INVOKEINEVENTLOOP_H
 
+#include "DeferredCall.h"
+
 #include <functional>
 
 class QObject;
 
-void callFnDeferredAsync(QObject* pTargetThread, const std::function<void()>& fn);
-void callFnDeferredSync(QObject* pTargetThread, const std::function<void()>& fn);
+/**
+Queues call for the thread pTargetThread lives in. Each thread has one persistent deferrer,
+which is woken up by a single event once its queue is no longer empty.
+*/
+void postDeferredCall(QObject* pTargetThread, DeferredCall call);
+
+/**
+Calls pInvoke(pFn) in the thread of pTargetThread and waits until it has returned
+*/
+void callFnDeferredSync(QObject* pTargetThread, void (*pInvoke)(void* pFn), void* pFn);
+
+template <typename Fn>
+void callFnDeferredAsync(QObject* pTargetThread, Fn&& fn)
+{
+	postDeferredCall(pTargetThread, DeferredCall(std::forward<Fn>(fn)));
+}
+
+template <typename Fn>
+void callFnDeferredSync(QObject* pTargetThread, Fn&& fn)
+{
+	typedef typename std::remove_reference<Fn>::type Callable;
+	callFnDeferredSync(pTargetThread, [](void* pFn) { (*static_cast<Callable*>(pFn))(); }, const_cast<void*>(static_cast<const void*>(&fn)));
+}
 
 template <typename Fn>
 auto _callFnDeferred(QObject* pTargetThread, Fn fn, /*isVoid = */ std::true_type) -> decltype(fn())
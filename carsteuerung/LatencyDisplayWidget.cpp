@@ -0,0 +1,75 @@
+#include "LatencyDisplayWidget.h"
+#include "ui_LatencyDisplayWidget.h"
+
+#include "FrameSender.h"
+
+#include <QFileDialog>
+
+#include <fstream>
+
+LatencyDisplayWidget::LatencyDisplayWidget(QWidget *parent) :
+	QWidget(parent),
+	ui(new Ui::LatencyDisplayWidget)
+{
+	ui->setupUi(this);
+}
+
+LatencyDisplayWidget::~LatencyDisplayWidget()
+{
+	delete ui;
+}
+
+void LatencyDisplayWidget::setSender(FrameSender* pFrameSender)
+{
+	m_pFrameSender = pFrameSender;
+	refresh();
+}
+
+void LatencyDisplayWidget::refresh()
+{
+	if (!m_pFrameSender)
+		return;
+
+	ui->keyToWire->setText(format(m_pFrameSender->getMoveLatency()));
+	ui->writeTime->setText(format(m_pFrameSender->getMoveWriteTime()));
+}
+
+bool LatencyDisplayWidget::dump(const std::string& path) const
+{
+	if (!m_pFrameSender)
+		return false;
+
+	std::ofstream file(path);
+	m_pFrameSender->getMoveLatency().write(file, "keypress to wire");
+	m_pFrameSender->getMoveWriteTime().write(file, "write");
+	return bool(file.flush());
+}
+
+void LatencyDisplayWidget::on_dumpButton_clicked()
+{
+	const QString path = QFileDialog::getSaveFileName(this, "Dump latency histograms", "latency.txt");
+	if (!path.isEmpty() && !dump(path.toStdString()))
+	{
+		ui->keyToWire->setText("could not write " + path);
+	}
+}
+
+void LatencyDisplayWidget::on_resetButton_clicked()
+{
+	if (!m_pFrameSender)
+		return;
+
+	m_pFrameSender->getMoveLatency().reset();
+	m_pFrameSender->getMoveWriteTime().reset();
+	refresh();
+}
+
+QString LatencyDisplayWidget::format(const LatencyHistogram& histogram)
+{
+	const LatencyHistogram::Summary summary = histogram.getSummary();
+	if (summary.count == 0)
+		return "n/a";
+
+	return "p50 " + QString::number(summary.p50 / 1e6, 'f', 2) + " ms, p99 " + QString::number(summary.p99 / 1e6, 'f', 2)
+		   + " ms, max " + QString::number(summary.max / 1e6, 'f', 2) + " ms (" + QString::number(summary.count) + " moves)";
+}
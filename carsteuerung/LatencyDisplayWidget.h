@@ -0,0 +1,50 @@
+#ifndef LATENCYDISPLAYWIDGET_H
+#define LATENCYDISPLAYWIDGET_H
+
+#include <QWidget>
+
+#include <string>
+
+class FrameSender;
+class LatencyHistogram;
+
+namespace Ui {
+class LatencyDisplayWidget;
+}
+
+/**
+Shows how long a key takes until its Move is on the wire, see FrameSender::getMoveLatency()
+*/
+class LatencyDisplayWidget : public QWidget
+{
+	Q_OBJECT
+
+public:
+	explicit LatencyDisplayWidget(QWidget *parent = 0);
+	~LatencyDisplayWidget();
+
+	void setSender(FrameSender* pFrameSender);
+
+	/**
+	Updates the percentiles, call from the GUI thread
+	*/
+	void refresh();
+
+	/**
+	Writes both histograms to path as text, see LatencyHistogram::write()
+	*/
+	bool dump(const std::string& path) const;
+
+private slots:
+	void on_dumpButton_clicked();
+	void on_resetButton_clicked();
+
+private:
+	static QString format(const LatencyHistogram& histogram);
+
+private:
+	Ui::LatencyDisplayWidget *ui;
+	FrameSender* m_pFrameSender = nullptr;
+};
+
+#endif // LATENCYDISPLAYWIDGET_H
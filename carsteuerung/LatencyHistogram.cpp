@@ -0,0 +1,105 @@
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+	m_buckets[getBucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+
+	uint64_t max = m_max.load(std::memory_order_relaxed);
+	while (nanoseconds > max && !m_max.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+void LatencyHistogram::reset()
+{
+	for (auto& bucket : m_buckets)
+	{
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getPercentile(double fraction) const
+{
+	//the buckets are summed up instead of using m_count, which may already include a sample still being recorded
+	uint64_t count = 0;
+	for (const auto& bucket : m_buckets)
+	{
+		count += bucket.load(std::memory_order_relaxed);
+	}
+	if (count == 0)
+		return 0;
+
+	const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * count + 0.5));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < m_buckets.size(); ++i)
+	{
+		seen += m_buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank)
+		{
+			return std::min(getBucketUpperBound(i), getMax());
+		}
+	}
+	return getMax();
+}
+
+LatencyHistogram::Summary LatencyHistogram::getSummary() const
+{
+	Summary summary;
+	summary.count = getCount();
+	summary.mean = summary.count > 0 ? double(m_sum.load(std::memory_order_relaxed)) / summary.count : 0;
+	summary.p50 = getPercentile(0.5);
+	summary.p99 = getPercentile(0.99);
+	summary.max = getMax();
+	return summary;
+}
+
+void LatencyHistogram::write(std::ostream& strm, const std::string& name) const
+{
+	const Summary summary = getSummary();
+	strm << "# " << name << ": " << summary.count << " samples, mean " << summary.mean << " ns, p50 " << summary.p50
+		 << " ns, p99 " << summary.p99 << " ns, max " << summary.max << " ns\n";
+	for (size_t i = 0; i < m_buckets.size(); ++i)
+	{
+		const uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+		if (count > 0)
+		{
+			strm << getBucketLowerBound(i) << " " << getBucketUpperBound(i) << " " << count << "\n";
+		}
+	}
+}
+
+size_t LatencyHistogram::getBucketIndex(uint64_t nanoseconds)
+{
+	//below 2 * subBucketCount every value has a bucket of its own
+	if (nanoseconds < 2 * subBucketCount)
+		return static_cast<size_t>(nanoseconds);
+
+	const unsigned exponent = 63 - __builtin_clzll(nanoseconds);
+	const unsigned subBucket = (nanoseconds >> (exponent - subBucketBits)) & (subBucketCount - 1);
+	return (exponent - subBucketBits + 1) * subBucketCount + subBucket;
+}
+
+uint64_t LatencyHistogram::getBucketLowerBound(size_t index)
+{
+	if (index < 2 * subBucketCount)
+		return index;
+
+	const unsigned exponent = static_cast<unsigned>(index / subBucketCount) + subBucketBits - 1;
+	return uint64_t(subBucketCount + index % subBucketCount) << (exponent - subBucketBits);
+}
+
+uint64_t LatencyHistogram::getBucketUpperBound(size_t index)
+{
+	if (index < 2 * subBucketCount)
+		return index;
+
+	const unsigned exponent = static_cast<unsigned>(index / subBucketCount) + subBucketBits - 1;
+	return getBucketLowerBound(index) + (uint64_t(1) << (exponent - subBucketBits)) - 1;
+}
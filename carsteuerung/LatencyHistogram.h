@@ -0,0 +1,58 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+Counts latencies in logarithmic buckets: each power of two is split into subBucketCount buckets,
+so a percentile taken from the histogram is less than 25% too high, from nanoseconds up to centuries.
+One thread may record while others read, nothing is locked; a reader may see a sample in count before its bucket.
+*/
+class LatencyHistogram
+{
+public:
+	enum { subBucketBits = 2, subBucketCount = 1 << subBucketBits, bucketCount = 64 * subBucketCount };
+
+	struct Summary
+	{
+		uint64_t count;
+		double mean;		///< ns
+		uint64_t p50;		///< ns, upper bound of the bucket
+		uint64_t p99;
+		uint64_t max;		///< ns, exact
+	};
+
+	void record(uint64_t nanoseconds);
+	void reset();
+
+	uint64_t getCount() const { return m_count.load(std::memory_order_relaxed); }
+	uint64_t getMax() const { return m_max.load(std::memory_order_relaxed); }
+
+	/**
+	@param fraction 0.5 for the median
+	@returns the upper bound of the bucket holding that fraction of the samples, 0 if there are none
+	*/
+	uint64_t getPercentile(double fraction) const;
+	Summary getSummary() const;
+
+	/**
+	Writes the summary and the non-empty buckets as text, one bucket per line: lower bound, upper bound (both ns) and count
+	*/
+	void write(std::ostream& strm, const std::string& name) const;
+
+	static size_t getBucketIndex(uint64_t nanoseconds);
+	static uint64_t getBucketLowerBound(size_t index);
+	static uint64_t getBucketUpperBound(size_t index); ///< inclusive
+
+private:
+	std::array<std::atomic<uint64_t>, bucketCount> m_buckets{};
+	std::atomic<uint64_t> m_count{0};
+	std::atomic<uint64_t> m_sum{0};
+	std::atomic<uint64_t> m_max{0};
+};
+
+#endif // LATENCYHISTOGRAM_H
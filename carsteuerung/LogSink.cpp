@@ -0,0 +1,51 @@
+#include "LogSink.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <ctime>
+
+LogSink::LogSink(const std::atomic_uint_fast64_t& byteCounter)
+	: m_byteCounter(byteCounter)
+{
+}
+
+size_t LogSink::drain(std::string& text)
+{
+	char line[512];
+	size_t lineCount = 0;
+
+	Record record;
+	while (m_queue.tryPop(record))
+	{
+		const std::time_t seconds = std::chrono::system_clock::to_time_t(record.time);
+		const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count() % 1000;
+		std::tm localTime;
+		localtime_r(&seconds, &localTime);
+
+		int size = snprintf(line, sizeof(line), "%" PRIu64 ", %02d:%02d:%02d.%03d: ", record.byteCount,
+							localTime.tm_hour, localTime.tm_min, localTime.tm_sec, int(milliseconds));
+		size += record.pFormatFn(record, line + size, sizeof(line) - size);
+
+		if (lineCount > 0)
+		{
+			text += '\n';
+		}
+		text.append(line, std::min<size_t>(size, sizeof(line) - 1));
+		++lineCount;
+	}
+
+	const uint64_t droppedRecords = getDroppedRecords();
+	if (droppedRecords != m_reportedDroppedRecords)
+	{
+		snprintf(line, sizeof(line), "%" PRIu64 " log lines dropped", droppedRecords - m_reportedDroppedRecords);
+		if (lineCount > 0)
+		{
+			text += '\n';
+		}
+		text += line;
+		++lineCount;
+		m_reportedDroppedRecords = droppedRecords;
+	}
+
+	return lineCount;
+}
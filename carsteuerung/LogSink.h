@@ -0,0 +1,140 @@
+#ifndef LOGSINK_H
+#define LOGSINK_H
+
+#include "MpscQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+/**
+Collects log lines from any thread without ever blocking the caller.
+
+log() only stores the format string (which has to be a literal), the time and the raw arguments
+in a lock-free ring. Formatting with printf semantics happens later in drain(), which the GUI calls
+at display refresh rate. If the ring overflows, lines are dropped and counted instead of waiting.
+*/
+class LogSink
+{
+public:
+	enum { maxArguments = 12 };
+
+	explicit LogSink(const std::atomic_uint_fast64_t& byteCounter);
+
+	LogSink(const LogSink&) = delete;
+	LogSink& operator =(const LogSink&) = delete;
+
+	/**
+	Arguments have to be numbers, they are formatted by pFormat like printf does
+	*/
+	template <typename... Args>
+	void log(const char* pFormat, Args... args)
+	{
+		static_assert(sizeof...(Args) <= maxArguments, "too many log arguments");
+
+		Record record;
+		record.time = std::chrono::system_clock::now();
+		record.byteCount = m_byteCounter.load(std::memory_order_relaxed);
+		record.pFormat = pFormat;
+		record.pFormatFn = &formatRecord<Args...>;
+		storeArguments(record, std::index_sequence_for<Args...>(), args...);
+
+		if (!m_queue.tryPush(record))
+		{
+			m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	Formats all lines logged since the last call and appends them, separated by newlines, to text.
+	Only one thread may drain.
+	@returns the amount of lines appended
+	*/
+	size_t drain(std::string& text);
+
+	uint64_t getDroppedRecords() const { return m_droppedRecords.load(std::memory_order_relaxed); }
+
+private:
+	union Argument
+	{
+		long long i;
+		unsigned long long u;
+		double d;
+	};
+
+	struct Record;
+	typedef int (*FormatFn)(const Record& record, char* pBuffer, size_t size);
+
+	struct Record
+	{
+		std::chrono::system_clock::time_point time;
+		uint64_t byteCount;
+		const char* pFormat;
+		FormatFn pFormatFn;
+		Argument arguments[maxArguments];
+	};
+
+	template <typename T>
+	static Argument toArgument(T value)
+	{
+		static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "only numbers can be logged lazily");
+
+		Argument argument;
+		if (std::is_floating_point<T>::value)
+			argument.d = double(value);
+		else if (std::is_signed<T>::value)
+			argument.i = (long long)(value);
+		else
+			argument.u = (unsigned long long)(value);
+		return argument;
+	}
+
+	template <typename T>
+	static T fromArgument(const Argument& argument)
+	{
+		if (std::is_floating_point<T>::value)
+			return T(argument.d);
+		if (std::is_signed<T>::value)
+			return T(argument.i);
+		return T(argument.u);
+	}
+
+	template <size_t... Indices, typename... Args>
+	static void storeArguments(Record& record, std::index_sequence<Indices...>, Args... args)
+	{
+		const Argument arguments[] = { Argument(), toArgument(args)... };
+		for (size_t i = 0; i < sizeof...(Indices); ++i)
+		{
+			record.arguments[i] = arguments[i + 1];
+		}
+	}
+
+	template <typename... Args, size_t... Indices>
+	static int formatArguments(const Record& record, char* pBuffer, size_t size, std::index_sequence<Indices...>)
+	{
+		return snprintf(pBuffer, size, record.pFormat, fromArgument<Args>(record.arguments[Indices])...);
+	}
+
+	static int formatArguments(const Record& record, char* pBuffer, size_t size, std::index_sequence<>)
+	{
+		return snprintf(pBuffer, size, "%s", record.pFormat);
+	}
+
+	template <typename... Args>
+	static int formatRecord(const Record& record, char* pBuffer, size_t size)
+	{
+		return formatArguments<Args...>(record, pBuffer, size, std::index_sequence_for<Args...>());
+	}
+
+private:
+	const std::atomic_uint_fast64_t& m_byteCounter;
+
+	MpscQueue<Record, 1024> m_queue;
+	std::atomic<uint64_t> m_droppedRecords{0};
+	uint64_t m_reportedDroppedRecords = 0;
+};
+
+#endif // LOGSINK_H
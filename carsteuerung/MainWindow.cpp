@@ -1,56 +1,183 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 
-#include "InvokeInEventLoop.h"
-#include <Payload.h>
+#include <FrameCodec.h>
+#include <InvokeInEventLoop.h>
 
-#include <boost/algorithm/string.hpp>
-#include <QDateTime>
+#include <QTimer>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
 
 MainWindow::MainWindow(QWidget *parent) :
 	QMainWindow(parent),
     ui(new Ui::MainWindow),
-    receiveThread(std::bind(&MainWindow::worker, this))
+    m_frameParser(HostCommandDispatcher::getKnownCommands()),
+    m_frameSender(serialTransport, &m_recorder, &m_trafficCounters),
+    m_reliableLink([this](const Frame& frame) { m_frameSender.send(frame); },
+                   [this](const Frame& frame) { m_commandDispatcher.dispatch(frame); }),
+    m_framingNegotiation(serialTransport, m_frameSender, m_frameParser),
+    m_baudNegotiation(serialTransport, m_frameSender),
+    m_logSink(m_trafficCounters.getByteCounter(TelemetryDirection::Rx)),
+    receiveThread(std::bind(&MainWindow::worker, this)),
+    sendThread(std::bind(&MainWindow::sendWorker, this))
 {
 	ui->setupUi(this);
+
+	registerDisplayHandlers();
+	registerSwapHandlers();
+	registerLinkHandlers();
+	setSwapFile("mccar-swap.bin");
+
+	//collect the log lines of all threads once per display refresh
+	QTimer* pLogTimer = new QTimer(this);
+	connect(pLogTimer, &QTimer::timeout, this, &MainWindow::drainLog);
+	pLogTimer->start(16);
+
+	//statistics only need to be readable, not smooth
+	ui->latency->setSender(&m_frameSender);
+	QTimer* pStatisticsTimer = new QTimer(this);
+	connect(pStatisticsTimer, &QTimer::timeout, this, &MainWindow::updateStatistics);
+	pStatisticsTimer->start(500);
 }
 
 MainWindow::~MainWindow()
 {
-    serialStream.Close();
+    serialTransport.close();
     receiveThread.interrupt();
-    if (!receiveThread.timed_join(boost::posix_time::seconds(1)))
+    sendThread.interrupt();
+    replayThread.interrupt();
+    if (!receiveThread.timed_join(boost::posix_time::seconds(1)) || !sendThread.timed_join(boost::posix_time::seconds(1))
+            || (replayThread.joinable() && !replayThread.timed_join(boost::posix_time::seconds(1))))
     {
 		abort();
+    }
+    if (!m_latencyFile.empty())
+    {
+        ui->latency->dump(m_latencyFile);
     }
 	delete ui;
 }
 
-void MainWindow::printLog(QString text)
+void MainWindow::setLogFile(const std::string& path, size_t maxFileSize, unsigned fileCount)
+{
+    m_pLogFile.reset(new RotatingLogFile(path, maxFileSize, fileCount));
+}
+
+void MainWindow::setLatencyFile(const std::string& path)
+{
+    m_latencyFile = path;
+}
+
+void MainWindow::setMetricsFile(const std::string& path)
+{
+    m_metricsFile = path;
+}
+
+void MainWindow::setMaxBaudRate(uint32_t maxBaudRate)
+{
+    m_maxBaudRate = maxBaudRate;
+}
+
+void MainWindow::setCobsFraming(bool isEnabled)
 {
-    callFnDeferredSync(this, [=]
+    m_isCobsFramingEnabled = isEnabled;
+}
+
+void MainWindow::setSwapFile(const std::string& path)
+{
+    //256 buffers of up to 4 KiB, more than the RAM of the MC
+    if (!m_swapStore.open(path, 256, 4096))
     {
-        ui->log->appendPlainText(QString::number(byteCounter.load()) + ", " + QDateTime::currentDateTime().toString("hh:mm:ss.zzz") + ": " + text);
-    });
+        ui->log->appendPlainText("Failed to open swap file: " + QString::fromStdString(m_swapStore.getLastError()));
+    }
 }
 
-void MainWindow::on_connectButton_clicked()
+bool MainWindow::startRecording(const std::string& path)
 {
-	serialStream.Open(ui->serialPort->text().toStdString());
-	if (serialStream.IsOpen())
+    if (!m_recorder.start(path))
     {
-		//Set Config afterwards!!!
-		serialStream.SetBaudRate(LibSerial::SerialStreamBuf::BAUD_115200);
-		serialStream.SetNumOfStopBits(0);
-		serialStream.SetParity(LibSerial::SerialStreamBuf::PARITY_NONE);
-		serialStream.SetCharSize(LibSerial::SerialStreamBuf::CHAR_SIZE_8);
+        ui->log->appendPlainText("Failed to start recording: " + QString::fromStdString(m_recorder.getLastError()));
+        return false;
+    }
+    ui->log->appendPlainText("Recording to " + QString::fromStdString(path));
+    return true;
+}
 
+bool MainWindow::startReplay(const std::string& path, double speed)
+{
+    if (replayThread.joinable())
+    {
+        replayThread.interrupt();
+        replayThread.join();
+    }
+
+    if (!m_replayReader.open(path))
+    {
+        ui->log->appendPlainText("Failed to open capture: " + QString::fromStdString(m_replayReader.getLastError()));
+        return false;
+    }
+    ui->log->appendPlainText("Replaying " + QString::fromStdString(path) + " (" + QString::number(m_replayReader.getRecordCount()) + " records)");
+
+    replayThread = boost::thread(std::bind(&MainWindow::replayWorker, this, speed));
+    return true;
+}
+
+void MainWindow::drainLog()
+{
+    std::string text;
+    if (m_logSink.drain(text) == 0)
+        return;
+
+    ui->log->appendPlainText(QString::fromStdString(text));
+    if (m_pLogFile)
+    {
+        m_pLogFile->append(text + '\n');
+    }
+}
+
+void MainWindow::updateStatistics()
+{
+    const TrafficCounters::Snapshot snapshot = m_trafficCounters.getSnapshot();
+    m_trafficWindow.add(snapshot);
+
+    ui->latency->refresh();
+    const uint32_t baudRate = m_baudNegotiation.getBaudRate();
+    ui->traffic->refresh(snapshot, m_trafficWindow, baudRate);
+
+    if (!m_metricsFile.empty())
+    {
+        //a scraper reading the file while it is written must not see half of it
+        const std::string tempFile = m_metricsFile + ".tmp";
+        {
+            std::ofstream file(tempFile);
+            writePrometheusMetrics(file, snapshot, m_trafficWindow, baudRate);
+        }
+        std::rename(tempFile.c_str(), m_metricsFile.c_str());
+    }
+}
+
+void MainWindow::on_connectButton_clicked()
+{
+	if (serialTransport.open(ui->serialPort->text().toStdString(), BaudNegotiation::defaultBaudRate))
+    {
         ui->log->appendPlainText("Successfully opened serial port " + ui->serialPort->text());
         programState = ProgramState::Connected;
+
+        //the MC starts at the default rate and fixed framing after a reset as well
+        m_framingNegotiation.reset();
+        m_baudNegotiation.reset();
+        if (m_isCobsFramingEnabled)
+        {
+            m_framingNegotiation.start(Framing::Cobs);
+        }
+        m_isBaudNegotiationPending = m_maxBaudRate > BaudNegotiation::defaultBaudRate;
 	}
 	else
 	{
-		ui->log->appendPlainText("Failed to open serial port " + ui->serialPort->text());
+		ui->log->appendPlainText("Failed to open serial port " + ui->serialPort->text() + ": " + QString::fromStdString(serialTransport.getLastError()));
         programState = ProgramState::Disconnected;
 	}
     updateUi();
@@ -62,12 +189,12 @@ void MainWindow::updateUi()
 	{
 	case ProgramState::Disconnected:
         ui->connectButton->setEnabled(true);
-        ui->control->setStream(nullptr);
+        ui->control->setSender(nullptr);
 		break;
 
 	case ProgramState::Connected:
 		ui->connectButton->setEnabled(false);
-        ui->control->setStream(&serialStream);
+        ui->control->setSender(&m_frameSender);
 		break;
     }
 }
@@ -76,104 +203,243 @@ void MainWindow::worker()
 {
     for (;;)
     {
-        RestoreFlagsCheckpointContext savedFlags{serialStream};
-        serialStream.unsetf(std::ios_base::skipws);
-        if (serialStream.IsOpen())
+        boost::this_thread::interruption_point();
+
+        if (!serialTransport.isOpen())
         {
-            uint8_t cmd;
-            serialStream >> cmd;
-            if (cmd == NotifyVersionPayload::cmd_id)
-            {
-                RequestDataPacket<NotifyVersionPayload> data;
-                serialStream >> data;
-                printLog(QString("MC version: ") + QString::number(data.payload.version));
-            }
-            else if (cmd == WriteDataPayload::cmd_id)
+            serialTransport.waitUntilOpen();
+            continue;
+        }
+
+        //retransmissions and acks of the reliable lane and the steps of the negotiations are due from here,
+        //so do not wait past the next of them
+        const ReliableLink::Clock::time_point now = ReliableLink::Clock::now();
+        const uint32_t baudRateBefore = m_baudNegotiation.getBaudRate();
+        const Framing framingBefore = m_framingNegotiation.getFraming();
+        if (!m_framingNegotiation.isNegotiating() && m_isBaudNegotiationPending.exchange(false))
+        {
+            m_baudNegotiation.start(m_maxBaudRate, now);
+        }
+        const ReliableLink::Clock::time_point next = std::min({ m_reliableLink.poll(now), m_framingNegotiation.poll(now), m_baudNegotiation.poll(now) });
+        const int64_t timeoutMs = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+
+        //read whatever has arrived straight into the receive ring
+        size_t freeSpace;
+        uint8_t* pReceiveBuffer = m_frameParser.getWritePointer(freeSpace);
+        m_frameParser.commitWrite(serialTransport.read(pReceiveBuffer, freeSpace, int(std::max<int64_t>(1, std::min<int64_t>(100, timeoutMs)))));
+        if (serialTransport.isHungUp())
+        {
+            //the log sink takes numbers only
+            const QString error = QString::fromStdString(serialTransport.getLastError());
+            callFnDeferredAsync(this, [this, error]()
             {
-                RequestDataPacket<WriteDataPayload> data;
-                serialStream >> data;
-
-				uint16_t bufferNo = data.payload.bufferNoHigh << 8 | data.payload.bufferNoLow;
-				uint16_t offset = data.payload.offsetHigh << 8 | data.payload.offsetLow;
-				printLog(QString("receiving data for buffer ") + QString::number(bufferNo) + " (offset: " + QString::number(offset) + ") ...");
-				if (offset != m_swapCache[bufferNo].size())
-                {
-					m_swapCache[bufferNo].clear();
-                }
-
-                for (auto entry : data.payload.data)
-                {
-					m_swapCache[bufferNo].push_back(entry);
-                }
-            }
-            else if (cmd == RequestDataPayload::cmd_id)
+                ui->log->appendPlainText("Serial port closed: " + error);
+                programState = ProgramState::Disconnected;
+                updateUi();
+            });
+            continue;
+        }
+
+        const uint64_t discardedBytesBefore = m_frameParser.getDiscardedBytes();
+        const uint64_t resyncEventsBefore = m_frameParser.getResyncEvents();
+        const uint64_t unknownCommandsBefore = m_frameParser.getUnknownCommands();
+        Frame frame;
+        bool checksumIsOk;
+        while (m_frameParser.nextFrame(frame, checksumIsOk))
+        {
+            m_trafficCounters.countFrame(TelemetryDirection::Rx, frame, checksumIsOk, m_frameParser.getLastFrameWireSize());
+            m_recorder.record(TelemetryDirection::Rx, 0, frame);
+            m_framingNegotiation.countFrame(checksumIsOk);
+            m_baudNegotiation.countFrame(checksumIsOk);
+            //counted above, but the handlers must not act on a broken frame
+            if (checksumIsOk)
             {
-                RequestDataPacket<RequestDataPayload> data;
-                serialStream >> data;
-
-				uint16_t bufferNo = data.payload.bufferNoHigh << 8 | data.payload.bufferNoLow;
-				const auto& relevantCache = m_swapCache[bufferNo];
-                uint8_t i = 0;
-                while (i < relevantCache.size())
-                {
-                    HandleRequestedDataPayload payload;
-					payload.bufferNoHigh = data.payload.bufferNoHigh;
-					payload.bufferNoLow = data.payload.bufferNoLow;
-                    for (uint8_t j = 0; j < sizeof(payload.data) && i < relevantCache.size(); ++i, ++j)
-                    {
-                        payload.data[j] = relevantCache[i];
-                    }
-					printLog(QString("sending buffer no ") + QString::number(bufferNo) + "...");
-					serialStream << RequestDataPacket<HandleRequestedDataPayload>(payload);
-                }
-                printLog(QString("...buffer sent"));
+                m_commandDispatcher.dispatch(frame);
             }
-			else if (cmd == ResourcePayload::cmd_id)
-			{
-				RequestDataPacket<ResourcePayload> data;
-				serialStream >> data;
+        }
 
-				ui->resourceStatus->update(data.payload);
-			}
-			else if (cmd == StatusPayload::cmd_id)
-			{
-				RequestDataPacket<StatusPayload> data;
-				serialStream >> data;
+        if (m_framingNegotiation.getFraming() != framingBefore)
+        {
+            printLog("link switched to framing %u (0: fixed, 1: COBS)", unsigned(m_framingNegotiation.getFraming()));
+        }
+        if (m_baudNegotiation.getBaudRate() != baudRateBefore)
+        {
+            printLog("link switched to %u baud", unsigned(m_baudNegotiation.getBaudRate()));
+        }
 
-				ui->commonStatus->update(data.payload);
-			}
-            else
-            {
-                std::vector<std::string> unknownData(getPayloadSize());
-                for (size_t i = 0; i < getPayloadSize(); ++i)
-                {
-                    uint8_t val;
-                    serialStream >> val;
-                    unknownData[i] = std::to_string(uint32_t(val));
-                }
-                uint8_t crc;
-                serialStream >> crc;
-                std::string unknownDataString = boost::algorithm::join(unknownData, " ");
-                printLog(QString("unknown command received: " + QString::number(cmd) + " [") + QString::fromStdString(unknownDataString) + "] crc: " + QString::number(crc));
-            }
-            byteCounter += 8;
+        m_trafficCounters.countUnknownCommands(m_frameParser.getUnknownCommands() - unknownCommandsBefore);
+        m_trafficCounters.countResyncEvents(m_frameParser.getResyncEvents() - resyncEventsBefore);
+        if (m_frameParser.getDiscardedBytes() != discardedBytesBefore)
+        {
+            m_trafficCounters.countDiscardedBytes(m_frameParser.getDiscardedBytes() - discardedBytesBefore);
+            printLog("resynchronizing, discarded %" PRIu64 " bytes (resyncs: %" PRIu64 ")",
+                     m_frameParser.getDiscardedBytes() - discardedBytesBefore, m_frameParser.getResyncEvents());
         }
-        else
+    }
+}
+
+void MainWindow::sendWorker()
+{
+    m_frameSender.run();
+}
+
+void MainWindow::replayWorker(double speed)
+{
+    //the handlers are not meant to run on two threads, so replay only while no car is connected
+    CaptureReplay replay(m_commandDispatcher);
+    const CaptureReplay::Report report = replay.run(m_replayReader, speed > 0 ? CaptureReplay::Mode::Scaled : CaptureReplay::Mode::AsFastAsPossible, speed);
+
+    printLog("replay finished: %" PRIu64 " frames in %.3f s (%.0f frames/s), %" PRIu64 " divergent, %" PRIu64 " resyncs, %" PRIu64 " checksum failures",
+             report.dispatchedFrames, report.seconds, report.getFramesPerSecond(), report.divergentFrames, report.resyncEvents, report.checksumFailures);
+    for (size_t cmd = 0; cmd < report.commands.size(); ++cmd)
+    {
+        const CaptureReplay::CommandStatistics& statistics = report.commands[cmd];
+        if (statistics.frames > 0)
         {
-            boost::this_thread::sleep(boost::posix_time::seconds(2));
+            printLog("  cmd 0x%02x: %" PRIu64 " frames, %.0f ns/frame in handlers", unsigned(cmd), statistics.frames, double(statistics.nanoseconds) / statistics.frames);
         }
     }
 }
 
+void MainWindow::registerDisplayHandlers()
+{
+	m_commandDispatcher.registerHandler<NotifyVersionPayload>([this](const RequestDataPacket<NotifyVersionPayload>& data)
+	{
+		printLog("MC version: %u", data.payload.version);
+	});
+
+	m_commandDispatcher.registerHandler<ResourcePayload>([this](const RequestDataPacket<ResourcePayload>& data)
+	{
+		ui->resourceStatus->update(data.payload);
+	});
+
+	m_commandDispatcher.registerHandler<StatusPayload>([this](const RequestDataPacket<StatusPayload>& data)
+	{
+		ui->commonStatus->update(data.payload);
+	});
+
+	m_commandDispatcher.setUnknownCommandHandler([this](ConstByteSpan frame)
+	{
+		static_assert(getFrameSize() == 12, "log format expects 10 payload bytes");
+		printLog("unknown command received: %u [%u %u %u %u %u %u %u %u %u %u] crc: %u", getFrameCommand(frame),
+				 frame[1], frame[2], frame[3], frame[4], frame[5], frame[6], frame[7], frame[8], frame[9], frame[10], frame[11]);
+	});
+}
+
+void MainWindow::registerLinkHandlers()
+{
+	m_commandDispatcher.registerHandler<FramingAcceptPayload>([this](const RequestDataPacket<FramingAcceptPayload>& data)
+	{
+		m_framingNegotiation.receive(data);
+	});
+
+	m_commandDispatcher.registerHandler<BaudAcceptPayload>([this](const RequestDataPacket<BaudAcceptPayload>& data)
+	{
+		m_baudNegotiation.receive(data);
+	});
+
+	m_commandDispatcher.registerHandler<BaudProbePayload>([this](const RequestDataPacket<BaudProbePayload>& data)
+	{
+		m_baudNegotiation.receive(data);
+	});
+
+	m_commandDispatcher.registerHandler<BaudCommitPayload>([this](const RequestDataPacket<BaudCommitPayload>& data)
+	{
+		m_baudNegotiation.receive(data);
+	});
+}
+
+void MainWindow::appendSwapData(uint16_t bufferNo, uint16_t offset, ConstByteSpan data)
+{
+	printLog("receiving data for buffer %u (offset: %u) ...", bufferNo, offset);
+
+	switch (m_swapStore.append(bufferNo, offset, data))
+	{
+	case SwapStore::AppendResult::Appended:
+		break;
+	case SwapStore::AppendResult::OutOfOrder:
+		printLog("buffer %u: chunk at offset %u does not continue the buffer, dropped it", bufferNo, offset);
+		break;
+	case SwapStore::AppendResult::QuotaExceeded:
+		printLog("buffer %u: exceeds %u bytes, dropped it", bufferNo, m_swapStore.getSlotSize());
+		break;
+	case SwapStore::AppendResult::NotOpen:
+		printLog("buffer %u: no swap file", bufferNo);
+		break;
+	}
+}
+
+void MainWindow::registerSwapHandlers()
+{
+	m_commandDispatcher.registerHandler<ReliablePayload>([this](const RequestDataPacket<ReliablePayload>& data)
+	{
+		m_reliableLink.receive(data);
+	});
+
+	m_commandDispatcher.registerHandler<AckPayload>([this](const RequestDataPacket<AckPayload>& data)
+	{
+		m_reliableLink.receive(data);
+	});
+
+	m_commandDispatcher.registerHandler<WriteDataPayload>([this](const RequestDataPacket<WriteDataPayload>& data)
+	{
+		uint16_t bufferNo = data.payload.bufferNoHigh << 8 | data.payload.bufferNoLow;
+		uint16_t offset = data.payload.offsetHigh << 8 | data.payload.offsetLow;
+		appendSwapData(bufferNo, offset, ConstByteSpan(data.payload.data, sizeof(data.payload.data)));
+	});
+
+	//the reliable lane delivers the chunks in order, each continues the buffer
+	m_commandDispatcher.registerHandler<ReliableWriteDataPayload>([this](const RequestDataPacket<ReliableWriteDataPayload>& data)
+	{
+		const bool isFirstChunk = data.payload.bufferNoHigh & ReliableWriteDataPayload::firstChunk;
+		uint16_t bufferNo = (data.payload.bufferNoHigh & ~ReliableWriteDataPayload::firstChunk) << 8 | data.payload.bufferNoLow;
+		uint16_t offset = isFirstChunk ? 0 : uint16_t(m_swapStore.read(bufferNo).size());
+		appendSwapData(bufferNo, offset, ConstByteSpan(data.payload.data, sizeof(data.payload.data)));
+	});
+
+	m_commandDispatcher.registerHandler<RequestDataPayload>([this](const RequestDataPacket<RequestDataPayload>& data)
+	{
+		uint16_t bufferNo = data.payload.bufferNoHigh << 8 | data.payload.bufferNoLow;
+		const ConstByteSpan buffer = m_swapStore.read(bufferNo);
+
+		//the transmit thread coalesces the chunks into as few writes as possible
+		printLog("sending buffer no %u...", bufferNo);
+		if (m_reliableLink.isPeerReliable())
+		{
+			const size_t chunkSize = sizeof(ReliableHandleRequestedDataPayload::data);
+			for (size_t i = 0; i < buffer.size(); i += chunkSize)
+			{
+				ReliableHandleRequestedDataPayload payload;
+				payload.bufferNoHigh = data.payload.bufferNoHigh;
+				payload.bufferNoLow = data.payload.bufferNoLow;
+				std::copy(buffer.begin() + i, buffer.begin() + std::min(i + chunkSize, buffer.size()), payload.data);
+				m_reliableLink.send(RequestDataPacket<ReliableHandleRequestedDataPayload>(payload));
+			}
+		}
+		else
+		{
+			const size_t chunkSize = sizeof(HandleRequestedDataPayload::data);
+			for (size_t i = 0; i < buffer.size(); i += chunkSize)
+			{
+				HandleRequestedDataPayload payload;
+				payload.bufferNoHigh = data.payload.bufferNoHigh;
+				payload.bufferNoLow = data.payload.bufferNoLow;
+				std::copy(buffer.begin() + i, buffer.begin() + std::min(i + chunkSize, buffer.size()), payload.data);
+				m_frameSender.send(RequestDataPacket<HandleRequestedDataPayload>(payload));
+			}
+		}
+		printLog("...buffer queued");
+	});
+}
+
 void MainWindow::on_echoTestButton_clicked()
 {
 	//serialStream << RequestDataPacket<NotifyVersionPayload>(NotifyVersionPayload{1});
-	printLog(QString() + "Start sending...");
+	printLog("Start sending...");
+	const Frame frame = encodeFrame(RequestDataPacket<NotifyVersionPayload>(NotifyVersionPayload{1}));
 	for (int i = 0; i < 20; ++i)
 	{
-		QApplication::processEvents();
-		serialStream << RequestDataPacket<NotifyVersionPayload>(NotifyVersionPayload{1});
-
+		m_frameSender.send(frame);
 	}
-	printLog(QString() + "...sent");
+	printLog("...queued");
 }
@@ -6,9 +6,23 @@
 
 #include <QMainWindow>
 
-#include <atomic>
+#include "BaudNegotiation.h"
+#include "CaptureReplay.h"
+#include "CommandDispatcher.h"
+#include "FrameParser.h"
+#include "FrameSender.h"
+#include "FramingNegotiation.h"
+#include "LogSink.h"
+#include "ReliableLink.h"
+#include "RotatingLogFile.h"
+#include "SwapStore.h"
+#include "TelemetryReader.h"
+#include "TelemetryRecorder.h"
+#include "TrafficCounters.h"
+#include "SerialTransport.h"
 
-#include <SerialStream.h>
+#include <atomic>
+#include <memory>
 
 namespace Ui {
 class MainWindow;
@@ -28,27 +42,99 @@ public:
 	explicit MainWindow(QWidget *parent = 0);
 	~MainWindow();
 
+	/**
+	Additionally writes the log to path, rotating through fileCount files of at most maxFileSize bytes
+	*/
+	void setLogFile(const std::string& path, size_t maxFileSize = 10 * 1024 * 1024, unsigned fileCount = 5);
+
+	/**
+	Keeps the swapped out buffers of the MC in path, replacing the default mccar-swap.bin
+	*/
+	void setSwapFile(const std::string& path);
+
+	/**
+	Records every frame sent and received to a telemetry capture at path
+	*/
+	bool startRecording(const std::string& path);
+
+	/**
+	Writes the keypress to wire latency histograms to path when the window is closed
+	*/
+	void setLatencyFile(const std::string& path);
+
+	/**
+	Periodically writes the traffic counters to path in the Prometheus text format, replacing the file each time
+	*/
+	void setMetricsFile(const std::string& path);
+
+	/**
+	Feeds the frames received in a capture to the display and swap handlers instead of a serial port.
+	@param speed factor on the recorded timing, 0 replays as fast as possible
+	*/
+	bool startReplay(const std::string& path, double speed);
+
+	/**
+	Negotiates the fastest rate up to maxBaudRate with the MC after connecting, the link starts at
+	BaudNegotiation::defaultBaudRate either way
+	*/
+	void setMaxBaudRate(uint32_t maxBaudRate);
+
+	/**
+	Negotiates COBS framing with the MC after connecting unless disabled, see FrameCodec.h
+	*/
+	void setCobsFraming(bool isEnabled);
+
 private slots:
 	void on_connectButton_clicked();
 	void on_echoTestButton_clicked();
 
 private:
-    void printLog(QString text);
+    template <typename... Args>
+    void printLog(const char* pFormat, Args... args)
+    {
+        m_logSink.log(pFormat, args...);
+    }
+    void drainLog();
+    void updateStatistics();
 	void updateUi();
     void worker();
+    void registerDisplayHandlers();
+    void registerSwapHandlers();
+    void registerLinkHandlers();
+    void appendSwapData(uint16_t bufferNo, uint16_t offset, ConstByteSpan data);
     void sendWorker();
+    void replayWorker(double speed);
 
 private:
 	Ui::MainWindow *ui;
 
 	ProgramState programState;
-	LibSerial::SerialStream serialStream;
+	SerialTransport serialTransport;
+
+    SwapStore m_swapStore;
+    HostCommandDispatcher m_commandDispatcher;
+    FrameParser m_frameParser;
+    TelemetryRecorder m_recorder;
+    TrafficCounters m_trafficCounters;
+    TrafficWindow m_trafficWindow;
+    FrameSender m_frameSender;
+    ReliableLink m_reliableLink;
+    FramingNegotiation m_framingNegotiation;
+    BaudNegotiation m_baudNegotiation;
+    uint32_t m_maxBaudRate = BaudNegotiation::defaultBaudRate;
+    bool m_isCobsFramingEnabled = true;
+    std::atomic<bool> m_isBaudNegotiationPending{false}; //waits for the framing negotiation, both hold back the sender
+
+    LogSink m_logSink;
+    std::unique_ptr<RotatingLogFile> m_pLogFile;
+    std::string m_latencyFile;
+    std::string m_metricsFile;
 
-    std::map<uint8_t, std::vector<uint8_t>> m_swapCache;
+    TelemetryReader m_replayReader;
 
     boost::thread receiveThread;
     boost::thread sendThread;
-    std::atomic_uint_fast64_t byteCounter{0};
+    boost::thread replayThread;
 };
 
 #endif // MAINWINDOW_H
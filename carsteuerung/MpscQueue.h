@@ -0,0 +1,108 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+Bounded lock-free queue for any number of producer threads and a single consumer thread.
+
+Every cell carries a sequence number telling whether it is free for the producer at a given position
+or holds a value for the consumer, so producers only contend on the enqueue position.
+*/
+template <typename T, size_t Capacity>
+class MpscQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity has to be a power of two");
+
+public:
+	MpscQueue()
+	{
+		for (size_t i = 0; i < Capacity; ++i)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator =(const MpscQueue&) = delete;
+
+	/**
+	Callable from any thread
+	@returns false if the queue is full
+	*/
+	template <typename U>
+	bool tryPush(U&& value)
+	{
+		size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+		Cell* pCell;
+		for (;;)
+		{
+			pCell = &m_cells[pos & (Capacity - 1)];
+			const size_t sequence = pCell->sequence.load(std::memory_order_acquire);
+			const intptr_t difference = intptr_t(sequence) - intptr_t(pos);
+			if (difference == 0)
+			{
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		pCell->value = std::forward<U>(value);
+		pCell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	Consumer thread only
+	@returns false if the queue is empty
+	*/
+	bool tryPop(T& value)
+	{
+		Cell& cell = m_cells[m_dequeuePos & (Capacity - 1)];
+		if (cell.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1)
+			return false;
+
+		value = std::move(cell.value);
+		cell.sequence.store(m_dequeuePos + Capacity, std::memory_order_release);
+		++m_dequeuePos;
+		return true;
+	}
+
+	/**
+	Consumer thread only. A value a producer is still writing does not count yet.
+	*/
+	bool isEmpty() const
+	{
+		return m_cells[m_dequeuePos & (Capacity - 1)].sequence.load(std::memory_order_acquire) != m_dequeuePos + 1;
+	}
+
+	static constexpr size_t getCapacity() { return Capacity; }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	//keep producers and the consumer off each other's cache lines
+	std::array<Cell, Capacity> m_cells;
+	uint8_t m_padding0[64];
+	std::atomic<size_t> m_enqueuePos{0};
+	uint8_t m_padding1[64];
+	size_t m_dequeuePos = 0;
+};
+
+#endif // MPSCQUEUE_H
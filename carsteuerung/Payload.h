@@ -1,8 +1,9 @@
 #ifndef Payload_H
 #define Payload_H
 
-#include <boost/crc.hpp>
-#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 
 constexpr size_t getPayloadSize() { return 10 /*+cmd +crc*/; }
 
@@ -73,147 +74,6 @@ public:
 	bool ack;
 };
 
-class RestoreFlagsCheckpointContext
-{
-public:
-	explicit RestoreFlagsCheckpointContext(std::ios_base& strm)
-		: strm(strm)
-	{
-		//state.copyfmt(strm);
-	}
-
-	~RestoreFlagsCheckpointContext()
-	{
-		//strm.copyfmt(state);
-	}
-
-private:
-	std::ios_base& strm;
-	//std::ios state;
-};
-
-using crc_8 = boost::crc_optimal<8, 0x9B, 0, 0, false, false>;
-
-template <typename Payload>
-void writePayloadToStream(std::ostream& strm, crc_8& crc, const Payload& payload)
-{
-	RestoreFlagsCheckpointContext savedFlags{strm};
-	strm.unsetf(std::ios_base::skipws);
-
-	const unsigned char* pRawData = reinterpret_cast<const unsigned char*>(&payload);
-
-	//data
-	for (size_t i = 0; i < sizeof(Payload); ++i)
-	{
-		strm << pRawData[i];
-		crc.process_byte(pRawData[i]);
-	}
-
-	//Padding
-	for (size_t i = 0; i < (getPayloadSize() - sizeof(Payload)); ++i)
-	{
-		strm << static_cast<unsigned char>(0);
-		crc.process_byte(0);
-	}
-}
-
-template <typename Payload>
-void readPayloadFromStream(std::istream& strm, crc_8& crc, Payload& payload)
-{
-	RestoreFlagsCheckpointContext savedFlags{strm};
-	strm.unsetf(std::ios_base::skipws);
-
-	unsigned char* pRawData = reinterpret_cast<unsigned char*>(&payload);
-
-	//data
-	for (size_t i = 0; i < sizeof(Payload); ++i)
-	{
-		unsigned char tmp;
-		strm >> tmp;
-		pRawData[i] = tmp;
-		crc.process_byte(pRawData[i]);
-	}
-
-	//Padding
-	for (size_t i = 0; i < (getPayloadSize() - sizeof(Payload)); ++i)
-	{
-		unsigned char padding;
-		strm >> padding;
-		crc.process_byte(padding);
-	}
-}
-
-template <typename Payload>
-std::ostream& operator <<(std::ostream& strm, const RequestDataPacket<Payload>& dataPacket)
-{
-	RestoreFlagsCheckpointContext savedFlags{strm};
-	strm.unsetf(std::ios_base::skipws);
-
-	crc_8 crc;
-
-	strm << static_cast<unsigned char>(Payload::cmd_id);
-
-	writePayloadToStream(strm, crc, dataPacket.payload);
-
-	//checksum
-	strm << static_cast<unsigned char>(crc.checksum());
-
-	return strm;
-}
-
-template <typename Payload>
-std::istream& operator >>(std::istream& strm, RequestDataPacket<Payload>& dataPacket)
-{
-	RestoreFlagsCheckpointContext savedFlags{strm};
-	strm.unsetf(std::ios_base::skipws);
-
-    crc_8 crc;
-
-	readPayloadFromStream(strm, crc, dataPacket.payload);
-
-	//checksum
-	unsigned char slaveCalculatedCrc;
-	strm >> slaveCalculatedCrc;
-	dataPacket.checksumIsOk = static_cast<unsigned char>(crc.checksum()) == slaveCalculatedCrc;
-
-	return strm;
-}
-
-
-template <typename Payload>
-std::ostream& operator <<(std::ostream& strm, const ResponseDataPacket<Payload>& dataPacket)
-{
-	crc_8 crc;
-
-	strm << (dataPacket.ack ? (unsigned char)(1) : (unsigned char)(0));
-
-	writePayloadToStream(strm, crc, dataPacket.payload);
-
-	//checksum
-	strm << static_cast<unsigned char>(crc.checksum());
-
-	return strm;
-}
-
-template <typename Payload>
-std::istream& operator >>(std::istream& strm, ResponseDataPacket<Payload>& dataPacket)
-{
-	crc_8 crc;
-
-	unsigned char ack;
-	strm >> ack;
-	dataPacket.ack = ack;
-
-	readPayloadFromStream(strm, crc, dataPacket.payload);
-
-	//checksum
-	unsigned char slaveCalculatedCrc;
-	strm >> slaveCalculatedCrc;
-	dataPacket.checksumIsOk = static_cast<unsigned char>(crc.checksum()) == slaveCalculatedCrc;
-
-	return strm;
-}
-
 struct __attribute__ ((packed)) MovePayload
 {
     enum { cmd_id = 0x01 };
@@ -299,21 +159,144 @@ struct __attribute__ ((packed)) HandleRequestedDataPayload
 	uint8_t data[getPayloadSize() - 2] = {};
 };
 
+/**
+A command sent on the reliable lane, see ReliableLink
+*/
+struct __attribute__ ((packed)) ReliablePayload
+{
+	enum { cmd_id = 0x12 };
+	uint8_t seq;
+	uint8_t cmd;
+	uint8_t data[getPayloadSize() - 2];
+};
+
+struct __attribute__ ((packed)) AckPayload
+{
+	enum { cmd_id = 0x13 };
+	enum Flags
+	{
+		sync = 0x01,		///< the sender starts over at nextSeq
+		syncAck = 0x02,		///< answers the sync for nextSeq
+		resync = 0x04		///< the receiver got no sync, the sender has to send one
+	};
+	uint8_t flags;
+	uint8_t nextSeq;		///< everything before has arrived
+	uint8_t selectiveAcks;	///< bit i: nextSeq + 1 + i has arrived as well
+};
+
+/**
+WriteData on the reliable lane: the chunks arrive in order, so the offset is implied
+*/
+struct __attribute__ ((packed)) ReliableWriteDataPayload
+{
+	enum { cmd_id = 0x14 };
+	enum { firstChunk = 0x80 };	///< in bufferNoHigh, starts the buffer over
+	uint8_t bufferNoHigh;
+	uint8_t bufferNoLow;
+	uint8_t data[getPayloadSize() - 4];
+};
+
+/**
+HandleRequestedData on the reliable lane
+*/
+struct __attribute__ ((packed)) ReliableHandleRequestedDataPayload
+{
+	enum { cmd_id = 0x15 };
+	uint8_t bufferNoHigh;
+	uint8_t bufferNoLow;
+	uint8_t data[getPayloadSize() - 4] = {};
+};
+
+/**
+The rate of SCI1 as 24 bit value, used by the baud rate negotiation, see BaudNegotiation
+*/
+struct __attribute__ ((packed)) BaudRateField
+{
+	uint32_t baudRate() const { return uint32_t(baudRateH) << 16 | baudRateM << 8 | baudRateL; }
+	void setBaudRate(uint32_t baudRate)
+	{
+		baudRateH = uint8_t(baudRate >> 16);
+		baudRateM = uint8_t(baudRate >> 8);
+		baudRateL = uint8_t(baudRate);
+	}
+
+	uint8_t baudRateH;
+	uint8_t baudRateM;
+	uint8_t baudRateL;
+};
+
+struct __attribute__ ((packed)) BaudProposePayload : BaudRateField
+{
+	enum { cmd_id = 0x16 };
+};
+
+struct __attribute__ ((packed)) BaudAcceptPayload : BaudRateField
+{
+	enum { cmd_id = 0x17 };
+	uint8_t accepted;		///< if so, the MC has switched right after this frame
+};
+
+/**
+Sent in a burst at the new rate, the MC echoes every one that arrives intact
+*/
+struct __attribute__ ((packed)) BaudProbePayload
+{
+	enum { cmd_id = 0x18 };
+	uint8_t seq;
+	uint8_t pattern[getPayloadSize() - 1];
+};
+
+/**
+Keeps the new rate, the MC echoes it
+*/
+struct __attribute__ ((packed)) BaudCommitPayload : BaudRateField
+{
+	enum { cmd_id = 0x19 };
+	uint8_t accepted;		///< set in the echo
+};
+
+/**
+Switches both directions to another framing, a Framing of FrameCodec.h, see FramingNegotiation
+*/
+struct __attribute__ ((packed)) FramingProposePayload
+{
+	enum { cmd_id = 0x1A };
+	uint8_t framing;
+};
+
+struct __attribute__ ((packed)) FramingAcceptPayload
+{
+	enum { cmd_id = 0x1B };
+	uint8_t framing;
+	uint8_t accepted;		///< if so, the MC has switched right after this frame
+};
+
 struct __attribute__ ((packed)) NotifyVersionPayload
 {
     enum { cmd_id = 0x10 };
     uint8_t version;
 };
 
+/**
+The MC runs its tasks in three priorities, control before communication before background, see scheduler.h of the firmware
+*/
 struct __attribute__ ((packed)) ResourcePayload
 {
 	enum { cmd_id = 0x0d };
-	uint8_t taskQueueLoad;
+	uint8_t queuedControlTasks() const { return taskQueueLoad - queuedCommunicationTasks() - queuedBackgroundTasks(); }
+	uint8_t queuedCommunicationTasks() const { return queuedTasks >> 4; }
+	uint8_t queuedBackgroundTasks() const { return queuedTasks & 0x0f; }
+
+	uint8_t taskQueueLoad;		///< one-shot tasks of all priorities
 	uint8_t usedPages;
 	uint8_t freePages;
 	uint8_t pageSize;
 	uint8_t usedReceiveQueue;
 	uint8_t freeReceiveQueue;
+	uint8_t maxControlTaskWait;		///< ms since the last Resource, 255 for longer
+	uint8_t maxCommunicationTaskWait;
+	uint8_t maxBackgroundTaskWait;
+	uint8_t queuedTasks;		///< communication << 4 | background, 15 at most each
 };
 
 struct __attribute__ ((packed)) StatusPayload
@@ -0,0 +1,343 @@
+#include "ReliableLink.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+const ReliableLink::Clock::duration initialTimeout = std::chrono::milliseconds(500);
+const ReliableLink::Clock::duration minTimeout = std::chrono::milliseconds(50);
+const ReliableLink::Clock::duration maxTimeout = std::chrono::milliseconds(4000);
+
+//poll() is called at least this often anyway
+const ReliableLink::Clock::duration idlePollInterval = std::chrono::milliseconds(100);
+
+}
+
+ReliableLink::ReliableLink(SendFunction fnSend, DeliverFunction fnDeliver)
+	: m_fnSend(std::move(fnSend))
+	, m_fnDeliver(std::move(fnDeliver))
+	, m_timeout(initialTimeout)
+{
+}
+
+void ReliableLink::send(const Frame& frame, Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	SendSlot slot;
+	std::copy(frame.begin(), frame.begin() + slot.command.size(), slot.command.begin());
+	m_sendQueue.push_back(slot);
+
+	if (m_senderState == SenderState::Unsynchronized)
+	{
+		startSync(now);
+	}
+	else if (m_senderState == SenderState::Synchronized && m_sendQueue.size() <= windowSize)
+	{
+		transmit(uint8_t(m_sendBase + m_sendQueue.size() - 1), now);
+	}
+}
+
+void ReliableLink::receive(const RequestDataPacket<ReliablePayload>& data, Clock::time_point now)
+{
+	(void)now;
+	std::vector<Frame> delivered;
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		if (!data.checksumIsOk)
+		{
+			++m_statistics.checksumFailures;
+			return;
+		}
+
+		if (!m_isReceiverSynchronized)
+		{
+			sendAck(AckPayload::resync, 0);
+			return;
+		}
+
+		//a duplicate or a frame beyond the window is acknowledged again only, so the sender learns what arrived
+		m_isAckPending = true;
+		const uint8_t seq = data.payload.seq;
+		if (uint8_t(seq - m_receiveBase) >= windowSize)
+		{
+			++m_statistics.duplicates;
+			return;
+		}
+
+		const uint8_t bit = uint8_t(1 << (seq % windowSize));
+		if (m_receivedMask & bit)
+		{
+			++m_statistics.duplicates;
+		}
+		else
+		{
+			Command& command = m_received[seq % windowSize];
+			command[0] = data.payload.cmd;
+			std::copy(data.payload.data, data.payload.data + maxDataSize, command.begin() + 1);
+			m_receivedMask |= bit;
+		}
+
+		while (m_receivedMask & (1 << (m_receiveBase % windowSize)))
+		{
+			const Command& command = m_received[m_receiveBase % windowSize];
+			Frame frame = {};
+			std::copy(command.begin(), command.end(), frame.begin());
+			frame[getFrameSize() - 1] = calculateFrameChecksum(frame.data());
+			delivered.push_back(frame);
+
+			m_receivedMask &= ~(1 << (m_receiveBase % windowSize));
+			++m_receiveBase;
+			++m_statistics.deliveredFrames;
+		}
+	}
+
+	//the handlers may send reliably themselves
+	for (const Frame& frame : delivered)
+	{
+		m_fnDeliver(frame);
+	}
+}
+
+void ReliableLink::receive(const RequestDataPacket<AckPayload>& data, Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (!data.checksumIsOk)
+	{
+		++m_statistics.checksumFailures;
+		return;
+	}
+
+	const AckPayload& ack = data.payload;
+	if (ack.flags & AckPayload::sync)
+	{
+		//the peer's sender starts over, whatever was buffered belongs to its previous run
+		m_isReceiverSynchronized = true;
+		m_receiveBase = ack.nextSeq;
+		m_receivedMask = 0;
+		sendAck(AckPayload::syncAck, ack.nextSeq);
+		return;
+	}
+
+	if (ack.flags & AckPayload::syncAck)
+	{
+		if (m_senderState == SenderState::Syncing && ack.nextSeq == m_sendBase)
+		{
+			//the receiver lost everything not acknowledged, all of it goes out again
+			for (SendSlot& slot : m_sendQueue)
+			{
+				slot.transmissions = 0;
+				slot.isAcked = false;
+			}
+			m_senderState = SenderState::Synchronized;
+		}
+		return;
+	}
+
+	if (ack.flags & AckPayload::resync)
+	{
+		if (m_senderState == SenderState::Synchronized)
+		{
+			startSync(now);
+		}
+		return;
+	}
+
+	if (m_senderState != SenderState::Synchronized)
+		return;
+
+	//everything before nextSeq has arrived
+	const uint8_t acknowledged = uint8_t(ack.nextSeq - m_sendBase);
+	if (acknowledged <= m_sendQueue.size())
+	{
+		for (uint8_t i = 0; i < acknowledged; ++i)
+		{
+			acknowledge(m_sendQueue.front(), now);
+			m_sendQueue.pop_front();
+			++m_sendBase;
+		}
+	}
+
+	//and the frames after it marked in the bitmap
+	uint8_t lastAcked = m_sendBase;
+	for (uint8_t i = 0; i < windowSize - 1; ++i)
+	{
+		const uint8_t seq = uint8_t(ack.nextSeq + 1 + i);
+		SendSlot* pSlot = getSlot(seq);
+		if ((ack.selectiveAcks & (1 << i)) && pSlot)
+		{
+			acknowledge(*pSlot, now);
+			lastAcked = seq;
+		}
+	}
+
+	//a frame missing before one that arrived is probably lost, unless it was sent less than a round trip ago
+	for (uint8_t seq = m_sendBase; seq != lastAcked; ++seq)
+	{
+		const SendSlot& slot = *getSlot(seq);
+		if (!slot.isAcked && slot.transmissions > 0 && now - slot.sentAt >= m_smoothedRoundTrip)
+		{
+			transmit(seq, now);
+		}
+	}
+}
+
+ReliableLink::Clock::time_point ReliableLink::poll(Clock::time_point now)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	Clock::time_point next = now + idlePollInterval;
+	if (m_senderState == SenderState::Syncing)
+	{
+		if (now - m_syncSentAt >= m_timeout)
+		{
+			backOff();
+			startSync(now);
+		}
+		next = std::min(next, m_syncSentAt + m_timeout);
+	}
+	else if (m_senderState == SenderState::Synchronized)
+	{
+		bool hasTimedOut = false;
+		const size_t inFlight = std::min<size_t>(m_sendQueue.size(), windowSize);
+		for (size_t i = 0; i < inFlight; ++i)
+		{
+			const SendSlot& slot = m_sendQueue[i];
+			if (slot.isAcked)
+				continue;
+
+			if (slot.transmissions == 0)
+			{
+				transmit(uint8_t(m_sendBase + i), now);
+			}
+			else if (now - slot.sentAt >= m_timeout)
+			{
+				hasTimedOut = true;
+				transmit(uint8_t(m_sendBase + i), now);
+			}
+		}
+
+		//back off once per poll, not per frame
+		if (hasTimedOut)
+		{
+			backOff();
+		}
+
+		for (size_t i = 0; i < inFlight; ++i)
+		{
+			if (!m_sendQueue[i].isAcked)
+			{
+				next = std::min(next, m_sendQueue[i].sentAt + m_timeout);
+			}
+		}
+	}
+
+	if (m_isAckPending)
+	{
+		m_isAckPending = false;
+		sendAck(0, m_receiveBase);
+	}
+	return next;
+}
+
+bool ReliableLink::isPeerReliable() const
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_isReceiverSynchronized;
+}
+
+ReliableLink::Statistics ReliableLink::getStatistics() const
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	Statistics statistics = m_statistics;
+	statistics.roundTripTime = m_smoothedRoundTrip;
+	statistics.timeout = m_timeout;
+	return statistics;
+}
+
+void ReliableLink::sendAck(uint8_t flags, uint8_t nextSeq)
+{
+	AckPayload ack = {};
+	ack.flags = flags;
+	ack.nextSeq = nextSeq;
+	if (flags == 0)
+	{
+		for (uint8_t i = 0; i < windowSize - 1; ++i)
+		{
+			if (m_receivedMask & (1 << (uint8_t(nextSeq + 1 + i) % windowSize)))
+			{
+				ack.selectiveAcks |= uint8_t(1 << i);
+			}
+		}
+	}
+	m_fnSend(encodeFrame(RequestDataPacket<AckPayload>(ack)));
+}
+
+void ReliableLink::transmit(uint8_t seq, Clock::time_point now)
+{
+	SendSlot& slot = *getSlot(seq);
+
+	ReliablePayload payload = {};
+	payload.seq = seq;
+	payload.cmd = slot.command[0];
+	std::copy(slot.command.begin() + 1, slot.command.end(), payload.data);
+	m_fnSend(encodeFrame(RequestDataPacket<ReliablePayload>(payload)));
+
+	++m_statistics.sentFrames;
+	if (++slot.transmissions > 1)
+	{
+		++m_statistics.retransmissions;
+	}
+	slot.sentAt = now;
+}
+
+void ReliableLink::startSync(Clock::time_point now)
+{
+	m_senderState = SenderState::Syncing;
+	m_syncSentAt = now;
+	sendAck(AckPayload::sync, m_sendBase);
+}
+
+void ReliableLink::updateTimeout(Clock::duration roundTrip)
+{
+	roundTrip = std::min(roundTrip, maxTimeout);
+	if (m_smoothedRoundTrip == Clock::duration::zero())
+	{
+		m_smoothedRoundTrip = roundTrip;
+		m_roundTripVariation = roundTrip / 2;
+	}
+	else
+	{
+		const Clock::duration delta = roundTrip - m_smoothedRoundTrip;
+		m_roundTripVariation += ((delta < Clock::duration::zero() ? -delta : delta) - m_roundTripVariation) / 4;
+		m_smoothedRoundTrip += delta / 8;
+	}
+
+	m_timeout = std::max(minTimeout, std::min(maxTimeout, m_smoothedRoundTrip + 4 * m_roundTripVariation));
+}
+
+void ReliableLink::acknowledge(SendSlot& slot, Clock::time_point now)
+{
+	if (slot.isAcked)
+		return;
+
+	slot.isAcked = true;
+	if (slot.transmissions == 1) //the round trip of a retransmitted frame is ambiguous
+	{
+		updateTimeout(now - slot.sentAt);
+	}
+}
+
+void ReliableLink::backOff()
+{
+	m_timeout = std::min(maxTimeout, m_timeout * 2);
+}
+
+ReliableLink::SendSlot* ReliableLink::getSlot(uint8_t seq)
+{
+	const uint8_t index = uint8_t(seq - m_sendBase);
+	return index < m_sendQueue.size() ? &m_sendQueue[index] : nullptr;
+}
@@ -0,0 +1,137 @@
+#ifndef RELIABLELINK_H
+#define RELIABLELINK_H
+
+#include "FrameCodec.h"
+
+#include <boost/thread/mutex.hpp>
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <functional>
+
+/**
+Selective-repeat ARQ for the commands that must not get lost (swap data, ConfigPID), Move and the status
+reports stay best effort. The same protocol as reliableLink.c of the firmware.
+
+A command sent reliably travels in a ReliablePayload with a sequence number, so only its first maxDataSize
+payload bytes make it. The receiver keeps frames arriving out of order, hands them on in sequence and answers
+with an AckPayload covering everything before nextSeq plus a bitmap of the frames after it.
+At most windowSize frames are in flight. A frame is sent again when its timeout expires or when an Ack shows
+that a later frame overtook it. The timeout follows the round trip time as in RFC 6298, measured on frames
+sent only once.
+
+Before its first frame, each sender announces its sequence number with a sync the peer acknowledges.
+A receiver that got no sync asks for one, so either side may restart at any time.
+
+send() may be called from any thread, receive() and poll() are expected from the receive thread.
+*/
+class ReliableLink
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	typedef std::function<void(const Frame&)> SendFunction;
+	typedef std::function<void(const Frame&)> DeliverFunction;
+
+	enum { windowSize = 8, maxDataSize = 8 };
+
+	struct Statistics
+	{
+		uint64_t sentFrames = 0;
+		uint64_t retransmissions = 0;
+		uint64_t deliveredFrames = 0;
+		uint64_t duplicates = 0;			///< received again, the Ack got lost or came too late
+		uint64_t checksumFailures = 0;
+		Clock::duration roundTripTime{};	///< smoothed
+		Clock::duration timeout{};
+	};
+
+	/**
+	@param fnSend writes a frame best effort, it must not call back into the link
+	@param fnDeliver gets the commands received reliably, in order and with a valid checksum
+	*/
+	ReliableLink(SendFunction fnSend, DeliverFunction fnDeliver);
+
+	ReliableLink(const ReliableLink&) = delete;
+	ReliableLink& operator =(const ReliableLink&) = delete;
+
+	template <typename Payload>
+	void send(const RequestDataPacket<Payload>& dataPacket, Clock::time_point now = Clock::now())
+	{
+		static_assert(sizeof(Payload) <= maxDataSize, "Payload too big for the reliable lane");
+		send(encodeFrame(dataPacket), now);
+	}
+
+	/**
+	Queues cmd and the first maxDataSize payload bytes of frame, the queue is unbounded
+	*/
+	void send(const Frame& frame, Clock::time_point now = Clock::now());
+
+	void receive(const RequestDataPacket<ReliablePayload>& data, Clock::time_point now = Clock::now());
+	void receive(const RequestDataPacket<AckPayload>& data, Clock::time_point now = Clock::now());
+
+	/**
+	Sends what is due: new frames the window allows, retransmissions, syncs and the Ack of received frames
+	@returns when poll() has to be called again at the latest
+	*/
+	Clock::time_point poll(Clock::time_point now = Clock::now());
+
+	/**
+	The peer synchronized its sender with us, so it speaks the protocol
+	*/
+	bool isPeerReliable() const;
+
+	Statistics getStatistics() const;
+
+private:
+	typedef std::array<uint8_t, 1 + maxDataSize> Command;
+
+	struct SendSlot
+	{
+		Command command;
+		Clock::time_point sentAt;
+		unsigned transmissions = 0;
+		bool isAcked = false;
+	};
+
+	enum class SenderState
+	{
+		Unsynchronized,
+		Syncing,
+		Synchronized
+	};
+
+	void sendAck(uint8_t flags, uint8_t nextSeq);
+	void transmit(uint8_t seq, Clock::time_point now);
+	void startSync(Clock::time_point now);
+	void updateTimeout(Clock::duration roundTrip);
+	void acknowledge(SendSlot& slot, Clock::time_point now);
+	void backOff();
+	SendSlot* getSlot(uint8_t seq);
+
+private:
+	SendFunction m_fnSend;
+	DeliverFunction m_fnDeliver;
+
+	mutable boost::mutex m_mutex;
+
+	//sender, m_sendQueue[0] holds m_sendBase
+	std::deque<SendSlot> m_sendQueue;
+	uint8_t m_sendBase = 0;
+	SenderState m_senderState = SenderState::Unsynchronized;
+	Clock::time_point m_syncSentAt;
+	Clock::duration m_smoothedRoundTrip{};
+	Clock::duration m_roundTripVariation{};
+	Clock::duration m_timeout;
+
+	//receiver, bit seq % windowSize of m_receivedMask is set if m_received holds that frame
+	bool m_isReceiverSynchronized = false;
+	uint8_t m_receiveBase = 0;
+	uint8_t m_receivedMask = 0;
+	std::array<Command, windowSize> m_received;
+	bool m_isAckPending = false;
+
+	Statistics m_statistics;
+};
+
+#endif // RELIABLELINK_H
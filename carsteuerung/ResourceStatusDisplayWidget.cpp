@@ -32,8 +32,15 @@ void ResourceStatusDisplayWidget::update(ResourcePayload status)
 		ui->taskQueueLoad->setText(QString::number(status.taskQueueLoad) + " Tasks");
 		ui->freeReceiveBuffer->setText(QString::number(status.freeReceiveQueue) + " Bytes");
 		ui->usedReceiveBuffer->setText(QString::number(status.usedReceiveQueue) + " Bytes");
-
-		ui->barTaskQueueLoad->setMaximum(256);
+		ui->queuedTasks->setText(QString::number(status.queuedControlTasks()) + " control, "
+			+ QString::number(status.queuedCommunicationTasks()) + " communication, "
+			+ QString::number(status.queuedBackgroundTasks()) + " background");
+		ui->maxTaskWait->setText(QString::number(status.maxControlTaskWait) + " / "
+			+ QString::number(status.maxCommunicationTaskWait) + " / "
+			+ QString::number(status.maxBackgroundTaskWait) + " ms (control / communication / background)");
+
+		//SCHEDULER_MAX_ONE_SHOT_TASKS of the firmware
+		ui->barTaskQueueLoad->setMaximum(16);
 		ui->barTaskQueueLoad->setValue(status.taskQueueLoad);
 
 		ui->barUsedPagesProgressBar->setMaximum(status.usedPages + status.freePages);
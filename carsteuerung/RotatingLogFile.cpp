@@ -0,0 +1,87 @@
+#include "RotatingLogFile.h"
+
+#include <cstdio>
+
+RotatingLogFile::RotatingLogFile(std::string path, size_t maxFileSize, unsigned fileCount)
+	: m_path(std::move(path))
+	, m_maxFileSize(maxFileSize)
+	, m_fileCount(fileCount)
+	, m_file(m_path, std::ios::app | std::ios::ate | std::ios::binary)
+	, m_fileSize(m_file.tellp() > 0 ? size_t(m_file.tellp()) : 0)
+	, m_thread(&RotatingLogFile::worker, this)
+{
+}
+
+RotatingLogFile::~RotatingLogFile()
+{
+	{
+		boost::mutex::scoped_lock lock(m_mutex);
+		m_stop = true;
+		m_pendingCondition.notify_one();
+	}
+	m_thread.join();
+}
+
+void RotatingLogFile::append(const std::string& text)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_pendingText += text;
+	m_pendingCondition.notify_one();
+}
+
+void RotatingLogFile::worker()
+{
+	std::string text;
+	for (;;)
+	{
+		bool stop;
+		{
+			boost::mutex::scoped_lock lock(m_mutex);
+			while (m_pendingText.empty() && !m_stop)
+			{
+				m_pendingCondition.wait(lock);
+			}
+			std::swap(text, m_pendingText);
+			stop = m_stop;
+		}
+
+		write(text);
+		text.clear();
+
+		if (stop)
+			return;
+	}
+}
+
+void RotatingLogFile::write(const std::string& text)
+{
+	if (text.empty())
+		return;
+
+	if (m_fileSize > 0 && m_fileSize + text.size() > m_maxFileSize)
+	{
+		rotate();
+	}
+
+	m_file.write(text.data(), text.size());
+	m_file.flush();
+	m_fileSize += text.size();
+}
+
+void RotatingLogFile::rotate()
+{
+	m_file.close();
+
+	if (m_fileCount > 1)
+	{
+		std::remove((m_path + "." + std::to_string(m_fileCount - 1)).c_str());
+		for (unsigned i = m_fileCount - 1; i > 1; --i)
+		{
+			std::rename((m_path + "." + std::to_string(i - 1)).c_str(), (m_path + "." + std::to_string(i)).c_str());
+		}
+		std::rename(m_path.c_str(), (m_path + ".1").c_str());
+	}
+
+	m_file.open(m_path, std::ios::trunc | std::ios::binary);
+	m_fileSize = 0;
+}
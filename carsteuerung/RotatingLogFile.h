@@ -0,0 +1,50 @@
+#ifndef ROTATINGLOGFILE_H
+#define ROTATINGLOGFILE_H
+
+#include <boost/thread.hpp>
+
+#include <fstream>
+#include <string>
+
+/**
+Writes log text to a file on a background thread.
+
+When the file would grow beyond maxFileSize it is renamed to path.1 (path.1 to path.2 and so on),
+the oldest of the fileCount files is deleted.
+*/
+class RotatingLogFile
+{
+public:
+	RotatingLogFile(std::string path, size_t maxFileSize, unsigned fileCount);
+	~RotatingLogFile();
+
+	RotatingLogFile(const RotatingLogFile&) = delete;
+	RotatingLogFile& operator =(const RotatingLogFile&) = delete;
+
+	/**
+	Hands text over to the writer thread, lines have to be terminated by a newline
+	*/
+	void append(const std::string& text);
+
+private:
+	void worker();
+	void write(const std::string& text);
+	void rotate();
+
+private:
+	const std::string m_path;
+	const size_t m_maxFileSize;
+	const unsigned m_fileCount;
+
+	std::ofstream m_file;
+	size_t m_fileSize = 0;
+
+	boost::mutex m_mutex;
+	boost::condition_variable m_pendingCondition;
+	std::string m_pendingText;
+	bool m_stop = false;
+
+	boost::thread m_thread;
+};
+
+#endif // ROTATINGLOGFILE_H
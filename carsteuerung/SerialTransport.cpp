@@ -0,0 +1,463 @@
+#include "SerialTransport.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+//termios2 (arbitrary baud rates) is only available through the kernel headers, which clash with <termios.h>
+#include <asm/termbits.h>
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#ifdef MCCAR_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace
+{
+
+const uint64_t readTag = 1;
+const uint64_t cancelTag = 2;
+
+}
+
+struct SerialTransport::IoUringState
+{
+#ifdef MCCAR_HAVE_LIBURING
+	io_uring ring;
+	std::array<uint8_t, 4096> buffer;
+	size_t bufferedOffset = 0;
+	size_t bufferedBytes = 0;
+	bool readPending = false;
+#endif
+};
+
+SerialTransport::SerialTransport()
+{
+	m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+	m_wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = m_wakeupFd;
+	epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeupFd, &event);
+}
+
+SerialTransport::~SerialTransport()
+{
+	close();
+
+#ifdef MCCAR_HAVE_LIBURING
+	if (m_pIoUring)
+	{
+		io_uring_queue_exit(&m_pIoUring->ring);
+	}
+#endif
+	delete m_pIoUring;
+
+	::close(m_wakeupFd);
+	::close(m_epollFd);
+}
+
+bool SerialTransport::isBackendAvailable(Backend backend)
+{
+#ifdef MCCAR_HAVE_LIBURING
+	(void)backend;
+	return true;
+#else
+	return backend == Backend::Epoll;
+#endif
+}
+
+bool SerialTransport::open(const std::string& device, uint32_t baudRate, Backend backend)
+{
+	close();
+
+	//the wakeup of the last close() is meant for the reader of the old fd, the new one would wake up on it for nothing
+	uint64_t wakeups;
+	(void)::read(m_wakeupFd, &wakeups, sizeof(wakeups));
+
+	if (!isBackendAvailable(backend))
+	{
+		setLastError("io_uring backend not built in");
+		return false;
+	}
+
+	int fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0)
+	{
+		setLastError("open " + device + ": " + strerror(errno));
+		return false;
+	}
+
+	if (!configureTty(fd, baudRate, backend))
+	{
+		::close(fd);
+		return false;
+	}
+
+	if (backend == Backend::Epoll)
+	{
+		epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+		{
+			setLastError(std::string("epoll_ctl: ") + strerror(errno));
+			::close(fd);
+			return false;
+		}
+	}
+#ifdef MCCAR_HAVE_LIBURING
+	else
+	{
+		//the read in flight blocks in the kernel until data arrives, so the fd has to be blocking
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+		if (!m_pIoUring)
+		{
+			m_pIoUring = new IoUringState;
+			const int ret = io_uring_queue_init(8, &m_pIoUring->ring, 0);
+			if (ret < 0)
+			{
+				delete m_pIoUring;
+				m_pIoUring = nullptr;
+				setLastError(std::string("io_uring_queue_init: ") + strerror(-ret));
+				::close(fd);
+				return false;
+			}
+		}
+	}
+#endif
+
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_backend = backend;
+	m_fd = fd;
+	m_isHungUp = false;
+	m_openedCondition.notify_all();
+	return true;
+}
+
+void SerialTransport::close()
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	closeLocked();
+}
+
+void SerialTransport::closeLocked()
+{
+	const int fd = m_fd.exchange(-1);
+	if (fd < 0)
+		return;
+
+	if (m_backend == Backend::Epoll)
+	{
+		epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	}
+#ifdef MCCAR_HAVE_LIBURING
+	else if (m_pIoUring && m_pIoUring->readPending)
+	{
+		//the pending read holds a reference to the file, so it would not return on close alone
+		io_uring_sqe* pSqe = io_uring_get_sqe(&m_pIoUring->ring);
+		if (pSqe)
+		{
+			io_uring_prep_cancel64(pSqe, readTag, 0);
+			io_uring_sqe_set_data64(pSqe, cancelTag);
+			io_uring_submit(&m_pIoUring->ring);
+		}
+	}
+#endif
+
+	//wake up a reader waiting for data
+	const uint64_t one = 1;
+	(void)::write(m_wakeupFd, &one, sizeof(one));
+
+	::close(fd);
+}
+
+bool SerialTransport::setBaudRate(uint32_t baudRate)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+
+	const int fd = m_fd.load();
+	if (fd < 0)
+		return false;
+
+	termios2 tty;
+	if (ioctl(fd, TCGETS2, &tty) != 0)
+	{
+		m_lastError = std::string("TCGETS2: ") + strerror(errno);
+		return false;
+	}
+
+	tty.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+	tty.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+	tty.c_ispeed = baudRate;
+	tty.c_ospeed = baudRate;
+
+	if (ioctl(fd, TCSETSW2, &tty) != 0)
+	{
+		m_lastError = std::string("TCSETSW2: ") + strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+std::string SerialTransport::getLastError() const
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	return m_lastError;
+}
+
+void SerialTransport::waitUntilOpen()
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	while (m_fd.load() < 0)
+	{
+		m_openedCondition.wait(lock);
+	}
+}
+
+size_t SerialTransport::read(uint8_t* pBuffer, size_t size, int timeoutMs)
+{
+	if (m_backend == Backend::IoUring)
+		return readIoUring(pBuffer, size, timeoutMs);
+
+	return readEpoll(pBuffer, size, timeoutMs);
+}
+
+bool SerialTransport::write(const uint8_t* pData, size_t size)
+{
+	boost::mutex::scoped_lock lock(m_writeMutex);
+	return writeLocked(pData, size);
+}
+
+void SerialTransport::enqueue(const uint8_t* pData, size_t size)
+{
+	boost::mutex::scoped_lock lock(m_writeMutex);
+	m_writeQueue.insert(m_writeQueue.end(), pData, pData + size);
+}
+
+bool SerialTransport::flush()
+{
+	boost::mutex::scoped_lock lock(m_writeMutex);
+	const bool ok = writeLocked(m_writeQueue.data(), m_writeQueue.size());
+	m_writeQueue.clear();
+	return ok;
+}
+
+bool SerialTransport::configureTty(int fd, uint32_t baudRate, Backend backend)
+{
+	termios2 tty;
+	if (ioctl(fd, TCGETS2, &tty) != 0)
+	{
+		setLastError(std::string("not a tty: ") + strerror(errno));
+		return false;
+	}
+
+	//raw mode, 8N1, no flow control
+	tty.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+	tty.c_oflag &= ~OPOST;
+	tty.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+	tty.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS | CBAUD | (CBAUD << IBSHIFT));
+	tty.c_cflag |= CS8 | CLOCAL | CREAD | BOTHER | (BOTHER << IBSHIFT);
+	tty.c_ispeed = baudRate;
+	tty.c_ospeed = baudRate;
+
+	//epoll signals readiness, so reads must never wait. A read kept in flight has to wait for at least one byte instead.
+	tty.c_cc[VMIN] = backend == Backend::IoUring ? 1 : 0;
+	tty.c_cc[VTIME] = 0;
+
+	if (ioctl(fd, TCSETS2, &tty) != 0)
+	{
+		setLastError(std::string("TCSETS2: ") + strerror(errno));
+		return false;
+	}
+
+	//let the driver push received bytes up immediately. Not supported by every driver (e.g. rfcomm, pty), which is fine.
+	serial_struct serial;
+	if (ioctl(fd, TIOCGSERIAL, &serial) == 0)
+	{
+		serial.flags |= ASYNC_LOW_LATENCY;
+		ioctl(fd, TIOCSSERIAL, &serial);
+	}
+
+	ioctl(fd, TCFLSH, TCIOFLUSH);
+	return true;
+}
+
+void SerialTransport::setLastError(const std::string& what)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	m_lastError = what;
+}
+
+void SerialTransport::hangUpLocked(const std::string& what)
+{
+	//the fd would signal readiness forever
+	m_lastError = what;
+	m_isHungUp = true;
+	closeLocked();
+}
+
+size_t SerialTransport::readEpoll(uint8_t* pBuffer, size_t size, int timeoutMs)
+{
+	std::array<epoll_event, 2> events;
+	const int eventCount = epoll_wait(m_epollFd, events.data(), events.size(), timeoutMs);
+	int signaledFd = -1;
+	uint32_t signaledEvents = 0;
+	for (int i = 0; i < eventCount; ++i)
+	{
+		if (events[i].data.fd == m_wakeupFd)
+		{
+			uint64_t value;
+			(void)::read(m_wakeupFd, &value, sizeof(value));
+		}
+		else
+		{
+			signaledFd = events[i].data.fd;
+			signaledEvents = events[i].events;
+		}
+	}
+	if (!(signaledEvents & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+		return 0;
+
+	//close() must not close the fd (and open() must not reuse its number) while it is read
+	boost::mutex::scoped_lock lock(m_mutex);
+	const int fd = m_fd.load();
+	if (fd < 0 || fd != signaledFd)
+		return 0;
+
+	//with VMIN = VTIME = 0 a tty without data returns 0 like the end of a file, only epoll and EIO tell a hangup
+	const ssize_t received = ::read(fd, pBuffer, size);
+	const int error = errno;
+	if (received > 0)
+		return static_cast<size_t>(received);
+
+	if (received < 0 && error != EAGAIN && error != EINTR)
+	{
+		hangUpLocked(std::string("read: ") + strerror(error));
+	}
+	else if (signaledEvents & (EPOLLHUP | EPOLLERR))
+	{
+		hangUpLocked("read: device hung up");
+	}
+	return 0;
+}
+
+size_t SerialTransport::readIoUring(uint8_t* pBuffer, size_t size, int timeoutMs)
+{
+#ifdef MCCAR_HAVE_LIBURING
+	IoUringState& state = *m_pIoUring;
+
+	if (state.bufferedBytes == 0)
+	{
+		{
+			boost::mutex::scoped_lock lock(m_mutex);
+			const int fd = m_fd.load();
+			if (!state.readPending && fd >= 0)
+			{
+				io_uring_sqe* pSqe = io_uring_get_sqe(&state.ring);
+				io_uring_prep_read(pSqe, fd, state.buffer.data(), state.buffer.size(), uint64_t(-1));
+				io_uring_sqe_set_data64(pSqe, readTag);
+				io_uring_submit(&state.ring);
+				state.readPending = true;
+			}
+		}
+
+		__kernel_timespec timeout;
+		timeout.tv_sec = timeoutMs / 1000;
+		timeout.tv_nsec = (timeoutMs % 1000) * 1000000;
+
+		io_uring_cqe* pCqe;
+		const int ret = io_uring_wait_cqe_timeout(&state.ring, &pCqe, &timeout);
+		if (ret < 0)
+		{
+			if (ret != -ETIME && ret != -EINTR)
+			{
+				setLastError(std::string("io_uring_wait_cqe_timeout: ") + strerror(-ret));
+			}
+			return 0;
+		}
+
+		const uint64_t tag = io_uring_cqe_get_data64(pCqe);
+		const int result = pCqe->res;
+		io_uring_cqe_seen(&state.ring, pCqe);
+
+		if (tag != readTag)
+			return 0;
+
+		state.readPending = false;
+		if (result == -ECANCELED || result == -EINTR || result == -EAGAIN)
+			return 0;
+
+		if (result <= 0)
+		{
+			boost::mutex::scoped_lock lock(m_mutex);
+			if (m_fd.load() >= 0)
+			{
+				hangUpLocked(result == 0 ? std::string("read: device hung up") : std::string("read: ") + strerror(-result));
+			}
+			return 0;
+		}
+		state.bufferedOffset = 0;
+		state.bufferedBytes = static_cast<size_t>(result);
+	}
+
+	const size_t copied = std::min(size, state.bufferedBytes);
+	std::memcpy(pBuffer, &state.buffer[state.bufferedOffset], copied);
+	state.bufferedOffset += copied;
+	state.bufferedBytes -= copied;
+	return copied;
+#else
+	(void)pBuffer;
+	(void)size;
+	(void)timeoutMs;
+	(void)cancelTag;
+	return 0;
+#endif
+}
+
+bool SerialTransport::writeLocked(const uint8_t* pData, size_t size)
+{
+	//the rest of the data must not go to a port opened meanwhile
+	const int fd = m_fd.load();
+	while (size > 0)
+	{
+		ssize_t written;
+		int error;
+		{
+			//close() must not close the fd (and open() must not reuse its number) while it is written,
+			//but waiting for the tty to drain must not hold up close() and read()
+			boost::mutex::scoped_lock lock(m_mutex);
+			if (fd < 0 || m_fd.load() != fd)
+				return false;
+
+			written = ::write(fd, pData, size);
+			error = errno;
+		}
+		if (written < 0)
+		{
+			if (error == EAGAIN)
+			{
+				pollfd pollFd = { fd, POLLOUT, 0 };
+				poll(&pollFd, 1, 100);
+				continue;
+			}
+			if (error == EINTR)
+				continue;
+
+			setLastError(std::string("write: ") + strerror(error));
+			return false;
+		}
+		pData += written;
+		size -= static_cast<size_t>(written);
+	}
+	return true;
+}
@@ -0,0 +1,109 @@
+#ifndef SERIALTRANSPORT_H
+#define SERIALTRANSPORT_H
+
+#include <boost/thread.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+Raw, non-blocking access to a tty (rfcomm device, usb serial adapter or pseudo-terminal).
+
+Reads return whatever has arrived, in one chunk, instead of single bytes. Readiness is
+signaled through epoll, or with the io_uring backend (if built with CONFIG+=io_uring)
+through a read that is kept in flight permanently.
+Writes can be queued and go out with a single write call on flush().
+
+read() is meant to be called by one receiving thread, all other methods are thread-safe.
+*/
+class SerialTransport
+{
+public:
+	enum class Backend
+	{
+		Epoll,
+		IoUring
+	};
+
+	SerialTransport();
+	~SerialTransport();
+
+	SerialTransport(const SerialTransport&) = delete;
+	SerialTransport& operator =(const SerialTransport&) = delete;
+
+	static bool isBackendAvailable(Backend backend);
+
+	/**
+	Opens device in raw mode, 8N1 without flow control
+	@returns false on failure, see getLastError()
+	*/
+	bool open(const std::string& device, uint32_t baudRate, Backend backend = Backend::Epoll);
+	void close();
+	bool isOpen() const { return m_fd.load() >= 0; }
+
+	/**
+	Whether read() closed the transport because the device went away, until the next open()
+	*/
+	bool isHungUp() const { return m_isHungUp.load(); }
+
+	/**
+	Switches the rate once everything written so far has been sent
+	*/
+	bool setBaudRate(uint32_t baudRate);
+	std::string getLastError() const;
+
+	/**
+	Blocks until open() succeeded. Interruptible by boost::thread::interrupt().
+	*/
+	void waitUntilOpen();
+
+	/**
+	Waits at most timeoutMs for data and reads everything available, up to size bytes.
+	A hangup (rfcomm connection dropped, adapter unplugged, pty closed) closes the transport, see isHungUp().
+	@returns the amount of bytes read, 0 on timeout or if the transport got closed
+	*/
+	size_t read(uint8_t* pBuffer, size_t size, int timeoutMs);
+
+	/**
+	Writes all size bytes, waiting for the tty to drain if necessary
+	@returns false if the transport is closed or broken
+	*/
+	bool write(const uint8_t* pData, size_t size);
+
+	/**
+	Collects data for the next flush()
+	*/
+	void enqueue(const uint8_t* pData, size_t size);
+	bool flush();
+
+private:
+	bool configureTty(int fd, uint32_t baudRate, Backend backend);
+	void closeLocked();
+	void hangUpLocked(const std::string& what);
+	void setLastError(const std::string& what);
+	size_t readEpoll(uint8_t* pBuffer, size_t size, int timeoutMs);
+	size_t readIoUring(uint8_t* pBuffer, size_t size, int timeoutMs);
+	bool writeLocked(const uint8_t* pData, size_t size);
+
+private:
+	std::atomic<int> m_fd{-1};
+	std::atomic<bool> m_isHungUp{false};
+	Backend m_backend = Backend::Epoll;
+
+	int m_epollFd = -1;
+	int m_wakeupFd = -1;
+
+	struct IoUringState;
+	IoUringState* m_pIoUring = nullptr;
+
+	mutable boost::mutex m_mutex;
+	boost::condition_variable m_openedCondition;
+	std::string m_lastError;
+
+	boost::mutex m_writeMutex;
+	std::vector<uint8_t> m_writeQueue;
+};
+
+#endif // SERIALTRANSPORT_H
@@ -0,0 +1,342 @@
+#include "SwapStore.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+const char magic[8] = { 'M', 'C', 'S', 'W', 'A', 'P', '\0', '\0' };
+const uint32_t version = 1;
+const size_t pageSize = 4096;
+
+size_t roundUpToPage(size_t size)
+{
+	return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+}
+
+struct SwapStore::Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t slotCount;
+	uint32_t slotSize;
+	uint32_t reserved;
+	uint64_t useCounter;
+};
+
+struct SwapStore::SlotDescriptor
+{
+	uint32_t size;		///< commit point of an append, written after the data
+	uint16_t bufferNo;
+	uint8_t isUsed;
+	uint8_t reserved;
+	uint64_t lastUse;
+};
+
+constexpr uint32_t SwapStore::noSlot;
+
+SwapStore::SwapStore()
+	: m_slotOfBuffer(UINT16_MAX + 1, noSlot)
+{
+	static_assert(sizeof(SlotDescriptor) == 16, "the slot directory is part of the file format");
+}
+
+SwapStore::~SwapStore()
+{
+	close();
+}
+
+bool SwapStore::open(const std::string& path, uint32_t slotCount, uint32_t slotSize)
+{
+	close();
+
+	if (slotCount == 0 || slotSize == 0)
+	{
+		m_lastError = "empty swap store layout";
+		return false;
+	}
+
+	m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (m_fd < 0)
+	{
+		m_lastError = "open " + path + ": " + strerror(errno);
+		return false;
+	}
+
+	struct stat fileStatus;
+	if (fstat(m_fd, &fileStatus) != 0)
+	{
+		m_lastError = std::string("fstat: ") + strerror(errno);
+		close();
+		return false;
+	}
+
+	m_mappingSize = getFileSize(slotCount, slotSize);
+	const bool sizeMatches = size_t(fileStatus.st_size) == m_mappingSize;
+	if (!sizeMatches && (ftruncate(m_fd, 0) != 0 || ftruncate(m_fd, m_mappingSize) != 0))
+	{
+		m_lastError = std::string("ftruncate: ") + strerror(errno);
+		close();
+		return false;
+	}
+
+	void* pMapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	if (pMapping == MAP_FAILED)
+	{
+		m_lastError = std::string("mmap: ") + strerror(errno);
+		close();
+		return false;
+	}
+	m_pMapping = static_cast<uint8_t*>(pMapping);
+	m_pHeader = reinterpret_cast<Header*>(m_pMapping);
+
+	const bool layoutMatches = sizeMatches
+			&& std::memcmp(m_pHeader->magic, magic, sizeof(magic)) == 0
+			&& m_pHeader->version == version
+			&& m_pHeader->slotCount == slotCount
+			&& m_pHeader->slotSize == slotSize;
+	if (!layoutMatches && !initialize(slotCount, slotSize))
+	{
+		close();
+		return false;
+	}
+
+	rebuildIndex();
+	return true;
+}
+
+void SwapStore::close()
+{
+	if (m_pMapping)
+	{
+		munmap(m_pMapping, m_mappingSize);
+		m_pMapping = nullptr;
+		m_pHeader = nullptr;
+	}
+	if (m_fd >= 0)
+	{
+		::close(m_fd);
+		m_fd = -1;
+	}
+
+	std::fill(m_slotOfBuffer.begin(), m_slotOfBuffer.end(), noSlot);
+	m_freeSlots.clear();
+	m_usedSlots = 0;
+}
+
+SwapStore::AppendResult SwapStore::append(uint16_t bufferNo, uint16_t offset, ConstByteSpan data)
+{
+	if (!isOpen())
+		return AppendResult::NotOpen;
+
+	uint32_t slot = m_slotOfBuffer[bufferNo];
+	if (offset == 0)
+	{
+		if (slot == noSlot)
+		{
+			slot = claimSlot(bufferNo);
+		}
+		else
+		{
+			getDescriptor(slot).size = 0;
+		}
+	}
+	else if (slot == noSlot || getDescriptor(slot).size != offset)
+	{
+		remove(bufferNo);
+		return AppendResult::OutOfOrder;
+	}
+
+	if (size_t(offset) + data.size() > m_pHeader->slotSize)
+	{
+		remove(bufferNo);
+		return AppendResult::QuotaExceeded;
+	}
+
+	std::memcpy(getSlotData(slot) + offset, data.data(), data.size());
+
+	//publish the chunk only once it is completely in the slot
+	std::atomic_thread_fence(std::memory_order_release);
+	SlotDescriptor& descriptor = getDescriptor(slot);
+	descriptor.size = offset + uint32_t(data.size());
+	descriptor.lastUse = ++m_pHeader->useCounter;
+	return AppendResult::Appended;
+}
+
+ConstByteSpan SwapStore::read(uint16_t bufferNo)
+{
+	if (!isOpen())
+		return ConstByteSpan();
+
+	const uint32_t slot = m_slotOfBuffer[bufferNo];
+	if (slot == noSlot)
+		return ConstByteSpan();
+
+	SlotDescriptor& descriptor = getDescriptor(slot);
+	descriptor.lastUse = ++m_pHeader->useCounter;
+	return ConstByteSpan(getSlotData(slot), descriptor.size);
+}
+
+void SwapStore::remove(uint16_t bufferNo)
+{
+	if (isOpen() && m_slotOfBuffer[bufferNo] != noSlot)
+	{
+		freeSlot(m_slotOfBuffer[bufferNo]);
+	}
+}
+
+bool SwapStore::flush()
+{
+	if (!isOpen())
+		return false;
+
+	if (msync(m_pMapping, m_mappingSize, MS_SYNC) != 0)
+	{
+		m_lastError = std::string("msync: ") + strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+uint32_t SwapStore::getSlotCount() const
+{
+	return m_pHeader ? m_pHeader->slotCount : 0;
+}
+
+uint32_t SwapStore::getSlotSize() const
+{
+	return m_pHeader ? m_pHeader->slotSize : 0;
+}
+
+bool SwapStore::initialize(uint32_t slotCount, uint32_t slotSize)
+{
+	std::memset(m_pMapping, 0, getDataOffset(slotCount));
+	m_pHeader->version = version;
+	m_pHeader->slotCount = slotCount;
+	m_pHeader->slotSize = slotSize;
+	m_pHeader->useCounter = 0;
+
+	//the magic marks the file as complete, so it goes last
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(m_pHeader->magic, magic, sizeof(magic));
+
+	if (msync(m_pMapping, getDataOffset(slotCount), MS_SYNC) != 0)
+	{
+		m_lastError = std::string("msync: ") + strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+void SwapStore::rebuildIndex()
+{
+	std::fill(m_slotOfBuffer.begin(), m_slotOfBuffer.end(), noSlot);
+	m_freeSlots.clear();
+	m_usedSlots = 0;
+
+	//descending, so that the free list hands out the lowest slots first
+	for (uint32_t slot = m_pHeader->slotCount; slot-- > 0;)
+	{
+		SlotDescriptor& descriptor = getDescriptor(slot);
+		if (!descriptor.isUsed || descriptor.size > m_pHeader->slotSize)
+		{
+			descriptor.isUsed = 0;
+			m_freeSlots.push_back(slot);
+			continue;
+		}
+
+		//a crash while a buffer moved to another slot can leave it in two slots, the newer one wins
+		uint32_t& slotOfBuffer = m_slotOfBuffer[descriptor.bufferNo];
+		if (slotOfBuffer != noSlot)
+		{
+			SlotDescriptor& other = getDescriptor(slotOfBuffer);
+			if (other.lastUse >= descriptor.lastUse)
+			{
+				descriptor.isUsed = 0;
+				m_freeSlots.push_back(slot);
+				continue;
+			}
+			other.isUsed = 0;
+			m_freeSlots.push_back(slotOfBuffer);
+			--m_usedSlots;
+		}
+
+		slotOfBuffer = slot;
+		++m_usedSlots;
+	}
+}
+
+uint32_t SwapStore::claimSlot(uint16_t bufferNo)
+{
+	if (m_freeSlots.empty())
+	{
+		uint32_t leastRecentlyUsed = 0;
+		for (uint32_t slot = 1; slot < m_pHeader->slotCount; ++slot)
+		{
+			if (getDescriptor(slot).lastUse < getDescriptor(leastRecentlyUsed).lastUse)
+			{
+				leastRecentlyUsed = slot;
+			}
+		}
+		freeSlot(leastRecentlyUsed);
+		++m_evictions;
+	}
+
+	const uint32_t slot = m_freeSlots.back();
+	m_freeSlots.pop_back();
+
+	SlotDescriptor& descriptor = getDescriptor(slot);
+	descriptor.size = 0;
+	descriptor.bufferNo = bufferNo;
+	descriptor.lastUse = ++m_pHeader->useCounter;
+	std::atomic_thread_fence(std::memory_order_release);
+	descriptor.isUsed = 1;
+
+	m_slotOfBuffer[bufferNo] = slot;
+	++m_usedSlots;
+	return slot;
+}
+
+void SwapStore::freeSlot(uint32_t slot)
+{
+	SlotDescriptor& descriptor = getDescriptor(slot);
+	descriptor.isUsed = 0;
+	m_slotOfBuffer[descriptor.bufferNo] = noSlot;
+	m_freeSlots.push_back(slot);
+	--m_usedSlots;
+}
+
+SwapStore::SlotDescriptor& SwapStore::getDescriptor(uint32_t slot)
+{
+	return reinterpret_cast<SlotDescriptor*>(m_pMapping + getDirectoryOffset())[slot];
+}
+
+uint8_t* SwapStore::getSlotData(uint32_t slot)
+{
+	return m_pMapping + getDataOffset(m_pHeader->slotCount) + size_t(slot) * m_pHeader->slotSize;
+}
+
+size_t SwapStore::getDirectoryOffset()
+{
+	return pageSize;
+}
+
+size_t SwapStore::getDataOffset(uint32_t slotCount)
+{
+	return roundUpToPage(getDirectoryOffset() + size_t(slotCount) * sizeof(SlotDescriptor));
+}
+
+size_t SwapStore::getFileSize(uint32_t slotCount, uint32_t slotSize)
+{
+	return getDataOffset(slotCount) + size_t(slotCount) * slotSize;
+}
@@ -0,0 +1,99 @@
+#ifndef SWAPSTORE_H
+#define SWAPSTORE_H
+
+#include "ByteSpan.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+Keeps the buffers the MC swaps out (WriteData) in a memory-mapped file, so they survive a restart of the host.
+
+The file consists of a header, a slot directory and slotCount data slots of slotSize bytes each.
+A buffer occupies one slot, so slotSize is the quota of a single buffer and slotCount the quota of all of them.
+If all slots are in use, the least recently used buffer is evicted.
+
+Appending copies the chunk into the slot first and then publishes the new size, so after a crash of the
+host the file still holds every chunk that was appended completely. flush() also makes it survive a crash of the OS.
+
+Not thread-safe, all calls are expected from the receive thread.
+*/
+class SwapStore
+{
+public:
+	enum class AppendResult
+	{
+		Appended,
+		OutOfOrder,			///< offset did not continue the buffer, it has been dropped
+		QuotaExceeded,		///< the buffer would not fit into a slot, it has been dropped
+		NotOpen
+	};
+
+	SwapStore();
+	~SwapStore();
+
+	SwapStore(const SwapStore&) = delete;
+	SwapStore& operator =(const SwapStore&) = delete;
+
+	/**
+	Opens path or creates it. An existing file with a different layout is reinitialized.
+	@returns false on failure, see getLastError()
+	*/
+	bool open(const std::string& path, uint32_t slotCount, uint32_t slotSize);
+	void close();
+	bool isOpen() const { return m_pMapping != nullptr; }
+	const std::string& getLastError() const { return m_lastError; }
+
+	/**
+	Appends a chunk to buffer bufferNo. Offset 0 starts the buffer over.
+	*/
+	AppendResult append(uint16_t bufferNo, uint16_t offset, ConstByteSpan data);
+
+	/**
+	@returns a view into the mapping, valid until the buffer is changed or the store is closed.
+	Empty if the buffer is unknown.
+	*/
+	ConstByteSpan read(uint16_t bufferNo);
+
+	void remove(uint16_t bufferNo);
+	bool flush();
+
+	uint32_t getSlotCount() const;
+	uint32_t getSlotSize() const;
+	uint32_t getUsedSlots() const { return m_usedSlots; }
+	uint64_t getEvictions() const { return m_evictions; }
+
+private:
+	struct Header;
+	struct SlotDescriptor;
+
+	bool initialize(uint32_t slotCount, uint32_t slotSize);
+	void rebuildIndex();
+	uint32_t claimSlot(uint16_t bufferNo);
+	void freeSlot(uint32_t slot);
+
+	SlotDescriptor& getDescriptor(uint32_t slot);
+	uint8_t* getSlotData(uint32_t slot);
+
+	static size_t getDirectoryOffset();
+	static size_t getDataOffset(uint32_t slotCount);
+	static size_t getFileSize(uint32_t slotCount, uint32_t slotSize);
+
+private:
+	static constexpr uint32_t noSlot = UINT32_MAX;
+
+	int m_fd = -1;
+	uint8_t* m_pMapping = nullptr;
+	size_t m_mappingSize = 0;
+	Header* m_pHeader = nullptr;
+
+	std::vector<uint32_t> m_slotOfBuffer; //indexed by bufferNo
+	std::vector<uint32_t> m_freeSlots;
+	uint32_t m_usedSlots = 0;
+	uint64_t m_evictions = 0;
+
+	std::string m_lastError;
+};
+
+#endif // SWAPSTORE_H
@@ -0,0 +1,113 @@
+#include "TelemetryReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TelemetryReader::TelemetryReader()
+{
+}
+
+TelemetryReader::~TelemetryReader()
+{
+	close();
+}
+
+bool TelemetryReader::open(const std::string& path)
+{
+	close();
+
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		m_lastError = "open " + path + ": " + strerror(errno);
+		return false;
+	}
+
+	struct stat fileStatus;
+	if (fstat(fd, &fileStatus) != 0 || size_t(fileStatus.st_size) < sizeof(TelemetryFileHeader))
+	{
+		m_lastError = path + " is no telemetry capture";
+		::close(fd);
+		return false;
+	}
+
+	m_mappingSize = size_t(fileStatus.st_size);
+	void* pMapping = mmap(nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (pMapping == MAP_FAILED)
+	{
+		m_lastError = std::string("mmap: ") + strerror(errno);
+		return false;
+	}
+	m_pMapping = static_cast<const uint8_t*>(pMapping);
+
+	const TelemetryFileHeader* pHeader = reinterpret_cast<const TelemetryFileHeader*>(m_pMapping);
+	if (std::memcmp(pHeader->magic, telemetryFileMagic, sizeof(pHeader->magic)) != 0 || pHeader->recordSize != sizeof(TelemetryRecord))
+	{
+		m_lastError = path + " is no telemetry capture of this version";
+		close();
+		return false;
+	}
+	m_pRecords = reinterpret_cast<const TelemetryRecord*>(m_pMapping + sizeof(TelemetryFileHeader));
+
+	//the trailer is only there if the recording was stopped properly
+	size_t recordsEnd = m_mappingSize;
+	if (m_mappingSize >= sizeof(TelemetryFileHeader) + sizeof(TelemetryFileTrailer))
+	{
+		const TelemetryFileTrailer* pTrailer = reinterpret_cast<const TelemetryFileTrailer*>(m_pMapping + m_mappingSize - sizeof(TelemetryFileTrailer));
+		const uint64_t indexEnd = pTrailer->indexOffset + pTrailer->indexEntryCount * sizeof(TelemetryIndexEntry);
+		if (std::memcmp(pTrailer->magic, telemetryTrailerMagic, sizeof(pTrailer->magic)) == 0
+				&& indexEnd == m_mappingSize - sizeof(TelemetryFileTrailer)
+				&& pTrailer->indexOffset == sizeof(TelemetryFileHeader) + pTrailer->recordCount * sizeof(TelemetryRecord))
+		{
+			m_pIndex = reinterpret_cast<const TelemetryIndexEntry*>(m_pMapping + pTrailer->indexOffset);
+			m_indexEntryCount = pTrailer->indexEntryCount;
+			recordsEnd = pTrailer->indexOffset;
+		}
+	}
+	m_recordCount = (recordsEnd - sizeof(TelemetryFileHeader)) / sizeof(TelemetryRecord);
+
+	return true;
+}
+
+void TelemetryReader::close()
+{
+	if (m_pMapping)
+	{
+		munmap(const_cast<uint8_t*>(m_pMapping), m_mappingSize);
+	}
+	m_pMapping = nullptr;
+	m_mappingSize = 0;
+	m_pRecords = nullptr;
+	m_recordCount = 0;
+	m_pIndex = nullptr;
+	m_indexEntryCount = 0;
+}
+
+size_t TelemetryReader::findRecord(uint64_t timestamp) const
+{
+	//the index narrows the search down to one interval, the records of rx and tx are only roughly ordered by time
+	size_t first = 0;
+	if (m_pIndex)
+	{
+		const TelemetryIndexEntry* pEntry = std::upper_bound(m_pIndex, m_pIndex + m_indexEntryCount, timestamp,
+			[](uint64_t value, const TelemetryIndexEntry& entry) { return value < entry.timestamp; });
+		if (pEntry != m_pIndex)
+		{
+			first = size_t((pEntry - 1)->recordNo);
+		}
+	}
+
+	for (size_t recordNo = first; recordNo < m_recordCount; ++recordNo)
+	{
+		if (m_pRecords[recordNo].timestamp >= timestamp)
+			return recordNo;
+	}
+	return m_recordCount;
+}
@@ -0,0 +1,52 @@
+#ifndef TELEMETRYREADER_H
+#define TELEMETRYREADER_H
+
+#include "TelemetryRecorder.h"
+
+#include <string>
+
+/**
+Read-only access to a capture written by TelemetryRecorder. The file is mapped, records are not copied.
+*/
+class TelemetryReader
+{
+public:
+	TelemetryReader();
+	~TelemetryReader();
+
+	TelemetryReader(const TelemetryReader&) = delete;
+	TelemetryReader& operator =(const TelemetryReader&) = delete;
+
+	/**
+	@returns false if path is no capture, see getLastError()
+	*/
+	bool open(const std::string& path);
+	void close();
+	const std::string& getLastError() const { return m_lastError; }
+
+	size_t getRecordCount() const { return m_recordCount; }
+	const TelemetryRecord& getRecord(size_t recordNo) const { return m_pRecords[recordNo]; }
+
+	/**
+	False if the recording was not stopped properly, the records are complete nevertheless
+	*/
+	bool hasIndex() const { return m_pIndex != nullptr; }
+
+	/**
+	@returns the first record at or after timestamp, getRecordCount() if there is none
+	*/
+	size_t findRecord(uint64_t timestamp) const;
+
+private:
+	const uint8_t* m_pMapping = nullptr;
+	size_t m_mappingSize = 0;
+
+	const TelemetryRecord* m_pRecords = nullptr;
+	size_t m_recordCount = 0;
+	const TelemetryIndexEntry* m_pIndex = nullptr;
+	size_t m_indexEntryCount = 0;
+
+	std::string m_lastError;
+};
+
+#endif // TELEMETRYREADER_H
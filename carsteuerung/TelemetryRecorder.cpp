@@ -0,0 +1,192 @@
+#include "TelemetryRecorder.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+const char telemetryFileMagic[8] = { 'M', 'C', 'R', 'E', 'C', '\0', '\0', '\0' };
+const char telemetryTrailerMagic[8] = { 'M', 'C', 'R', 'E', 'C', 'I', 'D', 'X' };
+
+namespace
+{
+
+const uint32_t telemetryVersion = 1;
+const size_t bufferSize = 64 * 1024;
+const uint64_t allocationStep = 4 * 1024 * 1024;
+
+}
+
+TelemetryRecorder::TelemetryRecorder()
+	: m_buffer(bufferSize)
+{
+}
+
+TelemetryRecorder::~TelemetryRecorder()
+{
+	stop();
+}
+
+bool TelemetryRecorder::start(const std::string& path)
+{
+	stop();
+
+	m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (m_fd < 0)
+	{
+		boost::mutex::scoped_lock lock(m_errorMutex);
+		m_lastError = "open " + path + ": " + strerror(errno);
+		return false;
+	}
+
+	//records left over from a previous capture
+	TelemetryRecord record;
+	while (m_queue.tryPop(record))
+	{
+	}
+
+	m_fileSize = 0;
+	m_allocatedSize = 0;
+	m_bufferedBytes = 0;
+	m_index.clear();
+	m_recordCount = 0;
+	m_droppedRecords = 0;
+
+	TelemetryFileHeader header;
+	std::memcpy(header.magic, telemetryFileMagic, sizeof(header.magic));
+	header.version = telemetryVersion;
+	header.recordSize = sizeof(TelemetryRecord);
+	std::memcpy(m_buffer.data(), &header, sizeof(header));
+	m_bufferedBytes = sizeof(header);
+
+	m_thread = boost::thread(&TelemetryRecorder::worker, this);
+	m_isRecording = true;
+	return true;
+}
+
+void TelemetryRecorder::stop()
+{
+	if (!m_thread.joinable())
+		return;
+
+	m_isRecording = false;
+	m_thread.interrupt();
+	m_thread.join();
+
+	drainQueue();
+	flushBuffer();
+	writeIndexAndTrailer();
+
+	::close(m_fd);
+	m_fd = -1;
+}
+
+std::string TelemetryRecorder::getLastError() const
+{
+	boost::mutex::scoped_lock lock(m_errorMutex);
+	return m_lastError;
+}
+
+uint64_t TelemetryRecorder::getMonotonicTime()
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return uint64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void TelemetryRecorder::worker()
+{
+	try
+	{
+		for (;;)
+		{
+			//a full-rate link delivers about 1000 frames/s, so the queue stays far from full between two wake-ups
+			boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+			drainQueue();
+			flushBuffer();
+		}
+	}
+	catch (boost::thread_interrupted&)
+	{
+	}
+}
+
+void TelemetryRecorder::drainQueue()
+{
+	TelemetryRecord record;
+	while (m_queue.tryPop(record))
+	{
+		const uint64_t recordNo = m_recordCount.load(std::memory_order_relaxed);
+		if (recordNo % getTelemetryIndexInterval() == 0)
+		{
+			m_index.push_back(TelemetryIndexEntry{record.timestamp, recordNo});
+		}
+
+		if (m_bufferedBytes + sizeof(record) > m_buffer.size())
+		{
+			flushBuffer();
+		}
+		std::memcpy(&m_buffer[m_bufferedBytes], &record, sizeof(record));
+		m_bufferedBytes += sizeof(record);
+		m_recordCount.store(recordNo + 1, std::memory_order_relaxed);
+	}
+}
+
+void TelemetryRecorder::flushBuffer()
+{
+	if (m_bufferedBytes == 0)
+		return;
+
+	//reserve disk space in large steps without changing the file size, so the file never has a garbage tail
+	if (m_fileSize + m_bufferedBytes > m_allocatedSize)
+	{
+		if (fallocate(m_fd, FALLOC_FL_KEEP_SIZE, m_allocatedSize, allocationStep) == 0)
+		{
+			m_allocatedSize += allocationStep;
+		}
+		else
+		{
+			//not supported by every file system, writing works anyway
+			m_allocatedSize = UINT64_MAX;
+		}
+	}
+
+	writeAll(m_buffer.data(), m_bufferedBytes);
+	m_bufferedBytes = 0;
+}
+
+void TelemetryRecorder::writeIndexAndTrailer()
+{
+	TelemetryFileTrailer trailer;
+	trailer.indexOffset = m_fileSize;
+	trailer.indexEntryCount = m_index.size();
+	trailer.recordCount = m_recordCount.load(std::memory_order_relaxed);
+	std::memcpy(trailer.magic, telemetryTrailerMagic, sizeof(trailer.magic));
+
+	writeAll(m_index.data(), m_index.size() * sizeof(TelemetryIndexEntry));
+	writeAll(&trailer, sizeof(trailer));
+}
+
+bool TelemetryRecorder::writeAll(const void* pData, size_t size)
+{
+	const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+	while (size > 0)
+	{
+		const ssize_t written = ::write(m_fd, pBytes, size);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			boost::mutex::scoped_lock lock(m_errorMutex);
+			m_lastError = std::string("write: ") + strerror(errno);
+			return false;
+		}
+		pBytes += written;
+		size -= size_t(written);
+		m_fileSize += uint64_t(written);
+	}
+	return true;
+}
@@ -0,0 +1,139 @@
+#ifndef TELEMETRYRECORDER_H
+#define TELEMETRYRECORDER_H
+
+#include "FrameCodec.h"
+#include "MpscQueue.h"
+
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+/**
+File format of a telemetry capture: a header, fixed-size records, and, if the recording
+was stopped properly, an index block followed by a trailer at the end of the file.
+A capture cut off by a crash is still readable up to the last complete record.
+*/
+enum class TelemetryDirection : uint8_t
+{
+	Rx = 0,	///< MC -> host
+	Tx = 1	///< host -> MC
+};
+
+struct __attribute__ ((packed)) TelemetryFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+};
+
+struct __attribute__ ((packed)) TelemetryRecord
+{
+	uint64_t timestamp;	///< CLOCK_MONOTONIC in ns
+	TelemetryDirection direction;
+	uint8_t linkId;
+	uint8_t reserved[2];
+	uint8_t frame[getFrameSize()];
+};
+
+/**
+Every getTelemetryIndexInterval()th record is listed in the index, so a reader can seek by time
+*/
+struct __attribute__ ((packed)) TelemetryIndexEntry
+{
+	uint64_t timestamp;
+	uint64_t recordNo;
+};
+
+struct __attribute__ ((packed)) TelemetryFileTrailer
+{
+	uint64_t indexOffset;
+	uint64_t indexEntryCount;
+	uint64_t recordCount;
+	char magic[8];
+};
+
+constexpr uint64_t getTelemetryIndexInterval() { return 1024; }
+extern const char telemetryFileMagic[8];
+extern const char telemetryTrailerMagic[8];
+
+/**
+Writes every frame sent or received to a telemetry capture.
+
+record() is cheap and never blocks: it timestamps the frame and hands it over through a lock-free queue.
+A background thread collects the records in a preallocated buffer, writes it out in large blocks
+and reserves disk space ahead with fallocate.
+*/
+class TelemetryRecorder
+{
+public:
+	TelemetryRecorder();
+	~TelemetryRecorder();
+
+	TelemetryRecorder(const TelemetryRecorder&) = delete;
+	TelemetryRecorder& operator =(const TelemetryRecorder&) = delete;
+
+	/**
+	Starts a new capture at path, a running one is stopped first
+	@returns false on failure, see getLastError()
+	*/
+	bool start(const std::string& path);
+	void stop();
+	bool isRecording() const { return m_isRecording.load(std::memory_order_relaxed); }
+	std::string getLastError() const;
+
+	/**
+	Callable from any thread, does nothing unless recording
+	*/
+	void record(TelemetryDirection direction, uint8_t linkId, ConstByteSpan frame)
+	{
+		if (!isRecording())
+			return;
+
+		TelemetryRecord record;
+		record.timestamp = getMonotonicTime();
+		record.direction = direction;
+		record.linkId = linkId;
+		record.reserved[0] = record.reserved[1] = 0;
+		std::copy(frame.begin(), frame.begin() + std::min(frame.size(), sizeof(record.frame)), record.frame);
+
+		if (!m_queue.tryPush(record))
+		{
+			m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	uint64_t getRecordCount() const { return m_recordCount.load(std::memory_order_relaxed); }
+	uint64_t getDroppedRecords() const { return m_droppedRecords.load(std::memory_order_relaxed); }
+
+	static uint64_t getMonotonicTime();
+
+private:
+	void worker();
+	void drainQueue();
+	void flushBuffer();
+	void writeIndexAndTrailer();
+	bool writeAll(const void* pData, size_t size);
+
+private:
+	MpscQueue<TelemetryRecord, 8192> m_queue;
+	std::atomic<bool> m_isRecording{false};
+	std::atomic<uint64_t> m_recordCount{0};
+	std::atomic<uint64_t> m_droppedRecords{0};
+
+	int m_fd = -1;
+	uint64_t m_fileSize = 0;
+	uint64_t m_allocatedSize = 0;
+	std::vector<uint8_t> m_buffer;
+	size_t m_bufferedBytes = 0;
+	std::vector<TelemetryIndexEntry> m_index;
+
+	mutable boost::mutex m_errorMutex;
+	std::string m_lastError;
+
+	boost::thread m_thread;
+};
+
+#endif // TELEMETRYRECORDER_H
@@ -0,0 +1,180 @@
+#include "TrafficCounters.h"
+
+#include "FrameCodec.h"
+
+#include <cstdio>
+#include <sstream>
+#include <utility>
+
+TrafficCounters::CommandCounts TrafficCounters::Snapshot::getTotal(TelemetryDirection direction) const
+{
+	CommandCounts total;
+	for (const CommandCounts& counts : commands[size_t(direction)])
+	{
+		total.frames += counts.frames;
+		total.bytes += counts.bytes;
+		total.checksumFailures += counts.checksumFailures;
+	}
+	return total;
+}
+
+TrafficCounters::Snapshot TrafficCounters::Snapshot::operator -(const Snapshot& earlier) const
+{
+	Snapshot delta;
+	delta.time = time;
+	for (size_t direction = 0; direction < commands.size(); ++direction)
+	{
+		for (size_t cmd = 0; cmd < commands[direction].size(); ++cmd)
+		{
+			delta.commands[direction][cmd].frames = commands[direction][cmd].frames - earlier.commands[direction][cmd].frames;
+			delta.commands[direction][cmd].bytes = commands[direction][cmd].bytes - earlier.commands[direction][cmd].bytes;
+			delta.commands[direction][cmd].checksumFailures = commands[direction][cmd].checksumFailures - earlier.commands[direction][cmd].checksumFailures;
+		}
+	}
+	delta.unknownCommands = unknownCommands - earlier.unknownCommands;
+	delta.resyncEvents = resyncEvents - earlier.resyncEvents;
+	delta.discardedBytes = discardedBytes - earlier.discardedBytes;
+	return delta;
+}
+
+void TrafficCounters::countFrame(TelemetryDirection direction, ConstByteSpan frame, bool checksumIsOk, size_t wireSize)
+{
+	AtomicCommandCounts& counts = m_commands[size_t(direction)][getFrameCommand(frame)];
+	counts.frames.fetch_add(1, std::memory_order_relaxed);
+	counts.bytes.fetch_add(wireSize, std::memory_order_relaxed);
+	if (!checksumIsOk)
+	{
+		counts.checksumFailures.fetch_add(1, std::memory_order_relaxed);
+	}
+	m_totalBytes[size_t(direction)].fetch_add(wireSize, std::memory_order_relaxed);
+}
+
+void TrafficCounters::countDiscardedBytes(uint64_t count)
+{
+	m_discardedBytes.fetch_add(count, std::memory_order_relaxed);
+	m_totalBytes[size_t(TelemetryDirection::Rx)].fetch_add(count, std::memory_order_relaxed);
+}
+
+TrafficCounters::Snapshot TrafficCounters::getSnapshot() const
+{
+	Snapshot snapshot;
+	snapshot.time = std::chrono::steady_clock::now();
+	for (size_t direction = 0; direction < m_commands.size(); ++direction)
+	{
+		for (size_t cmd = 0; cmd < m_commands[direction].size(); ++cmd)
+		{
+			snapshot.commands[direction][cmd].frames = m_commands[direction][cmd].frames.load(std::memory_order_relaxed);
+			snapshot.commands[direction][cmd].bytes = m_commands[direction][cmd].bytes.load(std::memory_order_relaxed);
+			snapshot.commands[direction][cmd].checksumFailures = m_commands[direction][cmd].checksumFailures.load(std::memory_order_relaxed);
+		}
+	}
+	snapshot.unknownCommands = m_unknownCommands.load(std::memory_order_relaxed);
+	snapshot.resyncEvents = m_resyncEvents.load(std::memory_order_relaxed);
+	snapshot.discardedBytes = m_discardedBytes.load(std::memory_order_relaxed);
+	return snapshot;
+}
+
+TrafficWindow::TrafficWindow(std::chrono::steady_clock::duration maxAge)
+	: m_maxAge(maxAge)
+{
+}
+
+void TrafficWindow::add(const TrafficCounters::Snapshot& snapshot)
+{
+	m_snapshots.push_back(snapshot);
+
+	//keep one snapshot at or beyond maxAge so a full window can be measured
+	while (m_snapshots.size() > 2 && snapshot.time - m_snapshots[1].time >= m_maxAge)
+	{
+		m_snapshots.pop_front();
+	}
+}
+
+TrafficCounters::Snapshot TrafficWindow::getDelta(std::chrono::steady_clock::duration window, double& seconds) const
+{
+	if (m_snapshots.size() < 2)
+	{
+		seconds = 0;
+		return TrafficCounters::Snapshot();
+	}
+
+	const TrafficCounters::Snapshot& newest = m_snapshots.back();
+	auto oldest = m_snapshots.begin();
+	while (newest.time - oldest->time > window && oldest + 2 != m_snapshots.end())
+	{
+		++oldest;
+	}
+
+	seconds = std::chrono::duration<double>(newest.time - oldest->time).count();
+	return newest - *oldest;
+}
+
+namespace
+{
+
+const char* getDirectionLabel(size_t direction)
+{
+	return direction == size_t(TelemetryDirection::Rx) ? "rx" : "tx";
+}
+
+void writeCommandCounter(std::ostream& strm, const TrafficCounters::Snapshot& snapshot, const char* pName, const char* pHelp,
+						 uint64_t TrafficCounters::CommandCounts::*pCount)
+{
+	strm << "# HELP " << pName << ' ' << pHelp << "\n# TYPE " << pName << " counter\n";
+	for (size_t direction = 0; direction < snapshot.commands.size(); ++direction)
+	{
+		for (size_t cmd = 0; cmd < snapshot.commands[direction].size(); ++cmd)
+		{
+			//commands never seen are left out, Prometheus treats a missing series as 0
+			if (snapshot.commands[direction][cmd].frames == 0)
+				continue;
+
+			char cmdLabel[8];
+			snprintf(cmdLabel, sizeof(cmdLabel), "0x%02x", unsigned(cmd));
+			strm << pName << "{direction=\"" << getDirectionLabel(direction) << "\",cmd=\"" << cmdLabel << "\"} "
+				 << snapshot.commands[direction][cmd].*pCount << '\n';
+		}
+	}
+}
+
+void writeCounter(std::ostream& strm, const char* pName, const char* pHelp, uint64_t value)
+{
+	strm << "# HELP " << pName << ' ' << pHelp << "\n# TYPE " << pName << " counter\n" << pName << ' ' << value << '\n';
+}
+
+}
+
+void writePrometheusMetrics(std::ostream& strm, const TrafficCounters::Snapshot& snapshot, const TrafficWindow& window, unsigned baudRate)
+{
+	writeCommandCounter(strm, snapshot, "mccar_frames_total", "Frames on the link by direction and cmd.", &TrafficCounters::CommandCounts::frames);
+	writeCommandCounter(strm, snapshot, "mccar_bytes_total", "Bytes of whole frames on the link by direction and cmd.", &TrafficCounters::CommandCounts::bytes);
+	writeCommandCounter(strm, snapshot, "mccar_checksum_failures_total", "Frames dropped for a wrong crc8 by direction and cmd.",
+						&TrafficCounters::CommandCounts::checksumFailures);
+	writeCounter(strm, "mccar_unknown_commands_total", "Frames received in sync with a cmd the host does not know.", snapshot.unknownCommands);
+	writeCounter(strm, "mccar_resyncs_total", "Times the receiver lost the frame boundaries.", snapshot.resyncEvents);
+	writeCounter(strm, "mccar_discarded_bytes_total", "Received bytes dropped while looking for a frame boundary.", snapshot.discardedBytes);
+
+	strm << "# HELP mccar_bytes_per_second Bytes on the link per second over a sliding window.\n"
+			"# TYPE mccar_bytes_per_second gauge\n";
+	std::ostringstream utilization;
+	for (const auto& length : { std::make_pair(std::chrono::seconds(1), "1s"), std::make_pair(std::chrono::seconds(10), "10s") })
+	{
+		double seconds;
+		const TrafficCounters::Snapshot delta = window.getDelta(length.first, seconds);
+		if (seconds <= 0)
+			continue;
+
+		for (size_t direction = 0; direction < snapshot.commands.size(); ++direction)
+		{
+			const char* pDirection = getDirectionLabel(direction);
+			const double bytesPerSecond = (delta.getTotal(TelemetryDirection(direction)).bytes
+										   + (direction == size_t(TelemetryDirection::Rx) ? delta.discardedBytes : 0)) / seconds;
+			strm << "mccar_bytes_per_second{direction=\"" << pDirection << "\",window=\"" << length.second << "\"} " << bytesPerSecond << '\n';
+			utilization << "mccar_link_utilization{direction=\"" << pDirection << "\",window=\"" << length.second << "\"} "
+						<< bytesPerSecond / getLinkBytesPerSecond(baudRate) << '\n';
+		}
+	}
+
+	strm << "# HELP mccar_link_utilization Share of the baud rate in use over a sliding window.\n"
+			"# TYPE mccar_link_utilization gauge\n" << utilization.str();
+}
@@ -0,0 +1,114 @@
+#ifndef TRAFFICCOUNTERS_H
+#define TRAFFICCOUNTERS_H
+
+#include "ByteSpan.h"
+#include "FrameCodec.h"
+#include "TelemetryRecorder.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+
+/**
+Counts frames and bytes on the link per cmd and direction, and the errors of the receive path.
+
+Each direction is counted by one thread (receive and transmit thread), any thread may take a snapshot
+at any time; nothing is locked. The snapshot is not atomic as a whole, a frame may show up in frames before bytes.
+*/
+class TrafficCounters
+{
+public:
+	struct CommandCounts
+	{
+		uint64_t frames = 0;
+		uint64_t bytes = 0;
+		uint64_t checksumFailures = 0;
+	};
+
+	struct Snapshot
+	{
+		std::chrono::steady_clock::time_point time;
+		std::array<std::array<CommandCounts, 256>, 2> commands; ///< indexed by TelemetryDirection and cmd
+		uint64_t unknownCommands = 0;
+		uint64_t resyncEvents = 0;
+		uint64_t discardedBytes = 0;
+
+		const CommandCounts& get(TelemetryDirection direction, uint8_t cmd) const { return commands[size_t(direction)][cmd]; }
+		CommandCounts getTotal(TelemetryDirection direction) const;
+
+		/**
+		@returns the counts between earlier and this, time is this->time
+		*/
+		Snapshot operator -(const Snapshot& earlier) const;
+	};
+
+	TrafficCounters() = default;
+	TrafficCounters(const TrafficCounters&) = delete;
+	TrafficCounters& operator =(const TrafficCounters&) = delete;
+
+	/**
+	@param wireSize bytes the frame took on the link, less than its size in COBS framing
+	*/
+	void countFrame(TelemetryDirection direction, ConstByteSpan frame, bool checksumIsOk = true, size_t wireSize = getFrameSize());
+	void countUnknownCommands(uint64_t count) { m_unknownCommands.fetch_add(count, std::memory_order_relaxed); }
+	void countResyncEvents(uint64_t count) { m_resyncEvents.fetch_add(count, std::memory_order_relaxed); }
+	void countDiscardedBytes(uint64_t count);
+
+	/**
+	All bytes of one direction, including the discarded ones
+	*/
+	const std::atomic_uint_fast64_t& getByteCounter(TelemetryDirection direction) const { return m_totalBytes[size_t(direction)]; }
+
+	Snapshot getSnapshot() const;
+
+private:
+	struct AtomicCommandCounts
+	{
+		std::atomic<uint64_t> frames{0};
+		std::atomic<uint64_t> bytes{0};
+		std::atomic<uint64_t> checksumFailures{0};
+	};
+
+	std::array<std::array<AtomicCommandCounts, 256>, 2> m_commands;
+	std::array<std::atomic_uint_fast64_t, 2> m_totalBytes{};
+	std::atomic<uint64_t> m_unknownCommands{0};
+	std::atomic<uint64_t> m_resyncEvents{0};
+	std::atomic<uint64_t> m_discardedBytes{0};
+};
+
+/**
+Keeps the snapshots of the last maxAge to derive rates over sliding windows of up to that length
+*/
+class TrafficWindow
+{
+public:
+	explicit TrafficWindow(std::chrono::steady_clock::duration maxAge = std::chrono::seconds(10));
+
+	void add(const TrafficCounters::Snapshot& snapshot);
+
+	/**
+	@returns the counts since the oldest snapshot not older than window
+	@param seconds length of the interval they were counted in, 0 if there are less than two snapshots
+	*/
+	TrafficCounters::Snapshot getDelta(std::chrono::steady_clock::duration window, double& seconds) const;
+
+private:
+	const std::chrono::steady_clock::duration m_maxAge;
+	std::deque<TrafficCounters::Snapshot> m_snapshots;
+};
+
+/**
+Bytes per second a UART link carries with 8N1 framing
+*/
+constexpr double getLinkBytesPerSecond(unsigned baudRate) { return baudRate / 10.0; }
+
+/**
+Writes the counters and the rates over 1 s and 10 s in the Prometheus text exposition format
+@param baudRate to derive the link utilization
+*/
+void writePrometheusMetrics(std::ostream& strm, const TrafficCounters::Snapshot& snapshot, const TrafficWindow& window, unsigned baudRate);
+
+#endif // TRAFFICCOUNTERS_H
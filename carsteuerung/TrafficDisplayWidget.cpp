@@ -0,0 +1,72 @@
+#include "TrafficDisplayWidget.h"
+#include "ui_TrafficDisplayWidget.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace
+{
+
+QString formatRate(const TrafficCounters::Snapshot& delta, double seconds, TelemetryDirection direction, unsigned baudRate)
+{
+	if (seconds <= 0)
+		return "n/a";
+
+	uint64_t bytes = delta.getTotal(direction).bytes;
+	if (direction == TelemetryDirection::Rx)
+	{
+		bytes += delta.discardedBytes;
+	}
+	const double bytesPerSecond = bytes / seconds;
+	return QString::number(bytesPerSecond, 'f', 0) + " Bytes/s (" + QString::number(100 * bytesPerSecond / getLinkBytesPerSecond(baudRate), 'f', 1)
+		   + "% of " + QString::number(baudRate) + " baud)";
+}
+
+}
+
+TrafficDisplayWidget::TrafficDisplayWidget(QWidget *parent) :
+	QWidget(parent),
+	ui(new Ui::TrafficDisplayWidget)
+{
+	ui->setupUi(this);
+}
+
+TrafficDisplayWidget::~TrafficDisplayWidget()
+{
+	delete ui;
+}
+
+void TrafficDisplayWidget::refresh(const TrafficCounters::Snapshot& snapshot, const TrafficWindow& window, unsigned baudRate)
+{
+	double seconds;
+	const TrafficCounters::Snapshot delta = window.getDelta(std::chrono::seconds(10), seconds);
+
+	ui->receiveRate->setText(formatRate(delta, seconds, TelemetryDirection::Rx, baudRate));
+	ui->sendRate->setText(formatRate(delta, seconds, TelemetryDirection::Tx, baudRate));
+	ui->checksumFailures->setText(QString::number(snapshot.getTotal(TelemetryDirection::Rx).checksumFailures));
+	ui->unknownCommands->setText(QString::number(snapshot.unknownCommands));
+	ui->resyncs->setText(QString::number(snapshot.resyncEvents) + " (" + QString::number(snapshot.discardedBytes) + " Bytes discarded)");
+
+	//one line per cmd and direction seen so far, rates over the last 10 s
+	std::string text;
+	char line[128];
+	for (TelemetryDirection direction : { TelemetryDirection::Rx, TelemetryDirection::Tx })
+	{
+		for (unsigned cmd = 0; cmd < 256; ++cmd)
+		{
+			const TrafficCounters::CommandCounts& counts = snapshot.get(direction, uint8_t(cmd));
+			if (counts.frames == 0)
+				continue;
+
+			const double framesPerSecond = seconds > 0 ? delta.get(direction, uint8_t(cmd)).frames / seconds : 0;
+			snprintf(line, sizeof(line), "%s 0x%02x: %10" PRIu64 " frames %8.1f/s %6" PRIu64 " crc failures\n",
+					 direction == TelemetryDirection::Rx ? "rx" : "tx", cmd, counts.frames, framesPerSecond, counts.checksumFailures);
+			text += line;
+		}
+	}
+	if (!text.empty())
+	{
+		text.pop_back();
+	}
+	ui->commands->setText(QString::fromStdString(text));
+}
@@ -0,0 +1,33 @@
+#ifndef TRAFFICDISPLAYWIDGET_H
+#define TRAFFICDISPLAYWIDGET_H
+
+#include <QWidget>
+
+#include "TrafficCounters.h"
+
+namespace Ui {
+class TrafficDisplayWidget;
+}
+
+/**
+Shows the link utilization, the error counters and the traffic per cmd
+*/
+class TrafficDisplayWidget : public QWidget
+{
+	Q_OBJECT
+
+public:
+	explicit TrafficDisplayWidget(QWidget *parent = 0);
+	~TrafficDisplayWidget();
+
+	/**
+	Call from the GUI thread
+	@param baudRate to derive the link utilization
+	*/
+	void refresh(const TrafficCounters::Snapshot& snapshot, const TrafficWindow& window, unsigned baudRate);
+
+private:
+	Ui::TrafficDisplayWidget *ui;
+};
+
+#endif // TRAFFICDISPLAYWIDGET_H
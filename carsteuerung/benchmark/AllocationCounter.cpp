@@ -0,0 +1,40 @@
+#include "Benchmark.h"
+
+#include <atomic>
+#include <cstdlib>
+
+//glibc's allocator behind the replacements below
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+namespace
+{
+
+std::atomic<uint64_t> allocationCount{0};
+
+}
+
+uint64_t getAllocationCount()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+//operator new as well as Qt's containers end up in malloc(), so counting here catches both
+extern "C" void* malloc(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	return __libc_realloc(ptr, size);
+}
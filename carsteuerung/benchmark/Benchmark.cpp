@@ -0,0 +1,80 @@
+#include "Benchmark.h"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+
+struct ReportEntry
+{
+	BenchmarkResult result;
+	std::string unit;
+};
+
+std::vector<ReportEntry>& getReport()
+{
+	static std::vector<ReportEntry> report;
+	return report;
+}
+
+std::string toJsonString(const std::string& text)
+{
+	std::string json = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			json += '\\';
+			json += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			json += escaped;
+		}
+		else
+		{
+			json += c;
+		}
+	}
+	return json + '"';
+}
+
+}
+
+void printResult(const BenchmarkResult& result, const char* unit)
+{
+	std::cout << result.name << ": " << static_cast<uint64_t>(result.operationsPerSecond()) << " " << unit << "/s"
+			  << " (" << result.nanosecondsPerOperation() << " ns/op, " << result.allocationsPerOperation() << " allocs/op)" << std::endl;
+	getReport().push_back(ReportEntry{result, unit});
+}
+
+bool writeJsonReport(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "{\n\t\"benchmarks\": [";
+	const char* pSeparator = "\n";
+	for (const ReportEntry& entry : getReport())
+	{
+		const BenchmarkResult& result = entry.result;
+		file << pSeparator
+			 << "\t\t{ \"name\": " << toJsonString(result.name)
+			 << ", \"unit\": " << toJsonString(entry.unit)
+			 << ", \"operations\": " << result.operations
+			 << ", \"seconds\": " << result.seconds
+			 << ", \"ns_per_op\": " << result.nanosecondsPerOperation()
+			 << ", \"allocs_per_op\": " << result.allocationsPerOperation() << " }";
+		pSeparator = ",\n";
+	}
+	file << "\n\t]\n}\n";
+
+	return bool(file.flush());
+}
@@ -0,0 +1,84 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/**
+Keeps the compiler from optimizing away a value that is otherwise unused
+*/
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+Calls of operator new so far, in all threads (AllocationCounter.cpp)
+*/
+uint64_t getAllocationCount();
+
+struct BenchmarkResult
+{
+	std::string name;
+	uint64_t operations;
+	double seconds;
+	uint64_t allocations = 0;
+
+	double operationsPerSecond() const { return operations / seconds; }
+	double nanosecondsPerOperation() const { return seconds * 1e9 / operations; }
+	double allocationsPerOperation() const { return double(allocations) / operations; }
+};
+
+/**
+Calls fn(i) for i in [0, operations) and measures the time it takes
+*/
+template <typename Fn>
+BenchmarkResult runBenchmark(std::string name, uint64_t operations, Fn fn)
+{
+	const uint64_t allocationsBefore = getAllocationCount();
+	const auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < operations; ++i)
+	{
+		fn(i);
+	}
+	const auto stop = std::chrono::steady_clock::now();
+
+	return BenchmarkResult{std::move(name), operations, std::chrono::duration<double>(stop - start).count(),
+						   getAllocationCount() - allocationsBefore};
+}
+
+/**
+Prints result and keeps it for writeJsonReport()
+*/
+void printResult(const BenchmarkResult& result, const char* unit);
+
+/**
+Writes all results printed so far to path as JSON, to compare them between versions
+@returns false if path could not be written
+*/
+bool writeJsonReport(const std::string& path);
+
+/**
+Reports a benchmark that computed a wrong result, which would render its numbers meaningless
+*/
+inline void checkResult(const std::string& name, bool resultIsCorrect)
+{
+	if (!resultIsCorrect)
+	{
+		std::cerr << name << ": wrong result" << std::endl;
+	}
+}
+
+void benchmarkFrameCodec();
+void benchmarkFraming();
+void benchmarkCrc8();
+void benchmarkCommandDispatcher();
+void benchmarkSerialTransport();
+void benchmarkInvokeInEventLoop();
+void benchmarkSwapStore();
+void benchmarkLogSink();
+
+#endif // BENCHMARK_H
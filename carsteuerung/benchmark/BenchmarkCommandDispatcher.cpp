@@ -0,0 +1,134 @@
+#include "Benchmark.h"
+
+#include <CommandDispatcher.h>
+#include <FrameParser.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+const uint8_t unknownCommand = 0x55;
+
+/**
+Telemetry like the MC sends it while swapping: status, resource and swap chunks, now and then an unknown cmd
+*/
+std::vector<uint8_t> makeCapture(size_t frameCount)
+{
+	std::vector<uint8_t> capture(frameCount * getFrameSize());
+	for (size_t i = 0; i < frameCount; ++i)
+	{
+		uint8_t* pFrame = &capture[i * getFrameSize()];
+		if (i % 64 == 63)
+		{
+			std::memset(pFrame, 0, getFrameSize());
+			pFrame[0] = unknownCommand;
+			pFrame[getFrameSize() - 1] = calculateFrameChecksum(pFrame);
+			continue;
+		}
+
+		switch (i % 3)
+		{
+		case 0:
+		{
+			StatusPayload status = {};
+			status.voltageL = static_cast<uint8_t>(i);
+			encodeFrame(RequestDataPacket<StatusPayload>(status), pFrame);
+			break;
+		}
+		case 1:
+		{
+			ResourcePayload resource = {};
+			resource.usedPages = static_cast<uint8_t>(i);
+			encodeFrame(RequestDataPacket<ResourcePayload>(resource), pFrame);
+			break;
+		}
+		default:
+		{
+			WriteDataPayload chunk = {};
+			chunk.offsetLow = static_cast<uint8_t>(i);
+			encodeFrame(RequestDataPacket<WriteDataPayload>(chunk), pFrame);
+			break;
+		}
+		}
+	}
+	return capture;
+}
+
+struct HandledFrames
+{
+	uint64_t status = 0;
+	uint64_t resource = 0;
+	uint64_t writeData = 0;
+	uint64_t unknown = 0;
+
+	uint64_t total() const { return status + resource + writeData + unknown; }
+};
+
+void registerHandlers(HostCommandDispatcher& dispatcher, HandledFrames& handled)
+{
+	dispatcher.registerHandler<StatusPayload>([&handled](const RequestDataPacket<StatusPayload>& data)
+	{
+		handled.status += data.checksumIsOk;
+	});
+	dispatcher.registerHandler<ResourcePayload>([&handled](const RequestDataPacket<ResourcePayload>& data)
+	{
+		handled.resource += data.checksumIsOk;
+	});
+	dispatcher.registerHandler<WriteDataPayload>([&handled](const RequestDataPacket<WriteDataPayload>& data)
+	{
+		handled.writeData += data.checksumIsOk;
+	});
+	dispatcher.setUnknownCommandHandler([&handled](ConstByteSpan)
+	{
+		++handled.unknown;
+	});
+}
+
+}
+
+void benchmarkCommandDispatcher()
+{
+	const size_t frameCount = 1 << 20;
+	const std::vector<uint8_t> capture = makeCapture(frameCount);
+
+	{
+		HostCommandDispatcher dispatcher;
+		HandledFrames handled;
+		registerHandlers(dispatcher, handled);
+
+		printResult(runBenchmark("dispatch", frameCount, [&](uint64_t i)
+		{
+			dispatcher.dispatch(ConstByteSpan(&capture[i * getFrameSize()], getFrameSize()));
+		}), "frames");
+		checkResult("dispatch", handled.total() == frameCount && handled.unknown == frameCount / 64);
+	}
+
+	{
+		//the receive path: chunks as the transport reads them, cut into frames and dispatched
+		HostCommandDispatcher dispatcher;
+		HandledFrames handled;
+		registerHandlers(dispatcher, handled);
+		FrameParser parser(HostCommandDispatcher::getKnownCommands());
+
+		const size_t chunkSize = 1024;
+		auto result = runBenchmark("parse and dispatch", (capture.size() + chunkSize - 1) / chunkSize, [&](uint64_t i)
+		{
+			const size_t offset = i * chunkSize;
+			parser.feed(&capture[offset], std::min(chunkSize, capture.size() - offset));
+
+			Frame frame;
+			bool checksumIsOk;
+			while (parser.nextFrame(frame, checksumIsOk))
+			{
+				dispatcher.dispatch(ConstByteSpan(frame.data(), frame.size()));
+			}
+		});
+		result.operations = frameCount;
+		printResult(result, "frames");
+		//the unknown cmd is not taken as a frame, the parser discards it
+		checkResult("parse and dispatch", handled.total() == frameCount - frameCount / 64);
+	}
+}
@@ -0,0 +1,82 @@
+#include "Benchmark.h"
+
+#include <Crc8.h>
+#include <FrameCodec.h>
+
+#include <boost/crc.hpp>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+std::vector<uint8_t> makeCapture(size_t frameCount)
+{
+	std::mt19937 random(42);
+	std::vector<uint8_t> capture(frameCount * getFrameSize());
+	for (size_t i = 0; i < frameCount; ++i)
+	{
+		uint8_t* pFrame = &capture[i * getFrameSize()];
+		pFrame[0] = StatusPayload::cmd_id;
+		for (size_t j = 1; j <= getPayloadSize(); ++j)
+		{
+			pFrame[j] = static_cast<uint8_t>(random());
+		}
+		pFrame[getFrameSize() - 1] = calculateFrameChecksum(pFrame);
+
+		//some corrupted frames, like on a noisy link
+		if (i % 7 == 0)
+		{
+			pFrame[1 + i % getPayloadSize()] ^= 0x10;
+		}
+	}
+	return capture;
+}
+
+}
+
+void benchmarkCrc8()
+{
+	const size_t frameCount = (8 << 20) / getFrameSize(); //8 MiB capture
+	const std::vector<uint8_t> capture = makeCapture(frameCount);
+	const size_t expectedValidFrames = frameCount - (frameCount + 6) / 7;
+
+	size_t validFrames = 0;
+	printResult(runBenchmark("crc8/boost", frameCount, [&](uint64_t i)
+	{
+		const uint8_t* pFrame = &capture[i * getFrameSize()];
+		boost::crc_optimal<8, 0x9B, 0, 0, false, false> crc;
+		for (size_t j = 1; j <= getPayloadSize(); ++j)
+		{
+			crc.process_byte(pFrame[j]);
+		}
+		validFrames += crc.checksum() == pFrame[getFrameSize() - 1];
+	}), "frames");
+	checkResult("crc8/boost", validFrames == expectedValidFrames);
+
+	validFrames = 0;
+	printResult(runBenchmark("crc8/table", frameCount, [&](uint64_t i)
+	{
+		const uint8_t* pFrame = &capture[i * getFrameSize()];
+		validFrames += crc8(pFrame + 1, getPayloadSize()) == pFrame[getFrameSize() - 1];
+	}), "frames");
+	checkResult("crc8/table", validFrames == expectedValidFrames);
+
+	validFrames = 0;
+	printResult(runBenchmark("crc8/slice-by-4", frameCount, [&](uint64_t i)
+	{
+		const uint8_t* pFrame = &capture[i * getFrameSize()];
+		validFrames += crc8UpdateSliceBy4(0, pFrame + 1, getPayloadSize()) == pFrame[getFrameSize() - 1];
+	}), "frames");
+	checkResult("crc8/slice-by-4", validFrames == expectedValidFrames);
+
+	std::vector<uint64_t> validBitmap((frameCount + 63) / 64);
+	auto result = runBenchmark("crc8/validate frames", 1, [&](uint64_t)
+	{
+		validFrames = crc8ValidateFrames(capture.data(), frameCount, validBitmap.data());
+	});
+	result.operations = frameCount;
+	printResult(result, "frames");
+	checkResult("crc8/validate frames", validFrames == expectedValidFrames && (validBitmap[0] & 0x81) == 0 && (validBitmap[0] & 0x7E) == 0x7E);
+}
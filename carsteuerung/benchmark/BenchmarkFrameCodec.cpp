@@ -0,0 +1,336 @@
+#include "Benchmark.h"
+
+#include <CommandDispatcher.h>
+#include <FrameCodec.h>
+#include <FrameParser.h>
+
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using crc_8 = boost::crc_optimal<8, 0x9B, 0, 0, false, false>;
+
+//Former iostream based implementation of Payload.h, kept as baseline
+template <typename Payload>
+void legacyWrite(std::ostream& strm, const RequestDataPacket<Payload>& dataPacket)
+{
+	strm.unsetf(std::ios_base::skipws);
+	crc_8 crc;
+
+	strm << static_cast<unsigned char>(Payload::cmd_id);
+
+	const unsigned char* pRawData = reinterpret_cast<const unsigned char*>(&dataPacket.payload);
+	for (size_t i = 0; i < sizeof(Payload); ++i)
+	{
+		strm << pRawData[i];
+		crc.process_byte(pRawData[i]);
+	}
+	for (size_t i = 0; i < (getPayloadSize() - sizeof(Payload)); ++i)
+	{
+		strm << static_cast<unsigned char>(0);
+		crc.process_byte(0);
+	}
+
+	strm << static_cast<unsigned char>(crc.checksum());
+}
+
+template <typename Payload>
+void legacyRead(std::istream& strm, RequestDataPacket<Payload>& dataPacket)
+{
+	strm.unsetf(std::ios_base::skipws);
+	crc_8 crc;
+
+	unsigned char* pRawData = reinterpret_cast<unsigned char*>(&dataPacket.payload);
+	for (size_t i = 0; i < sizeof(Payload); ++i)
+	{
+		unsigned char tmp;
+		strm >> tmp;
+		pRawData[i] = tmp;
+		crc.process_byte(pRawData[i]);
+	}
+	for (size_t i = 0; i < (getPayloadSize() - sizeof(Payload)); ++i)
+	{
+		unsigned char padding;
+		strm >> padding;
+		crc.process_byte(padding);
+	}
+
+	unsigned char slaveCalculatedCrc;
+	strm >> slaveCalculatedCrc;
+	dataPacket.checksumIsOk = static_cast<unsigned char>(crc.checksum()) == slaveCalculatedCrc;
+}
+
+RequestDataPacket<StatusPayload> makeStatusPacket(uint64_t i)
+{
+	StatusPayload status = {};
+	status.voltageL = static_cast<uint8_t>(i);
+	status.currentL = static_cast<uint8_t>(i >> 8);
+	status.linePosition = 16;
+	status.lineWidthL = 3;
+	return RequestDataPacket<StatusPayload>(status);
+}
+
+/**
+The rate of commands like frame the link carries at 115200 baud, 10 bits per byte.
+Not measured, but reported like the measurements to follow it in the JSON report.
+*/
+BenchmarkResult getLinkRate(std::string name, Framing framing, const Frame& frame)
+{
+	uint8_t wireFrame[getMaxCobsFrameSize()];
+	const size_t wireSize = encodeWireFrame(framing, frame, wireFrame);
+	const uint64_t commands = 1000;
+	return BenchmarkResult{std::move(name), commands, commands * wireSize * 10 / 115200.0};
+}
+
+/**
+Feeds the encoded frames through a parser in framing and counts the frames with a good checksum
+*/
+size_t parseCapture(const std::vector<uint8_t>& capture, Framing framing)
+{
+	FrameParser parser(HostCommandDispatcher::getKnownCommands());
+	parser.setFraming(framing);
+
+	size_t checksumsOk = 0;
+	Frame frame;
+	bool checksumIsOk;
+	for (size_t offset = 0; offset < capture.size(); )
+	{
+		offset += parser.feed(&capture[offset], capture.size() - offset);
+		while (parser.nextFrame(frame, checksumIsOk))
+		{
+			checksumsOk += checksumIsOk;
+		}
+	}
+	return checksumsOk;
+}
+
+/**
+Feeds the frames with the byte at dropAt left out through a parser in fixed framing
+@returns the frames that came out intact, anything else the parser returned is added to garbage
+*/
+size_t parseWithDroppedByte(const std::vector<Frame>& frames, size_t dropAt, size_t& garbage)
+{
+	std::vector<uint8_t> capture;
+	for (const Frame& frame : frames)
+	{
+		capture.insert(capture.end(), frame.begin(), frame.end());
+	}
+	capture.erase(capture.begin() + dropAt);
+
+	FrameParser parser(HostCommandDispatcher::getKnownCommands());
+	parser.feed(capture.data(), capture.size());
+
+	size_t intact = 0;
+	Frame frame;
+	bool checksumIsOk;
+	while (parser.nextFrame(frame, checksumIsOk))
+	{
+		if (checksumIsOk && std::find(frames.begin(), frames.end(), frame) != frames.end())
+		{
+			++intact;
+		}
+		else
+		{
+			++garbage;
+		}
+	}
+	return intact;
+}
+
+}
+
+void benchmarkFrameCodec()
+{
+	const uint64_t frameCount = 1 << 20;
+
+	{
+		std::stringstream strm;
+		printResult(runBenchmark("encode/iostream", frameCount, [&](uint64_t i)
+		{
+			legacyWrite(strm, makeStatusPacket(i));
+		}), "frames");
+	}
+
+	{
+		std::vector<uint8_t> buffer(frameCount * getFrameSize());
+		printResult(runBenchmark("encode/codec", frameCount, [&](uint64_t i)
+		{
+			encodeFrame(makeStatusPacket(i), &buffer[i * getFrameSize()]);
+		}), "frames");
+		doNotOptimize(buffer);
+	}
+
+	{
+		const size_t batchSize = 64;
+		std::vector<RequestDataPacket<StatusPayload>> packets;
+		for (size_t i = 0; i < batchSize; ++i)
+		{
+			packets.push_back(makeStatusPacket(i));
+		}
+		std::vector<uint8_t> buffer(batchSize * getFrameSize());
+
+		auto result = runBenchmark("encode/codec batch", frameCount / batchSize, [&](uint64_t)
+		{
+			encodeFrames(packets.begin(), packets.end(), buffer.data(), buffer.size());
+			doNotOptimize(buffer);
+		});
+		result.operations *= batchSize;
+		printResult(result, "frames");
+	}
+
+	std::vector<uint8_t> capture(frameCount * getFrameSize());
+	for (uint64_t i = 0; i < frameCount; ++i)
+	{
+		encodeFrame(makeStatusPacket(i), &capture[i * getFrameSize()]);
+	}
+
+	{
+		//the receive thread reads cmd first and then the remainder of the frame
+		std::stringstream strm(std::string(capture.begin(), capture.end()));
+		strm.unsetf(std::ios_base::skipws);
+		size_t checksumsOk = 0;
+		printResult(runBenchmark("decode/iostream", frameCount, [&](uint64_t)
+		{
+			unsigned char cmd;
+			strm >> cmd;
+			RequestDataPacket<StatusPayload> data;
+			legacyRead(strm, data);
+			checksumsOk += data.checksumIsOk;
+		}), "frames");
+		doNotOptimize(checksumsOk);
+	}
+
+	{
+		size_t checksumsOk = 0;
+		printResult(runBenchmark("decode/codec", frameCount, [&](uint64_t i)
+		{
+			RequestDataPacket<StatusPayload> data;
+			decodeFrame(ConstByteSpan(&capture[i * getFrameSize()], getFrameSize()), data);
+			checksumsOk += data.checksumIsOk;
+		}), "frames");
+		doNotOptimize(checksumsOk);
+	}
+
+	{
+		//the telemetry of the MC, its payloads carry known cmds (0x01 Move, 0x03 ConfigPID) that a misaligned parser meets
+		std::vector<Frame> frames;
+		for (uint64_t i = 0; i < 20; ++i)
+		{
+			frames.push_back(encodeFrame(makeStatusPacket(0x0300 + i)));
+			frames.push_back(encodeFrame(RequestDataPacket<ResourcePayload>(ResourcePayload{1, 3, 29, 64, 0, 255, 1, 3, 40, 0x01})));
+		}
+
+		//a lost byte costs its frame, a misaligned frame that passes the checksum by chance the one after it as well
+		size_t garbage = 0;
+		size_t maxGarbage = 0;
+		size_t maxLost = 0;
+		auto result = runBenchmark("parse/fixed one byte dropped", frames.size() * getFrameSize(), [&](uint64_t i)
+		{
+			const size_t garbageBefore = garbage;
+			maxLost = std::max(maxLost, frames.size() - parseWithDroppedByte(frames, i, garbage));
+			maxGarbage = std::max(maxGarbage, garbage - garbageBefore);
+		});
+		checkResult(result.name, maxLost <= 2 && maxGarbage <= 1 && garbage * 64 < result.operations);
+		printResult(result, "streams");
+	}
+}
+
+void benchmarkFraming()
+{
+	//what a command costs on the link
+	const Frame move = encodeFrame(RequestDataPacket<MovePayload>(MovePayload{0x09}));
+	const Frame configPid = encodeFrame(RequestDataPacket<ConfigPIDPayload>(ConfigPIDPayload{20, 5, 1, 20, 5, 1}));
+	const Frame status = encodeFrame(makeStatusPacket(0x1234));
+	ReliablePayload swapData = {};
+	swapData.seq = 3;
+	swapData.cmd = ReliableWriteDataPayload::cmd_id;
+	swapData.data[1] = 1;
+	std::fill(swapData.data + 2, swapData.data + sizeof(swapData.data), 0x55);
+	const Frame reliable = encodeFrame(RequestDataPacket<ReliablePayload>(swapData));
+
+	const std::pair<const char*, const Frame*> commands[] = {
+		{ "Move", &move }, { "ConfigPID", &configPid }, { "Status", &status }, { "ReliableWriteData", &reliable }
+	};
+	for (const auto& command : commands)
+	{
+		printResult(getLinkRate(std::string("link 115200/fixed ") + command.first, Framing::Fixed, *command.second), "commands");
+		printResult(getLinkRate(std::string("link 115200/cobs ") + command.first, Framing::Cobs, *command.second), "commands");
+	}
+
+	//the telemetry of the MC, as frames of their own and packed into a super-frame in the order taskSendRessource()
+	//and taskSendStatus() run. An idle MC: no background task waited for a whole tick, no one-shot task is queued.
+	const Frame resource = encodeFrame(RequestDataPacket<ResourcePayload>(ResourcePayload{1, 3, 29, 64, 0, 255, 1, 1, 0, 0}));
+	const Frame telemetry[] = { resource, status };
+	uint8_t wireFrame[getMaxCobsSuperFrameSize()];
+	const size_t telemetryFramesSize = encodeCobsFrame(status, wireFrame) + encodeCobsFrame(resource, wireFrame);
+	const size_t telemetrySuperFrameSize = encodeCobsSuperFrame(telemetry, 2, wireFrame);
+	checkResult("super-frame Status+Resource size", telemetrySuperFrameSize > 0 && telemetrySuperFrameSize < telemetryFramesSize);
+	printResult(BenchmarkResult{"link 115200/cobs Status+Resource", 1000, 1000 * telemetryFramesSize * 10 / 115200.0}, "reports");
+	printResult(BenchmarkResult{"link 115200/cobs super-frame Status+Resource", 1000, 1000 * telemetrySuperFrameSize * 10 / 115200.0}, "reports");
+
+	//a message of a cmd the host does not know is skipped, the ones after it still arrive
+	Frame unknown = resource;
+	unknown[0] = 0x0E;
+	const Frame withUnknown[] = { unknown, status };
+	std::vector<uint8_t> unknownCapture(getMaxCobsSuperFrameSize());
+	unknownCapture.resize(encodeCobsSuperFrame(withUnknown, 2, unknownCapture.data()));
+	checkResult("super-frame unknown message", !unknownCapture.empty() && parseCapture(unknownCapture, Framing::Cobs) == 1);
+
+	//and on the host
+	const uint64_t frameCount = 1 << 20;
+	std::vector<Frame> frames;
+	for (uint64_t i = 0; i < 64; ++i)
+	{
+		frames.push_back(encodeFrame(makeStatusPacket(i)));
+	}
+
+	std::vector<uint8_t> cobsCapture(frameCount * getMaxCobsFrameSize());
+	size_t cobsCaptureSize = 0;
+	printResult(runBenchmark("encode/cobs", frameCount, [&](uint64_t i)
+	{
+		cobsCaptureSize += encodeCobsFrame(frames[i % frames.size()], &cobsCapture[cobsCaptureSize]);
+	}), "frames");
+	cobsCapture.resize(cobsCaptureSize);
+
+	std::vector<uint8_t> fixedCapture(frameCount * getFrameSize());
+	for (uint64_t i = 0; i < frameCount; ++i)
+	{
+		std::copy(frames[i % frames.size()].begin(), frames[i % frames.size()].end(), &fixedCapture[i * getFrameSize()]);
+	}
+
+	for (const auto& capture : { std::make_pair(Framing::Fixed, &fixedCapture), std::make_pair(Framing::Cobs, &cobsCapture) })
+	{
+		size_t checksumsOk = 0;
+		auto result = runBenchmark(capture.first == Framing::Cobs ? "parse/cobs" : "parse/fixed", 1, [&](uint64_t)
+		{
+			checksumsOk = parseCapture(*capture.second, capture.first);
+		});
+		result.operations = frameCount;
+		checkResult(result.name, checksumsOk == frameCount);
+		printResult(result, "frames");
+	}
+
+	std::vector<uint8_t> superFrameCapture(frameCount / 2 * getMaxCobsSuperFrameSize());
+	size_t superFrameCaptureSize = 0;
+	for (uint64_t i = 0; i < frameCount / 2; ++i)
+	{
+		const Frame messages[] = { resource, frames[i % frames.size()] };
+		superFrameCaptureSize += encodeCobsSuperFrame(messages, 2, &superFrameCapture[superFrameCaptureSize]);
+	}
+	superFrameCapture.resize(superFrameCaptureSize);
+
+	size_t checksumsOk = 0;
+	auto result = runBenchmark("parse/cobs super-frame", 1, [&](uint64_t)
+	{
+		checksumsOk = parseCapture(superFrameCapture, Framing::Cobs);
+	});
+	result.operations = frameCount;
+	checkResult(result.name, checksumsOk == frameCount);
+	printResult(result, "frames");
+}
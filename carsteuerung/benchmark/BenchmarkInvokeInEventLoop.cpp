@@ -0,0 +1,161 @@
+#include "Benchmark.h"
+
+#include <DoAtScopeExit.h>
+#include <InvokeInEventLoop.h>
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QEventLoop>
+#include <QObject>
+
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <queue>
+
+namespace
+{
+
+//Former implementation of InvokeInEventLoop.cpp, one heap allocated QObject and event per call, kept as baseline
+class LegacyFnCallDeferrer : public QObject
+{
+public:
+	typedef std::function<void()> DeferredFn;
+
+	void callFnDeferred(const DeferredFn& fn)
+	{
+		m_deferredFnCalls.push(fn);
+		QCoreApplication::postEvent(this, new QEvent(QEvent::Type(QEvent::User + 100)));
+	}
+
+	bool event(QEvent* pEvent) override
+	{
+		std::queue<DeferredFn> queue;
+		std::swap(queue, m_deferredFnCalls);
+		while (!queue.empty())
+		{
+			queue.front()();
+			queue.pop();
+		}
+		pEvent->accept();
+		return true;
+	}
+
+private:
+	std::queue<DeferredFn> m_deferredFnCalls;
+};
+
+void legacyCallFnDeferredAsync(QObject* pTargetThread, const std::function<void()>& fn)
+{
+	LegacyFnCallDeferrer* pTmpDeferrer = new LegacyFnCallDeferrer();
+	pTmpDeferrer->moveToThread(pTargetThread->thread());
+	pTmpDeferrer->callFnDeferred([=]
+	{
+		DoAtScopeExit atExit([&]{ delete pTmpDeferrer; });
+		fn();
+	});
+}
+
+struct LatencyStatistics
+{
+	uint64_t calls = 0;
+	double totalNanoseconds = 0;
+	double maxNanoseconds = 0;
+
+	void add(std::chrono::steady_clock::time_point postTime)
+	{
+		const double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - postTime).count();
+		++calls;
+		totalNanoseconds += nanoseconds;
+		maxNanoseconds = std::max(maxNanoseconds, nanoseconds);
+	}
+};
+
+/**
+A worker thread posts callCount calls to the calling thread, like the receive thread does with
+telemetry frames. Runs the event loop until the last call arrived.
+*/
+template <typename PostFn>
+void benchmarkAsyncCalls(const std::string& name, uint64_t callCount, PostFn postFn)
+{
+	QObject target;
+	QEventLoop eventLoop;
+	LatencyStatistics statistics;
+
+	const uint64_t allocationsBefore = getAllocationCount();
+	const auto start = std::chrono::steady_clock::now();
+	boost::thread producer([&]
+	{
+		for (uint64_t i = 0; i < callCount; ++i)
+		{
+			const auto postTime = std::chrono::steady_clock::now();
+			postFn(&target, [&statistics, &eventLoop, postTime, callCount]
+			{
+				statistics.add(postTime);
+				if (statistics.calls == callCount)
+				{
+					eventLoop.quit();
+				}
+			});
+		}
+	});
+	eventLoop.exec();
+	const auto stop = std::chrono::steady_clock::now();
+	producer.join();
+
+	checkResult(name, statistics.calls == callCount);
+	printResult(BenchmarkResult{name, callCount, std::chrono::duration<double>(stop - start).count(),
+								getAllocationCount() - allocationsBefore}, "calls");
+	std::cout << name << " latency: " << statistics.totalNanoseconds / statistics.calls << " ns average, "
+			  << statistics.maxNanoseconds << " ns max" << std::endl;
+}
+
+/**
+A worker thread calls into the calling thread and waits for every call to return, each call is a round trip
+*/
+void benchmarkSyncCalls(const std::string& name, uint64_t callCount)
+{
+	QObject target;
+	QEventLoop eventLoop;
+	uint64_t calls = 0;
+
+	BenchmarkResult result;
+	boost::thread caller([&]
+	{
+		result = runBenchmark(name, callCount, [&](uint64_t)
+		{
+			callFnDeferredSync(&target, [&calls]
+			{
+				++calls;
+			});
+		});
+		callFnDeferredAsync(&target, [&eventLoop]
+		{
+			eventLoop.quit();
+		});
+	});
+	eventLoop.exec();
+	caller.join();
+
+	checkResult(name, calls == callCount);
+	printResult(result, "calls");
+}
+
+}
+
+void benchmarkInvokeInEventLoop()
+{
+	const uint64_t callCount = 200000;
+
+	benchmarkAsyncCalls("callFnDeferredAsync/legacy", callCount, [](QObject* pTarget, auto fn)
+	{
+		legacyCallFnDeferredAsync(pTarget, fn);
+	});
+
+	benchmarkAsyncCalls("callFnDeferredAsync", callCount, [](QObject* pTarget, auto fn)
+	{
+		callFnDeferredAsync(pTarget, std::move(fn));
+	});
+
+	benchmarkSyncCalls("callFnDeferredSync round trip", callCount / 4);
+}
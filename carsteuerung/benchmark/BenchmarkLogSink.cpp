@@ -0,0 +1,73 @@
+#include "Benchmark.h"
+
+#include <FrameCodec.h>
+#include <LogSink.h>
+
+#include <QDateTime>
+#include <QString>
+
+#include <cinttypes>
+
+namespace
+{
+
+/**
+Logs and drains in batches that fit into the ring, the time spent in log() and in drain() is summed up separately
+*/
+void benchmarkLogAndDrain(uint64_t lineCount)
+{
+	const size_t batchSize = 512;
+	std::atomic_uint_fast64_t byteCounter{0};
+	LogSink logSink(byteCounter);
+	std::string text;
+
+	BenchmarkResult logResult{"log", lineCount, 0};
+	BenchmarkResult drainResult{"log drain", lineCount, 0};
+	size_t drainedLines = 0;
+	for (uint64_t line = 0; line < lineCount; line += batchSize)
+	{
+		const uint64_t allocationsBeforeLog = getAllocationCount();
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = line; i < line + batchSize; ++i)
+		{
+			logSink.log("receiving data for buffer %u (offset: %u) ...", unsigned(i >> 6), unsigned(i & 0x3f) * 6);
+		}
+		const auto logged = std::chrono::steady_clock::now();
+		const uint64_t allocationsBeforeDrain = getAllocationCount();
+		text.clear();
+		drainedLines += logSink.drain(text);
+		const auto drained = std::chrono::steady_clock::now();
+
+		logResult.seconds += std::chrono::duration<double>(logged - start).count();
+		logResult.allocations += allocationsBeforeDrain - allocationsBeforeLog;
+		drainResult.seconds += std::chrono::duration<double>(drained - logged).count();
+		drainResult.allocations += getAllocationCount() - allocationsBeforeDrain;
+		byteCounter += getFrameSize();
+	}
+
+	checkResult("log", drainedLines == lineCount && logSink.getDroppedRecords() == 0);
+	printResult(logResult, "lines");
+	printResult(drainResult, "lines");
+}
+
+}
+
+void benchmarkLogSink()
+{
+	const uint64_t lineCount = 1 << 18;
+
+	//former printLog(): the whole line built as QString in the receive thread
+	uint64_t byteCount = 0;
+	int length = 0;
+	printResult(runBenchmark("log/QString", lineCount, [&](uint64_t i)
+	{
+		const QString text = QString("receiving data for buffer ") + QString::number(unsigned(i >> 6))
+							 + " (offset: " + QString::number(unsigned(i & 0x3f) * 6) + ") ...";
+		const QString line = QString::number(byteCount) + ", " + QDateTime::currentDateTime().toString("hh:mm:ss.zzz") + ": " + text;
+		length += line.size();
+		byteCount += getFrameSize();
+	}), "lines");
+	doNotOptimize(length);
+
+	benchmarkLogAndDrain(lineCount);
+}
@@ -0,0 +1,132 @@
+#include "Benchmark.h"
+
+#include "CommandDispatcher.h"
+#include "FrameParser.h"
+#include "SerialTransport.h"
+
+#include <pty.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+/**
+A pseudo-terminal pair standing in for the bluetooth link: the transport opens the slave side,
+the benchmark plays the MC on the master side.
+*/
+struct PseudoTerminal
+{
+	int masterFd = -1;
+	int slaveFd = -1;
+	std::string slaveName;
+
+	PseudoTerminal()
+	{
+		char name[64];
+		if (openpty(&masterFd, &slaveFd, name, nullptr, nullptr) == 0)
+		{
+			slaveName = name;
+		}
+	}
+
+	~PseudoTerminal()
+	{
+		::close(masterFd);
+		::close(slaveFd);
+	}
+
+	void writeAll(const uint8_t* pData, size_t size)
+	{
+		while (size > 0)
+		{
+			const ssize_t written = ::write(masterFd, pData, size);
+			if (written <= 0)
+				return;
+			pData += written;
+			size -= static_cast<size_t>(written);
+		}
+	}
+};
+
+std::vector<uint8_t> makeStatusFrames(size_t frameCount)
+{
+	std::vector<uint8_t> frames(frameCount * getFrameSize());
+	for (size_t i = 0; i < frameCount; ++i)
+	{
+		StatusPayload payload = {};
+		payload.voltageL = static_cast<uint8_t>(i);
+		encodeFrame(RequestDataPacket<StatusPayload>(payload), &frames[i * getFrameSize()]);
+	}
+	return frames;
+}
+
+}
+
+void benchmarkSerialTransport()
+{
+	PseudoTerminal pty;
+	SerialTransport transport;
+	if (pty.slaveName.empty() || !transport.open(pty.slaveName, 115200))
+	{
+		std::cerr << "serial transport: no pseudo-terminal: " << transport.getLastError() << std::endl;
+		return;
+	}
+
+	FrameParser parser(HostCommandDispatcher::getKnownCommands());
+	Frame frame;
+	bool checksumIsOk;
+
+	auto receiveFrames = [&](size_t frameCount) {
+		size_t received = 0;
+		while (received < frameCount)
+		{
+			size_t freeSpace;
+			uint8_t* pReceiveBuffer = parser.getWritePointer(freeSpace);
+			const size_t size = transport.read(pReceiveBuffer, freeSpace, 1000);
+			if (size == 0)
+				return received;
+			parser.commitWrite(size);
+
+			while (parser.nextFrame(frame, checksumIsOk))
+			{
+				++received;
+			}
+		}
+		return received;
+	};
+
+	//one frame there and back at a time: the latency the receive path adds
+	const std::vector<uint8_t> singleFrame = makeStatusFrames(1);
+	size_t pingsReceived = 0;
+	const BenchmarkResult pingResult = runBenchmark("pty single frame", 2000, [&](uint64_t) {
+		pty.writeAll(singleFrame.data(), singleFrame.size());
+		pingsReceived += receiveFrames(1);
+	});
+	checkResult(pingResult.name, pingsReceived == pingResult.operations);
+	printResult(pingResult, "frames");
+
+	//a writer streaming bursts: how many frames the chunked reads sustain
+	const size_t frameCount = 100000;
+	const std::vector<uint8_t> frames = makeStatusFrames(frameCount);
+	std::thread writer([&]() {
+		const size_t burstSize = 64 * getFrameSize();
+		for (size_t offset = 0; offset < frames.size(); offset += burstSize)
+		{
+			pty.writeAll(&frames[offset], std::min(burstSize, frames.size() - offset));
+		}
+	});
+
+	size_t streamReceived = 0;
+	const BenchmarkResult streamResult = runBenchmark("pty stream", 1, [&](uint64_t) {
+		streamReceived = receiveFrames(frameCount);
+	});
+	writer.join();
+
+	checkResult(streamResult.name, streamReceived == frameCount);
+	printResult(BenchmarkResult{streamResult.name, frameCount, streamResult.seconds, streamResult.allocations}, "frames");
+
+	transport.close();
+}
@@ -0,0 +1,69 @@
+#include "Benchmark.h"
+
+#include <FrameCodec.h>
+#include <SwapStore.h>
+
+#include <cstdlib>
+#include <unistd.h>
+
+namespace
+{
+
+const uint32_t slotCount = 64;
+const uint32_t slotSize = 4096;
+const size_t chunkSize = sizeof(WriteDataPayload::data);
+const size_t chunksPerBuffer = 40;
+
+/**
+Swaps out buffers of chunksPerBuffer WriteData chunks, one buffer after the other like the MC does,
+cycling through bufferCount buffer numbers
+*/
+void benchmarkAppend(SwapStore& swapStore, const std::string& name, uint16_t bufferCount)
+{
+	const uint8_t chunk[chunkSize] = { 1, 2, 3, 4, 5, 6 };
+	const uint64_t chunkCount = 1 << 20;
+
+	uint64_t appended = 0;
+	printResult(runBenchmark(name, chunkCount, [&](uint64_t i)
+	{
+		const uint16_t bufferNo = static_cast<uint16_t>(i / chunksPerBuffer % bufferCount);
+		const uint16_t offset = static_cast<uint16_t>(i % chunksPerBuffer * chunkSize);
+		appended += swapStore.append(bufferNo, offset, ConstByteSpan(chunk, chunkSize)) == SwapStore::AppendResult::Appended;
+	}), "chunks");
+	checkResult(name, appended == chunkCount);
+}
+
+}
+
+void benchmarkSwapStore()
+{
+	char path[] = "/tmp/benchmark-swap-XXXXXX";
+	const int fd = mkstemp(path);
+	if (fd < 0)
+	{
+		std::cerr << "swap store: no temporary file" << std::endl;
+		return;
+	}
+	::close(fd);
+
+	SwapStore swapStore;
+	if (!swapStore.open(path, slotCount, slotSize))
+	{
+		std::cerr << "swap store: " << swapStore.getLastError() << std::endl;
+		::unlink(path);
+		return;
+	}
+
+	benchmarkAppend(swapStore, "swap store append", slotCount);
+	benchmarkAppend(swapStore, "swap store append, evicting", slotCount * 4);
+
+	size_t bytesRead = 0;
+	printResult(runBenchmark("swap store read", 1 << 20, [&](uint64_t i)
+	{
+		bytesRead += swapStore.read(static_cast<uint16_t>(i % slotCount)).size();
+	}), "buffers");
+	doNotOptimize(bytesRead);
+
+	swapStore.close();
+	::unlink(path);
+}
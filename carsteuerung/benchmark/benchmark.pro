@@ -0,0 +1,54 @@
+#-------------------------------------------------
+#
+# Microbenchmarks for the host side protocol stack.
+# Runs without any serial hardware attached.
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+TARGET = benchmark
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp \
+    AllocationCounter.cpp \
+    Benchmark.cpp \
+    BenchmarkFrameCodec.cpp \
+    BenchmarkCrc8.cpp \
+    BenchmarkCommandDispatcher.cpp \
+    BenchmarkSerialTransport.cpp \
+    BenchmarkInvokeInEventLoop.cpp \
+    BenchmarkSwapStore.cpp \
+    BenchmarkLogSink.cpp \
+    ../Crc8.cpp \
+    ../DoAtScopeExit.cpp \
+    ../InvokeInEventLoop.cpp \
+    ../FrameParser.cpp \
+    ../LogSink.cpp \
+    ../SerialTransport.cpp \
+    ../SwapStore.cpp
+
+HEADERS += Benchmark.h \
+    ../ByteSpan.h \
+    ../CommandDispatcher.h \
+    ../Cobs.h \
+    ../Crc8.h \
+    ../DeferredCall.h \
+    ../DoAtScopeExit.h \
+    ../FrameCodec.h \
+    ../FrameParser.h \
+    ../InvokeInEventLoop.h \
+    ../LogSink.h \
+    ../MpscQueue.h \
+    ../SerialTransport.h \
+    ../SwapStore.h \
+    ../Payload.h
+
+LIBS += -lutil -lboost_thread -lboost_system -lpthread
+
+QMAKE_CXXFLAGS += -std=c++14
+QMAKE_CXXFLAGS_RELEASE += -O2
@@ -0,0 +1,41 @@
+#include "Benchmark.h"
+
+#include <QCoreApplication>
+
+#include <cstring>
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication application(argc, argv);
+
+	std::string jsonPath;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+		{
+			jsonPath = argv[++i];
+		}
+		else
+		{
+			std::cerr << "usage: benchmark [--json <path>]" << std::endl;
+			return 1;
+		}
+	}
+
+	benchmarkFrameCodec();
+	benchmarkFraming();
+	benchmarkCrc8();
+	benchmarkCommandDispatcher();
+	benchmarkSerialTransport();
+	benchmarkInvokeInEventLoop();
+	benchmarkSwapStore();
+	benchmarkLogSink();
+
+	if (!jsonPath.empty() && !writeJsonReport(jsonPath))
+	{
+		std::cerr << "could not write " << jsonPath << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -18,7 +18,24 @@ SOURCES += main.cpp\
     InvokeInEventLoop.cpp \
     DoAtScopeExit.cpp \
     ResourceStatusDisplayWidget.cpp \
-    CommonStatusDisplayWidget.cpp
+    CommonStatusDisplayWidget.cpp \
+    Crc8.cpp \
+    FrameParser.cpp \
+    SerialTransport.cpp \
+    FrameSender.cpp \
+    LogSink.cpp \
+    RotatingLogFile.cpp \
+    SwapStore.cpp \
+    TelemetryRecorder.cpp \
+    TelemetryReader.cpp \
+    CaptureReplay.cpp \
+    LatencyHistogram.cpp \
+    LatencyDisplayWidget.cpp \
+    TrafficCounters.cpp \
+    TrafficDisplayWidget.cpp \
+    ReliableLink.cpp \
+    BaudNegotiation.cpp \
+    FramingNegotiation.cpp
 
 HEADERS  += MainWindow.h \
     controller.h \
@@ -26,11 +43,42 @@ HEADERS  += MainWindow.h \
     DoAtScopeExit.h \
     Payload.h \
     ResourceStatusDisplayWidget.h \
-    CommonStatusDisplayWidget.h
+    CommonStatusDisplayWidget.h \
+    ByteSpan.h \
+    FrameCodec.h \
+    Cobs.h \
+    Crc8.h \
+    FrameParser.h \
+    CommandDispatcher.h \
+    SerialTransport.h \
+    MpscQueue.h \
+    DeferredCall.h \
+    FrameSender.h \
+    LogSink.h \
+    RotatingLogFile.h \
+    SwapStore.h \
+    TelemetryRecorder.h \
+    TelemetryReader.h \
+    CaptureReplay.h \
+    LatencyHistogram.h \
+    LatencyDisplayWidget.h \
+    TrafficCounters.h \
+    TrafficDisplayWidget.h \
+    ReliableLink.h \
+    BaudNegotiation.h \
+    FramingNegotiation.h
 
 FORMS    += MainWindow.ui \
     ResourceStatusDisplayWidget.ui \
-    CommonStatusDisplayWidget.ui
+    CommonStatusDisplayWidget.ui \
+    LatencyDisplayWidget.ui \
+    TrafficDisplayWidget.ui
 
-LIBS += -lserial -lboost_thread -lboost_system
-QMAKE_CXXFLAGS += -std=c++11
+LIBS += -lboost_thread -lboost_system
+
+# optional io_uring backend for the serial transport: qmake CONFIG+=io_uring
+io_uring {
+    DEFINES += MCCAR_HAVE_LIBURING
+    LIBS += -luring
+}
+QMAKE_CXXFLAGS += -std=c++14
@@ -1,44 +1,45 @@
 #include "controller.h"
 
-#include <Payload.h>
+#include <FrameSender.h>
 
 #include <QKeyEvent>
 
 #include <map>
-#include <iostream>
 
 Controller::Controller(QWidget *parent)
     : QTextEdit(parent)
 {
 }
 
-void Controller::setStream(LibSerial::SerialStream *serialStream)
+void Controller::setSender(FrameSender *frameSender)
 {
-    this->serialStream = serialStream;
+    this->frameSender = frameSender;
 }
 
 void Controller::keyPressEvent(QKeyEvent *e)
 {
+    const auto inputTime = std::chrono::steady_clock::now();
     if (!e->isAutoRepeat())
     {
         pressedKeys.insert(e->key());
-        sendToSerialStream();
+        sendMove(inputTime);
     }
 }
 
 void Controller::keyReleaseEvent(QKeyEvent *e)
 {
+    const auto inputTime = std::chrono::steady_clock::now();
     if (!e->isAutoRepeat())
     {
         e->accept();
         pressedKeys.erase(e->key());
-        sendToSerialStream();
+        sendMove(inputTime);
     }
 }
 
-void Controller::sendToSerialStream()
+void Controller::sendMove(std::chrono::steady_clock::time_point inputTime)
 {
-    if (serialStream)
+    if (frameSender)
     {
         static std::map<Qt::Key, uint8_t> mapping = {
             { Qt::Key_Up,   1   },
@@ -60,7 +61,7 @@ void Controller::sendToSerialStream()
             }
         }
 
-        *serialStream << RequestDataPacket<MovePayload>(MovePayload{cmd});
+        frameSender->sendMove(MovePayload{cmd}, inputTime);
 
         setText(QString::number(cmd));
     }
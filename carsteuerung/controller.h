@@ -2,26 +2,31 @@
 #define CONTROLLER_H
 
 #include <QTextEdit>
+
+#include <chrono>
 #include <set>
 
-#include <SerialStream.h>
+class FrameSender;
 
 class Controller : public QTextEdit
 {
 public:
     explicit Controller(QWidget* parent);
 
-    void setStream(LibSerial::SerialStream* serialStream);
+    void setSender(FrameSender* frameSender);
 
 protected:
     void keyPressEvent(QKeyEvent *e) override;
     void keyReleaseEvent(QKeyEvent *e) override;
 
 private:
-    void sendToSerialStream();
+    /**
+    @param inputTime when the key event came in, the latency of the Move is measured from there
+    */
+    void sendMove(std::chrono::steady_clock::time_point inputTime);
 
 private:
-    LibSerial::SerialStream* serialStream = nullptr;
+    FrameSender* frameSender = nullptr;
 
     std::set<int> pressedKeys;
 };
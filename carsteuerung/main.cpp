@@ -5,6 +5,56 @@ int main(int argc, char *argv[])
 {
 	QApplication a(argc, argv);
 	MainWindow w;
+
+	const QStringList arguments = a.arguments();
+	const int logFileIndex = arguments.indexOf("--log-file");
+	if (logFileIndex >= 0 && logFileIndex + 1 < arguments.size())
+	{
+		w.setLogFile(arguments[logFileIndex + 1].toStdString());
+	}
+
+	const int swapFileIndex = arguments.indexOf("--swap-file");
+	if (swapFileIndex >= 0 && swapFileIndex + 1 < arguments.size())
+	{
+		w.setSwapFile(arguments[swapFileIndex + 1].toStdString());
+	}
+
+	const int latencyFileIndex = arguments.indexOf("--latency-file");
+	if (latencyFileIndex >= 0 && latencyFileIndex + 1 < arguments.size())
+	{
+		w.setLatencyFile(arguments[latencyFileIndex + 1].toStdString());
+	}
+
+	const int metricsFileIndex = arguments.indexOf("--metrics-file");
+	if (metricsFileIndex >= 0 && metricsFileIndex + 1 < arguments.size())
+	{
+		w.setMetricsFile(arguments[metricsFileIndex + 1].toStdString());
+	}
+
+	const int maxBaudIndex = arguments.indexOf("--max-baud");
+	if (maxBaudIndex >= 0 && maxBaudIndex + 1 < arguments.size())
+	{
+		w.setMaxBaudRate(arguments[maxBaudIndex + 1].toUInt());
+	}
+
+	if (arguments.indexOf("--fixed-framing") >= 0)
+	{
+		w.setCobsFraming(false);
+	}
+
+	const int recordIndex = arguments.indexOf("--record");
+	if (recordIndex >= 0 && recordIndex + 1 < arguments.size())
+	{
+		w.startRecording(arguments[recordIndex + 1].toStdString());
+	}
+
+	const int replayIndex = arguments.indexOf("--replay");
+	if (replayIndex >= 0 && replayIndex + 1 < arguments.size())
+	{
+		const int speedIndex = arguments.indexOf("--replay-speed");
+		const double speed = speedIndex >= 0 && speedIndex + 1 < arguments.size() ? arguments[speedIndex + 1].toDouble() : 1;
+		w.startReplay(arguments[replayIndex + 1].toStdString(), speed);
+	}
 	w.show();
 
 	return a.exec();
@@ -0,0 +1,138 @@
+#include <CaptureReplay.h>
+#include <SwapStore.h>
+#include <TelemetryReader.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+void printUsage()
+{
+	std::cerr << "usage: replay <capture> [--realtime | --speed <factor>] [--swap-file <path>]" << std::endl;
+}
+
+/**
+Does the work of the host handlers without a GUI: payloads get decoded,
+swapped out buffers are stored and requested buffers encoded for sending
+*/
+void registerHandlers(HostCommandDispatcher& dispatcher, SwapStore& swapStore, uint64_t& encodedFrames)
+{
+	dispatcher.registerHandler<WriteDataPayload>([&swapStore](const RequestDataPacket<WriteDataPayload>& data)
+	{
+		uint16_t bufferNo = data.payload.bufferNoHigh << 8 | data.payload.bufferNoLow;
+		uint16_t offset = data.payload.offsetHigh << 8 | data.payload.offsetLow;
+		swapStore.append(bufferNo, offset, ConstByteSpan(data.payload.data, sizeof(data.payload.data)));
+	});
+
+	dispatcher.registerHandler<RequestDataPayload>([&swapStore, &encodedFrames](const RequestDataPacket<RequestDataPayload>& data)
+	{
+		uint16_t bufferNo = data.payload.bufferNoHigh << 8 | data.payload.bufferNoLow;
+		const ConstByteSpan buffer = swapStore.read(bufferNo);
+		const size_t chunkSize = sizeof(HandleRequestedDataPayload::data);
+		for (size_t i = 0; i < buffer.size(); i += chunkSize)
+		{
+			HandleRequestedDataPayload payload;
+			payload.bufferNoHigh = data.payload.bufferNoHigh;
+			payload.bufferNoLow = data.payload.bufferNoLow;
+			std::copy(buffer.begin() + i, buffer.begin() + std::min(i + chunkSize, buffer.size()), payload.data);
+			encodeFrame(RequestDataPacket<HandleRequestedDataPayload>(payload));
+			++encodedFrames;
+		}
+	});
+}
+
+void printReport(const CaptureReplay::Report& report)
+{
+	std::cout << "records: " << report.rxRecords << " rx, " << report.txRecords << " tx" << std::endl
+			  << "dispatched: " << report.dispatchedFrames << " frames in " << report.seconds << " s ("
+			  << static_cast<uint64_t>(report.getFramesPerSecond()) << " frames/s)" << std::endl
+			  << "divergent frames: " << report.divergentFrames
+			  << ", checksum failures: " << report.checksumFailures
+			  << ", resyncs: " << report.resyncEvents
+			  << ", discarded bytes: " << report.discardedBytes << std::endl;
+
+	for (size_t cmd = 0; cmd < report.commands.size(); ++cmd)
+	{
+		const CaptureReplay::CommandStatistics& statistics = report.commands[cmd];
+		if (statistics.frames == 0)
+			continue;
+
+		std::cout << "  cmd 0x" << std::hex << std::setw(2) << std::setfill('0') << cmd << std::dec << std::setfill(' ')
+				  << ": " << statistics.frames << " frames, "
+				  << double(statistics.nanoseconds) / statistics.frames << " ns/frame in handlers" << std::endl;
+	}
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	CaptureReplay::Mode mode = CaptureReplay::Mode::AsFastAsPossible;
+	double speed = 1;
+	std::string swapFile = "replay-swap.bin";
+	for (int i = 2; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--realtime") == 0)
+		{
+			mode = CaptureReplay::Mode::RealTime;
+		}
+		else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc)
+		{
+			mode = CaptureReplay::Mode::Scaled;
+			speed = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--swap-file") == 0 && i + 1 < argc)
+		{
+			swapFile = argv[++i];
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	if (mode == CaptureReplay::Mode::Scaled && speed <= 0)
+	{
+		std::cerr << "speed has to be positive" << std::endl;
+		return 1;
+	}
+
+	TelemetryReader reader;
+	if (!reader.open(argv[1]))
+	{
+		std::cerr << reader.getLastError() << std::endl;
+		return 1;
+	}
+	if (!reader.hasIndex())
+	{
+		std::cerr << "capture was not closed properly, replaying the complete records" << std::endl;
+	}
+
+	SwapStore swapStore;
+	if (!swapStore.open(swapFile, 256, 4096))
+	{
+		std::cerr << swapStore.getLastError() << std::endl;
+		return 1;
+	}
+
+	HostCommandDispatcher dispatcher;
+	uint64_t encodedFrames = 0;
+	registerHandlers(dispatcher, swapStore, encodedFrames);
+
+	CaptureReplay replay(dispatcher);
+	printReport(replay.run(reader, mode, speed));
+	std::cout << "swap responses encoded: " << encodedFrames << " frames" << std::endl;
+
+	return 0;
+}
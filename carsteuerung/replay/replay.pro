@@ -0,0 +1,40 @@
+#-------------------------------------------------
+#
+# Replays a telemetry capture (carsteuerung --record)
+# through the host protocol stack, without GUI and car.
+#
+#-------------------------------------------------
+
+QT       -= gui core
+
+TARGET = replay
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp \
+    ../CaptureReplay.cpp \
+    ../Crc8.cpp \
+    ../FrameParser.cpp \
+    ../SwapStore.cpp \
+    ../TelemetryReader.cpp \
+    ../TelemetryRecorder.cpp
+
+HEADERS += ../ByteSpan.h \
+    ../CaptureReplay.h \
+    ../CommandDispatcher.h \
+    ../Cobs.h \
+    ../Crc8.h \
+    ../FrameCodec.h \
+    ../FrameParser.h \
+    ../Payload.h \
+    ../SwapStore.h \
+    ../TelemetryReader.h \
+    ../TelemetryRecorder.h
+
+LIBS += -lboost_thread -lboost_system -lpthread
+
+QMAKE_CXXFLAGS += -std=c++14
+QMAKE_CXXFLAGS_RELEASE += -O2
@@ -0,0 +1,378 @@
+#include "VirtualCar.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+
+//as defined in firmware/mccar-sync/Sources
+const size_t sciCmdAndPayloadSize = getFrameSize() - 1;
+const uint8_t maxCommandsToProcessAtATime = 5;
+const uint8_t pagePoolSize = 20;
+const uint8_t pageSize = 32;
+
+const std::chrono::milliseconds tick(1);
+
+}
+
+VirtualCar::VirtualCar(const Configuration& configuration)
+	: m_configuration(configuration)
+	, m_isStopping(false)
+{
+	m_receiveQueue.fill(0);
+}
+
+VirtualCar::~VirtualCar()
+{
+	close();
+}
+
+bool VirtualCar::open(const std::string& linkPath)
+{
+	close();
+
+	//raw from the start, otherwise the line discipline echoes what the car sends until carsteuerung configures the port
+	termios attributes;
+	std::memset(&attributes, 0, sizeof(attributes));
+	cfmakeraw(&attributes);
+	cfsetspeed(&attributes, B115200);
+
+	char name[64];
+	if (openpty(&m_masterFd, &m_slaveFd, name, &attributes, nullptr) != 0)
+	{
+		m_lastError = std::string("openpty: ") + strerror(errno);
+		return false;
+	}
+	m_slaveName = name;
+
+	//the slave side stays open here as well, the master would read EIO whenever carsteuerung closes the port
+	const int flags = fcntl(m_masterFd, F_GETFL);
+	if (flags < 0 || fcntl(m_masterFd, F_SETFL, flags | O_NONBLOCK) != 0)
+	{
+		m_lastError = std::string("fcntl: ") + strerror(errno);
+		close();
+		return false;
+	}
+
+	if (!linkPath.empty())
+	{
+		::unlink(linkPath.c_str());
+		if (::symlink(m_slaveName.c_str(), linkPath.c_str()) != 0)
+		{
+			m_lastError = "symlink " + linkPath + ": " + strerror(errno);
+			close();
+			return false;
+		}
+		m_linkPath = linkPath;
+	}
+
+	return true;
+}
+
+void VirtualCar::close()
+{
+	if (!m_linkPath.empty())
+	{
+		::unlink(m_linkPath.c_str());
+		m_linkPath.clear();
+	}
+	if (m_masterFd >= 0)
+	{
+		::close(m_masterFd);
+		::close(m_slaveFd);
+	}
+	m_masterFd = -1;
+	m_slaveFd = -1;
+	m_slaveName.clear();
+}
+
+void VirtualCar::run(std::chrono::milliseconds duration)
+{
+	//8N1: ten bits on the wire per byte
+	const double bytesPerTick = m_configuration.baudRate / 10.0 * std::chrono::duration<double>(tick).count();
+	const double receiveTasksPerTick = m_configuration.receiveTaskRate * std::chrono::duration<double>(tick).count();
+	const double statusPerTick = m_configuration.statusRate * std::chrono::duration<double>(tick).count();
+	const double resourcePerTick = m_configuration.resourceRate * std::chrono::duration<double>(tick).count();
+
+	double receiveBudget = 0;
+	double sendBudget = 0;
+	double receiveTasksDue = 0;
+	double statusDue = 0;
+	double resourceDue = 0;
+
+	const Clock::time_point start = Clock::now();
+	Clock::time_point nextSwap = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_configuration.swapInterval));
+	Clock::time_point nextTick = start;
+
+	while (!m_isStopping && (duration.count() == 0 || nextTick - start < duration))
+	{
+		nextTick += tick;
+		std::this_thread::sleep_until(nextTick);
+		const Clock::time_point now = Clock::now();
+
+		//the budgets do not pile up while the line is idle, the SCI cannot send faster than the baud rate afterwards
+		receiveBudget = std::min(receiveBudget + bytesPerTick, 2 * bytesPerTick);
+		sendBudget = std::min(sendBudget + bytesPerTick, 2 * bytesPerTick);
+
+		const size_t receivedBefore = m_statistics.receivedBytes;
+		receiveBytes(static_cast<size_t>(receiveBudget));
+		receiveBudget -= m_statistics.receivedBytes - receivedBefore;
+
+		for (receiveTasksDue += receiveTasksPerTick; receiveTasksDue >= 1; --receiveTasksDue)
+		{
+			runReceiveTask();
+		}
+
+		if (m_configuration.statusRate > 0)
+		{
+			for (statusDue += statusPerTick; statusDue >= 1; --statusDue)
+			{
+				sendStatus();
+			}
+		}
+		if (m_configuration.resourceRate > 0)
+		{
+			for (resourceDue += resourcePerTick; resourceDue >= 1; --resourceDue)
+			{
+				sendResource();
+			}
+		}
+
+		if (m_configuration.swapInterval > 0 && m_swapState == SwapState::Idle && now >= nextSwap)
+		{
+			startSwapOut(now);
+			nextSwap = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_configuration.swapInterval));
+		}
+		updateSwap(now);
+
+		const size_t sentBefore = m_statistics.sentBytes;
+		sendBytes(static_cast<size_t>(sendBudget));
+		sendBudget -= m_statistics.sentBytes - sentBefore;
+	}
+}
+
+void VirtualCar::receiveBytes(size_t maxSize)
+{
+	uint8_t buffer[256];
+	maxSize = std::min(maxSize, sizeof(buffer));
+	if (maxSize == 0)
+		return;
+
+	const ssize_t size = ::read(m_masterFd, buffer, maxSize);
+	if (size <= 0)
+		return;
+
+	//isr_SCI1R: queue_enqueueByte() into bt_receiveQueue
+	for (ssize_t i = 0; i < size; ++i)
+	{
+		m_receiveQueue[m_receiveWritePos++] = buffer[i];
+		if (m_receiveWritePos == m_receiveReadPos)
+		{
+			//queue_getFreeSpace() reports 255 free bytes for a queue with 255 used ones, the 256th byte wraps the queue to empty
+			m_statistics.overrunBytes += m_receiveQueue.size();
+		}
+	}
+	m_statistics.receivedBytes += static_cast<uint64_t>(size);
+	m_statistics.maxUsedReceiveQueue = std::max(m_statistics.maxUsedReceiveQueue, getUsedReceiveQueue());
+}
+
+void VirtualCar::sendBytes(size_t maxSize)
+{
+	uint8_t buffer[256];
+	const size_t size = std::min(std::min(maxSize, sizeof(buffer)), m_sendQueue.size());
+	if (size == 0)
+		return;
+
+	std::copy(m_sendQueue.begin(), m_sendQueue.begin() + static_cast<std::ptrdiff_t>(size), buffer);
+	const ssize_t written = ::write(m_masterFd, buffer, size);
+	if (written <= 0)
+		return; //nobody reads the slave side, the pty buffer is full
+
+	m_sendQueue.erase(m_sendQueue.begin(), m_sendQueue.begin() + written);
+	m_statistics.sentBytes += static_cast<uint64_t>(written);
+}
+
+void VirtualCar::runReceiveTask()
+{
+	//handleSciReceive()
+	uint8_t command[sciCmdAndPayloadSize + 1];
+	for (uint8_t i = 0; i < maxCommandsToProcessAtATime && getUsedReceiveQueue() >= sizeof(command); ++i)
+	{
+		for (uint8_t& byte : command)
+		{
+			byte = m_receiveQueue[m_receiveReadPos++];
+		}
+		handleCommand(command);
+	}
+}
+
+void VirtualCar::handleCommand(const uint8_t* pCommand)
+{
+	++m_statistics.receivedFrames[pCommand[0]];
+	if (!isFrameChecksumOk(ConstByteSpan(pCommand, getFrameSize())))
+	{
+		//the firmware drops the command, a failure here also means the frames got out of step
+		++m_statistics.checksumFailures;
+		return;
+	}
+
+	switch (pCommand[0])
+	{
+	case MovePayload::cmd_id:
+		m_statistics.driveval = getFramePayload<MovePayload>(ConstByteSpan(pCommand, getFrameSize())).direction;
+		break;
+	case ConfigPIDPayload::cmd_id:
+		m_statistics.pid = getFramePayload<ConfigPIDPayload>(ConstByteSpan(pCommand, getFrameSize()));
+		break;
+	case HandleRequestedDataPayload::cmd_id:
+		handleRequestedData(pCommand);
+		break;
+	default:
+		break;
+	}
+}
+
+void VirtualCar::handleRequestedData(const uint8_t* pCommand)
+{
+	const HandleRequestedDataPayload& payload = getFramePayload<HandleRequestedDataPayload>(ConstByteSpan(pCommand, getFrameSize()));
+	const uint16_t bufferNo = payload.bufferNoHigh << 8 | payload.bufferNoLow;
+	if (m_swapState != SwapState::AwaitingSwapIn || bufferNo != m_lastBufferNo)
+		return;
+
+	const size_t size = std::min(sizeof(payload.data), m_swappedOut.size() - m_swappedIn.size());
+	m_swappedIn.insert(m_swappedIn.end(), payload.data, payload.data + size);
+	if (m_swappedIn.size() < m_swappedOut.size())
+		return;
+
+	const std::chrono::nanoseconds roundTrip = Clock::now() - m_swapStart;
+	m_statistics.swapRoundTripSum += roundTrip;
+	m_statistics.swapRoundTripMax = std::max(m_statistics.swapRoundTripMax, roundTrip);
+	if (m_swappedIn == m_swappedOut)
+	{
+		++m_statistics.swapsCompleted;
+	}
+	else
+	{
+		++m_statistics.swapsCorrupted;
+	}
+	m_swapState = SwapState::Idle;
+}
+
+void VirtualCar::sendStatus()
+{
+	//some movement in the values, so the display visibly updates
+	m_voltage = static_cast<uint16_t>(7200 + m_random() % 400);
+	m_current = static_cast<uint16_t>(200 + m_random() % 200);
+
+	//taskSendStatus()
+	uint8_t cmd[10];
+	cmd[0] = StatusPayload::cmd_id;
+	cmd[1] = static_cast<uint8_t>(m_voltage >> 8);
+	cmd[2] = static_cast<uint8_t>(m_voltage);
+	cmd[3] = static_cast<uint8_t>(m_current >> 8);
+	cmd[4] = static_cast<uint8_t>(m_current);
+	cmd[5] = static_cast<uint8_t>(m_chargeStatus >> 8);
+	cmd[6] = static_cast<uint8_t>(m_chargeStatus);
+	cmd[7] = 0; //linepos
+	cmd[8] = 0; //linewidth
+	cmd[9] = 0;
+	enqueue(cmd, sizeof(cmd));
+}
+
+void VirtualCar::sendResource()
+{
+	//taskSendRessource(), a swap in waiting for its data occupies a page
+	const uint8_t usedPages = m_swapState == SwapState::AwaitingSwapIn ? 1 : 0;
+	const uint8_t usedReceiveQueue = getUsedReceiveQueue();
+
+	uint8_t cmd[11];
+	cmd[0] = ResourcePayload::cmd_id;
+	cmd[1] = 0; //taskQueueLoad
+	cmd[2] = usedPages;
+	cmd[3] = pagePoolSize - usedPages;
+	cmd[4] = pageSize;
+	cmd[5] = usedReceiveQueue;
+	cmd[6] = usedReceiveQueue == 0 ? 255 : static_cast<uint8_t>(m_receiveReadPos - m_receiveWritePos);
+	cmd[7] = 0; //maxControlTaskWait, nothing waits in the simulation
+	cmd[8] = 0; //maxCommunicationTaskWait
+	cmd[9] = 0; //maxBackgroundTaskWait
+	cmd[10] = 0; //queuedTasks
+	enqueue(cmd, sizeof(cmd));
+}
+
+void VirtualCar::startSwapOut(Clock::time_point now)
+{
+	m_swappedOut.resize(m_configuration.swapSize);
+	std::generate(m_swappedOut.begin(), m_swappedOut.end(), [this]() { return static_cast<uint8_t>(m_random()); });
+	m_swappedIn.clear();
+
+	//swappableMemoryPool_swapOut()
+	const uint16_t bufferNo = ++m_lastBufferNo;
+	const size_t chunkSize = sizeof(WriteDataPayload::data);
+	for (size_t offset = 0; offset < m_swappedOut.size(); offset += chunkSize)
+	{
+		uint8_t data[sciCmdAndPayloadSize] = {};
+		data[0] = WriteDataPayload::cmd_id;
+		data[1] = static_cast<uint8_t>(bufferNo >> 8);
+		data[2] = static_cast<uint8_t>(bufferNo);
+		data[3] = static_cast<uint8_t>(offset >> 8);
+		data[4] = static_cast<uint8_t>(offset);
+		std::copy(m_swappedOut.begin() + static_cast<std::ptrdiff_t>(offset),
+				  m_swappedOut.begin() + static_cast<std::ptrdiff_t>(std::min(offset + chunkSize, m_swappedOut.size())), data + 5);
+		enqueue(data, sizeof(data));
+	}
+
+	m_swapOutEnd = m_statistics.sentBytes + m_sendQueue.size();
+	m_swapStart = now;
+	m_swapState = SwapState::SwappingOut;
+}
+
+void VirtualCar::updateSwap(Clock::time_point now)
+{
+	switch (m_swapState)
+	{
+	case SwapState::Idle:
+		break;
+
+	case SwapState::SwappingOut:
+		if (m_statistics.sentBytes >= m_swapOutEnd)
+		{
+			//swappableMemoryPool_requestSwapIn(), the round trip counts from here
+			uint8_t data[3];
+			data[0] = RequestDataPayload::cmd_id;
+			data[1] = static_cast<uint8_t>(m_lastBufferNo >> 8);
+			data[2] = static_cast<uint8_t>(m_lastBufferNo);
+			enqueue(data, sizeof(data));
+
+			m_swapStart = now;
+			m_swapState = SwapState::AwaitingSwapIn;
+		}
+		break;
+
+	case SwapState::AwaitingSwapIn:
+		if (now - m_swapStart > m_configuration.swapTimeout)
+		{
+			++m_statistics.swapsTimedOut;
+			m_swapState = SwapState::Idle;
+		}
+		break;
+	}
+}
+
+void VirtualCar::enqueue(const uint8_t* pData, size_t size)
+{
+	//bt_enqueue_crc(): padded with zeroes, the checksum covers payload and padding
+	Frame frame = {};
+	std::copy(pData, pData + size, frame.begin());
+	frame[getFrameSize() - 1] = calculateFrameChecksum(frame.data());
+	m_sendQueue.insert(m_sendQueue.end(), frame.begin(), frame.end());
+	++m_statistics.sentFrames;
+}
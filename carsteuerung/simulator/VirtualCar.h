@@ -0,0 +1,147 @@
+#ifndef VIRTUALCAR_H
+#define VIRTUALCAR_H
+
+#include "FrameCodec.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+Plays the MC-Car on the master side of a pseudo-terminal, carsteuerung connects to the slave side like to /dev/rfcommN.
+
+Behaves like the firmware as far as the link is concerned: received bytes go into a 256 byte queue like bt_receiveQueue
+and are dropped when it is full, a receive task takes up to 5 frames of 12 bytes out of it at a time without any resync.
+Status and Resource are sent periodically and buffers are swapped out and in again with the WriteData/RequestData/HandleRequestedData handshake.
+Both directions are paced to the configured baud rate.
+*/
+class VirtualCar
+{
+public:
+	struct Configuration
+	{
+		uint32_t baudRate = 115200;
+		double receiveTaskRate = 1000;	///< calls of the receive task per second
+		double statusRate = 1;			///< Status frames per second, 0 to send none
+		double resourceRate = 1;		///< Resource frames per second, 0 to send none
+		double swapInterval = 0;		///< seconds between two swap handshakes, 0 to swap nothing
+		uint16_t swapSize = 256;		///< bytes per swapped out buffer
+		std::chrono::milliseconds swapTimeout = std::chrono::milliseconds(2000);
+	};
+
+	struct Statistics
+	{
+		std::array<uint64_t, 256> receivedFrames;	///< per cmd
+		uint64_t receivedBytes = 0;
+		uint64_t overrunBytes = 0;		///< dropped because the receive queue was full
+		uint64_t checksumFailures = 0;
+		uint64_t sentFrames = 0;
+		uint64_t sentBytes = 0;
+
+		uint64_t swapsCompleted = 0;
+		uint64_t swapsCorrupted = 0;	///< swapped in, but with other data than swapped out
+		uint64_t swapsTimedOut = 0;
+		std::chrono::nanoseconds swapRoundTripSum = std::chrono::nanoseconds(0);
+		std::chrono::nanoseconds swapRoundTripMax = std::chrono::nanoseconds(0);
+
+		uint8_t maxUsedReceiveQueue = 0;
+		uint8_t driveval = 0;			///< of the last Move
+		ConfigPIDPayload pid = {};		///< of the last ConfigPID
+
+		Statistics() { receivedFrames.fill(0); }
+	};
+
+	explicit VirtualCar(const Configuration& configuration);
+	~VirtualCar();
+
+	VirtualCar(const VirtualCar&) = delete;
+	VirtualCar& operator =(const VirtualCar&) = delete;
+
+	/**
+	Opens the pseudo-terminal. If linkPath is not empty, it becomes a symlink to the slave side.
+	@returns false on failure, see getLastError()
+	*/
+	bool open(const std::string& linkPath = std::string());
+	void close();
+	const std::string& getLastError() const { return m_lastError; }
+
+	/**
+	The device carsteuerung has to open
+	*/
+	const std::string& getDeviceName() const { return m_slaveName; }
+
+	/**
+	Runs the car until stop() is called or duration has passed, a duration of 0 runs until stop()
+	*/
+	void run(std::chrono::milliseconds duration = std::chrono::milliseconds(0));
+
+	/**
+	Thread and signal safe
+	*/
+	void stop() { m_isStopping = true; }
+
+	const Statistics& getStatistics() const { return m_statistics; }
+
+private:
+	enum class SwapState
+	{
+		Idle,
+		SwappingOut,
+		AwaitingSwapIn
+	};
+
+	typedef std::chrono::steady_clock Clock;
+
+	void receiveBytes(size_t maxSize);
+	void sendBytes(size_t maxSize);
+	void runReceiveTask();
+	void handleCommand(const uint8_t* pCommand);
+	void handleRequestedData(const uint8_t* pCommand);
+
+	void sendStatus();
+	void sendResource();
+	void startSwapOut(Clock::time_point now);
+	void updateSwap(Clock::time_point now);
+	void enqueue(const uint8_t* pData, size_t size);
+
+	uint8_t getUsedReceiveQueue() const { return static_cast<uint8_t>(m_receiveWritePos - m_receiveReadPos); }
+
+private:
+	const Configuration m_configuration;
+
+	int m_masterFd = -1;
+	int m_slaveFd = -1;
+	std::string m_slaveName;
+	std::string m_linkPath;
+	std::string m_lastError;
+
+	std::atomic_bool m_isStopping;
+
+	//the firmware Queue: 256 bytes with 8 bit positions, so at most 255 bytes are used
+	std::array<uint8_t, 256> m_receiveQueue;
+	uint8_t m_receiveReadPos = 0;
+	uint8_t m_receiveWritePos = 0;
+
+	std::deque<uint8_t> m_sendQueue;
+
+	SwapState m_swapState = SwapState::Idle;
+	uint16_t m_lastBufferNo = 0;
+	std::vector<uint8_t> m_swappedOut;
+	std::vector<uint8_t> m_swappedIn;
+	uint64_t m_swapOutEnd = 0;			///< value of Statistics::sentBytes once the last WriteData is on the wire
+	Clock::time_point m_swapStart;
+	std::mt19937 m_random;
+
+	uint16_t m_voltage = 7400;
+	uint16_t m_current = 300;
+	uint16_t m_chargeStatus = 800;
+
+	Statistics m_statistics;
+};
+
+#endif // VIRTUALCAR_H
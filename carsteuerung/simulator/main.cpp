@@ -0,0 +1,133 @@
+#include "VirtualCar.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+VirtualCar* pCar = nullptr;
+
+void handleSignal(int)
+{
+	if (pCar)
+	{
+		pCar->stop();
+	}
+}
+
+void printUsage()
+{
+	std::cerr << "usage: simulator [--link <path>] [--baud <rate>] [--receive-task-rate <Hz>]" << std::endl
+			  << "                 [--status-rate <Hz>] [--resource-rate <Hz>]" << std::endl
+			  << "                 [--swap-interval <s>] [--swap-size <bytes>] [--duration <s>]" << std::endl;
+}
+
+void printStatistics(const VirtualCar::Statistics& statistics)
+{
+	std::cout << "received: " << statistics.receivedBytes << " bytes, "
+			  << statistics.overrunBytes << " lost in receive queue overruns (max. " << unsigned(statistics.maxUsedReceiveQueue) << " bytes used), "
+			  << statistics.checksumFailures << " checksum failures" << std::endl;
+
+	for (size_t cmd = 0; cmd < statistics.receivedFrames.size(); ++cmd)
+	{
+		if (statistics.receivedFrames[cmd] > 0)
+		{
+			std::cout << "  cmd 0x" << std::hex << std::setw(2) << std::setfill('0') << cmd << std::dec << std::setfill(' ') << ": " << statistics.receivedFrames[cmd] << " frames" << std::endl;
+		}
+	}
+
+	std::cout << "last Move: 0x" << std::hex << unsigned(statistics.driveval) << std::dec
+			  << ", last ConfigPID: " << unsigned(statistics.pid.kpleft) << " " << unsigned(statistics.pid.kileft) << " " << unsigned(statistics.pid.kdleft)
+			  << " / " << unsigned(statistics.pid.kpright) << " " << unsigned(statistics.pid.kiright) << " " << unsigned(statistics.pid.kdright) << std::endl;
+
+	std::cout << "sent: " << statistics.sentFrames << " frames, " << statistics.sentBytes << " bytes" << std::endl;
+
+	const uint64_t swaps = statistics.swapsCompleted + statistics.swapsCorrupted;
+	std::cout << "swaps: " << statistics.swapsCompleted << " completed, " << statistics.swapsCorrupted << " corrupted, "
+			  << statistics.swapsTimedOut << " timed out";
+	if (swaps > 0)
+	{
+		std::cout << ", round trip avg. " << statistics.swapRoundTripSum.count() / 1000 / swaps << " us"
+				  << ", max. " << statistics.swapRoundTripMax.count() / 1000 << " us";
+	}
+	std::cout << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	VirtualCar::Configuration configuration;
+	std::string linkPath;
+	double duration = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--link") == 0 && hasValue)
+		{
+			linkPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--baud") == 0 && hasValue)
+		{
+			configuration.baudRate = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--receive-task-rate") == 0 && hasValue)
+		{
+			configuration.receiveTaskRate = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--status-rate") == 0 && hasValue)
+		{
+			configuration.statusRate = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--resource-rate") == 0 && hasValue)
+		{
+			configuration.resourceRate = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--swap-interval") == 0 && hasValue)
+		{
+			configuration.swapInterval = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--swap-size") == 0 && hasValue)
+		{
+			configuration.swapSize = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--duration") == 0 && hasValue)
+		{
+			duration = std::atof(argv[++i]);
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	if (configuration.baudRate == 0 || configuration.receiveTaskRate <= 0 || configuration.swapSize == 0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	VirtualCar car(configuration);
+	if (!car.open(linkPath))
+	{
+		std::cerr << car.getLastError() << std::endl;
+		return 1;
+	}
+	std::cout << "virtual MC-Car on " << (linkPath.empty() ? car.getDeviceName() : linkPath) << std::endl;
+
+	pCar = &car;
+	std::signal(SIGINT, handleSignal);
+	std::signal(SIGTERM, handleSignal);
+
+	car.run(std::chrono::milliseconds(static_cast<int64_t>(duration * 1000)));
+
+	pCar = nullptr;
+	printStatistics(car.getStatistics());
+	return 0;
+}
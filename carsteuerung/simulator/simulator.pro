@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Virtual MC-Car on a pseudo-terminal: carsteuerung
+# connects to it like to the car on /dev/rfcommN.
+#
+#-------------------------------------------------
+
+QT       -= gui core
+
+TARGET = simulator
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += main.cpp \
+    VirtualCar.cpp \
+    ../Crc8.cpp
+
+HEADERS += VirtualCar.h \
+    ../ByteSpan.h \
+    ../Cobs.h \
+    ../Crc8.h \
+    ../FrameCodec.h \
+    ../Payload.h
+
+LIBS += -lutil
+
+QMAKE_CXXFLAGS += -std=c++14
+QMAKE_CXXFLAGS_RELEASE += -O2
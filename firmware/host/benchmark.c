@@ -0,0 +1,539 @@
+/*
+ * benchmark.c
+ *
+ * Microbenchmarks of the firmware core, built for the host (host.pro).
+ * The times are host times, compare them between two versions of the firmware rather than with the MC.
+ * The operation counts per scheduler cycle are the same as on the MC.
+ */
+
+#include "hal.h"
+
+#include "framing.h"
+#include "malloc.h"
+#include "mcmath.h"
+#include "pagepool.h"
+#include "pid.h"
+#include "queue.h"
+#include "scheduler.h"
+#include "swappableMemory.h"
+#include "task.h"
+#include "taskQueue.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+extern Queue bt_sendQueue;
+extern Queue bt_receiveQueue;
+extern uint8 bt_framing;
+extern volatile uint16 tickcount;
+
+// main.c is not part of the benchmark
+Pid motorPid[2];
+Scheduler scheduler;
+
+//### operation counts, the linker redirects the calls between the firmware modules here (-Wl,--wrap) ###
+typedef struct
+{
+	unsigned long mallocs;
+	unsigned long frees;
+	unsigned long queueEnqueues;
+	unsigned long queueDequeues;
+	unsigned long taskEnqueues;
+	unsigned long taskDequeues;
+} Counts;
+
+static Counts counts;
+
+void* __real__malloc(uint8 size);
+void __real__free(void* pData);
+bool __real_queue_enqueue(Queue* pQueue, uint8* data, uint8 size);
+bool __real_queue_dequeue(Queue* pQueue, uint8* data, uint8 size);
+bool __real_taskqueue_enqueue(TaskQueue* pQueue, Task* pTask);
+Task* __real_taskqueue_dequeue(TaskQueue* pQueue, uint8 priority);
+
+void* __wrap__malloc(uint8 size)
+{
+	++counts.mallocs;
+	return __real__malloc(size);
+}
+
+void __wrap__free(void* pData)
+{
+	++counts.frees;
+	__real__free(pData);
+}
+
+bool __wrap_queue_enqueue(Queue* pQueue, uint8* data, uint8 size)
+{
+	++counts.queueEnqueues;
+	return __real_queue_enqueue(pQueue, data, size);
+}
+
+bool __wrap_queue_dequeue(Queue* pQueue, uint8* data, uint8 size)
+{
+	++counts.queueDequeues;
+	return __real_queue_dequeue(pQueue, data, size);
+}
+
+bool __wrap_taskqueue_enqueue(TaskQueue* pQueue, Task* pTask)
+{
+	++counts.taskEnqueues;
+	return __real_taskqueue_enqueue(pQueue, pTask);
+}
+
+Task* __wrap_taskqueue_dequeue(TaskQueue* pQueue, uint8 priority)
+{
+	++counts.taskDequeues;
+	return __real_taskqueue_dequeue(pQueue, priority);
+}
+
+//### measurement ###
+static double now(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static void printResult(const char* name, unsigned long operations, double seconds)
+{
+	printf("%s: %.0f ops/s (%.1f ns/op)\n", name, operations / seconds, seconds * 1e9 / operations);
+}
+
+/**
+ * keeps the compiler from optimizing away a result that is otherwise unused
+ */
+static volatile uint32 sink;
+
+//### benchmarks ###
+static void benchmarkQueue(void)
+{
+	const unsigned long frameCount = 2000000;
+	uint8 frame[SCI_CMD_AND_PAYLOAD_SIZE + 1] = { 0x01, 0x09 };
+	Queue queue;
+	QueueRegion region;
+	unsigned long i;
+	uint8 j;
+	double start;
+
+	queue_init(&queue);
+
+	// the way bt_enqueue() and handleSciReceive() move frames
+	start = now();
+	for (i = 0; i < frameCount; ++i)
+	{
+		if (!queue_enqueue(&queue, frame, sizeof(frame)) || !queue_dequeue(&queue, frame, sizeof(frame)))
+			FATAL_ERROR();
+	}
+	printResult("queue frame enqueue + dequeue", frameCount, now() - start);
+
+	// the way framing_enqueueMessage() writes and framing_nextFrame() scans frames in place
+	start = now();
+	for (i = 0; i < frameCount; ++i)
+	{
+		if (!queue_reserve(&queue, sizeof(frame), &region))
+			FATAL_ERROR();
+		for (j = 0; j < sizeof(frame); ++j)
+		{
+			QUEUE_REGION_AT(&region, j) = frame[j];
+		}
+		queue_commit(&queue, sizeof(frame));
+
+		if (!queue_peek(&queue, sizeof(frame), &region))
+			FATAL_ERROR();
+		for (j = 0; j < sizeof(frame); ++j)
+		{
+			sink += QUEUE_REGION_AT(&region, j);
+		}
+		queue_consume(&queue, sizeof(frame));
+	}
+	printResult("queue frame reserve + commit, peek + consume", frameCount, now() - start);
+
+	// the way isr_SCI1R and isr_SCI1T move bytes
+	start = now();
+	for (i = 0; i < frameCount * sizeof(frame); ++i)
+	{
+		if (!queue_enqueueByte(&queue, (uint8)i))
+			FATAL_ERROR();
+		sink += queue_dequeueByte(&queue);
+	}
+	printResult("queue byte enqueue + dequeue", frameCount * sizeof(frame), now() - start);
+}
+
+/**
+ * crc8() as util.c computed it before the table: 8 shifts per byte
+ */
+static uint8 crc8Bitwise(uint8* pData, uint8 size)
+{
+	uint8 crc = 0;
+	uint8 bit;
+
+	while (size--)
+	{
+		crc ^= *pData++;
+		for (bit = 0; bit < 8; ++bit)
+		{
+			crc = (crc & 0x80) ? (uint8)((crc << 1) ^ 0x9B) : (uint8)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+static uint8 crc8NibbleTable[16];
+
+/**
+ * crc8() with a 16 byte table: 2 lookups per byte, the way out if flash got tight
+ */
+static uint8 crc8Nibble(uint8* pData, uint8 size)
+{
+	uint8 crc = 0;
+
+	while (size--)
+	{
+		crc ^= *pData++;
+		crc = (uint8)(crc << 4) ^ crc8NibbleTable[crc >> 4];
+		crc = (uint8)(crc << 4) ^ crc8NibbleTable[crc >> 4];
+	}
+	return crc;
+}
+
+/**
+ * The checksum of a frame: bitwise, with a nibble table and with the 256 byte table util.c keeps in flash
+ */
+static void benchmarkCrc8(void)
+{
+	const unsigned long frameCount = 2000000;
+	uint8 payload[SCI_CMD_AND_PAYLOAD_SIZE - 1] = { 0x1e, 0x3c, 0x01, 0x2c, 0x00, 0x64, 0x40, 0x00, 0x18, 0x00 };
+	uint8 crc = 0;
+	uint8 value;
+	uint8 bit;
+	unsigned long i;
+	double start;
+
+	for (i = 0; i < 16; ++i)
+	{
+		value = (uint8)(i << 4);
+		for (bit = 0; bit < 4; ++bit)
+		{
+			value = (value & 0x80) ? (uint8)((value << 1) ^ 0x9B) : (uint8)(value << 1);
+		}
+		crc8NibbleTable[i] = value;
+	}
+	for (i = 0; i < 256; ++i)
+	{
+		payload[0] = (uint8)i;
+		if (crc8Nibble(payload, sizeof(payload)) != crc8Bitwise(payload, sizeof(payload))
+			|| crc8(payload, sizeof(payload)) != crc8Bitwise(payload, sizeof(payload)))
+			FATAL_ERROR();
+	}
+
+	start = now();
+	for (i = 0; i < frameCount; ++i)
+	{
+		payload[0] = (uint8)i;
+		crc ^= crc8Bitwise(payload, sizeof(payload));
+	}
+	printResult("crc8 of a frame, bitwise", frameCount, now() - start);
+
+	start = now();
+	for (i = 0; i < frameCount; ++i)
+	{
+		payload[0] = (uint8)i;
+		crc ^= crc8Nibble(payload, sizeof(payload));
+	}
+	printResult("crc8 of a frame, 16 byte nibble table", frameCount, now() - start);
+
+	start = now();
+	for (i = 0; i < frameCount; ++i)
+	{
+		payload[0] = (uint8)i;
+		crc ^= crc8(payload, sizeof(payload));
+	}
+	printResult("crc8 of a frame, 256 byte table", frameCount, now() - start);
+	sink += crc;
+}
+
+static void benchmarkFraming(void)
+{
+	const unsigned long frameCount = 2000000;
+	uint8 move[FRAMING_FRAME_SIZE] = { 0x01, 0x09, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xE1 };
+	uint8 frame[FRAMING_FRAME_SIZE];
+	uint8 framing;
+	uint8 size = 0;
+	FrameReceiver receiver;
+	Queue queue;
+	unsigned long i;
+	double start;
+
+	// the way bt_enqueue() and handleSciReceive() move a Move in either framing
+	for (framing = FRAMING_FIXED; framing <= FRAMING_COBS; ++framing)
+	{
+		framing_init(&receiver);
+		bt_framing = framing;
+		queue_init(&queue);
+
+		start = now();
+		for (i = 0; i < frameCount; ++i)
+		{
+			if (!framing_enqueue(&queue, framing, move))
+				FATAL_ERROR();
+			size = queue_getUsedSpace(&queue);
+			if (!framing_nextFrame(&receiver, &queue, frame))
+				FATAL_ERROR();
+		}
+		printResult(framing == FRAMING_COBS ? "COBS Move encode + receive" : "fixed Move encode + receive", frameCount, now() - start);
+		printf("  %u bytes on the wire, %.0f Moves/s at 115200 baud\n", size, 115200 / 10.0 / size);
+		sink += frame[1];
+	}
+	framing_init(&receiver);
+}
+
+/**
+ * Resource and Status the way taskSendRessource() and taskSendStatus() send them in COBS framing,
+ * as frames of their own and packed into a super-frame. The MC is idle: no background task waited a whole tick,
+ * no one-shot task is queued.
+ */
+static void benchmarkTelemetry(void)
+{
+	const unsigned long cycleCount = 1000000;
+	uint8 status[10] = { 0x0b, 0x1e, 0x3c, 0x01, 0x2c, 0x00, 0x64, 0x40, 0x00, 0x18 };
+	uint8 resource[11] = { 0x0d, 1, 3, 29, 64, 0, 255, 1, 1, 0, 0 };
+	SuperFrame superFrame;
+	uint8 size = 0;
+	unsigned long i;
+	double start;
+
+	bt_framing = FRAMING_COBS;
+	framing_initSuperFrame(&superFrame);
+
+	start = now();
+	for (i = 0; i < cycleCount; ++i)
+	{
+		bt_sendQueue.readPos = bt_sendQueue.writePos;
+		bt_enqueue_crc(resource, sizeof(resource));
+		bt_enqueue_crc(status, sizeof(status));
+		size = queue_getUsedSpace(&bt_sendQueue);
+	}
+	printResult("COBS Resource + Status as two frames", cycleCount, now() - start);
+	printf("  %u bytes on the wire\n", size);
+
+	start = now();
+	for (i = 0; i < cycleCount; ++i)
+	{
+		bt_sendQueue.readPos = bt_sendQueue.writePos;
+		framing_addToSuperFrame(&superFrame, resource, sizeof(resource));
+		framing_addToSuperFrame(&superFrame, status, sizeof(status));
+		framing_flushSuperFrame(&superFrame);
+		size = queue_getUsedSpace(&bt_sendQueue);
+	}
+	printResult("COBS Resource + Status in a super-frame", cycleCount, now() - start);
+	printf("  %u bytes on the wire\n", size);
+
+	bt_sendQueue.readPos = bt_sendQueue.writePos;
+	bt_framing = FRAMING_FIXED;
+}
+
+static void noop(void* unused)
+{
+	(void)unused;
+}
+
+static void benchmarkTaskQueue(void)
+{
+	const unsigned long taskCount = 2000000;
+	TaskQueue queue;
+	Task task = { noop, NULL, TASK_PRIORITY_BACKGROUND, 0 };      // scheduledAt is read by the scheduler only
+	unsigned long i;
+	double start;
+
+	taskqueue_init(&queue);
+
+	start = now();
+	for (i = 0; i < taskCount; ++i)
+	{
+		if (!taskqueue_enqueue(&queue, &task) || !taskqueue_dequeue(&queue, TASK_PRIORITY_BACKGROUND))
+			FATAL_ERROR();
+	}
+	printResult("taskqueue enqueue + dequeue", taskCount, now() - start);
+}
+
+static void benchmarkAllocation(const char* name, uint8 size, bool fragmented)
+{
+	const unsigned long allocationCount = 2000000;
+	unsigned long i;
+	double start;
+
+	malloc_init();
+	if (fragmented)
+	{
+		// every other page taken, larger blocks only fit into the last pages
+		for (i = 0; i < PAGE_POOL_SIZE; ++i)
+		{
+			void* pPage = _malloc(PAGE_SIZE);
+			if (i % 2 == 1 || i + 2 >= PAGE_POOL_SIZE)
+			{
+				_free(pPage);
+			}
+		}
+	}
+
+	start = now();
+	for (i = 0; i < allocationCount; ++i)
+	{
+		void* pData = _malloc(size);
+		if (!pData)
+			FATAL_ERROR();
+		_free(pData);
+	}
+	printResult(name, allocationCount, now() - start);
+}
+
+static unsigned long swappedOutFrames;
+
+static void countFrame(uint8* pBuffer, uint8 bufferSize)
+{
+	(void)pBuffer;
+	(void)bufferSize;
+	++swappedOutFrames;
+}
+
+static void benchmarkSwappableMemory(void)
+{
+	const unsigned long swapCount = 100000;
+	const uint16 size = 160;
+	uint8 data[160];
+	uint8 response[SCI_CMD_AND_PAYLOAD_SIZE + 1] = { 0x0A };
+	SwappableMemoryPool pool;
+	unsigned long i;
+	uint16 offset;
+	double start;
+
+	malloc_init();
+	swappableMemoryPool_init(&pool, malloc_getPagePool(), countFrame);
+	memset(data, 0x55, sizeof(data));
+
+	start = now();
+	for (i = 0; i < swapCount; ++i)
+	{
+		(void)swappableMemoryPool_swapOut(&pool, data, size);
+	}
+	printResult("swap out of 160 bytes", swapCount, now() - start);
+
+	// request the buffer and feed it back the way the host answers
+	start = now();
+	for (i = 0; i < swapCount; ++i)
+	{
+		swappableMemoryPool_requestSwapIn(&pool, 1, data, size);
+		response[1] = 0;
+		response[2] = 1;
+		for (offset = 0; offset < size; offset += SCI_CMD_AND_PAYLOAD_SIZE - 3)
+		{
+			swappableMemoryPool_handleResponse(&pool, response);
+		}
+	}
+	printResult("swap in of 160 bytes", swapCount, now() - start);
+	sink += swappedOutFrames;
+}
+
+static void benchmarkMath(void)
+{
+	const unsigned long calculationCount = 2000000;
+	uint16 line[8] = { 3000, 2900, 2400, 600, 500, 2300, 2900, 3000 };
+	Pid pid;
+	unsigned long i;
+	double start;
+
+	start = now();
+	for (i = 0; i < calculationCount; ++i)
+	{
+		uint8 position;
+		line[i % 8] ^= 1;
+		position = expv(line, 8);
+		sink += var2(line, 8, position);
+	}
+	printResult("line position and width", calculationCount, now() - start);
+
+	pid_init(&pid);
+	pid_setCalibrationData(&pid, 50, 5, 10);
+	start = now();
+	for (i = 0; i < calculationCount; ++i)
+	{
+		sink += pid_calculate(&pid, (uint16)(i % 600), 500);
+	}
+	printResult("pid calculation", calculationCount, now() - start);
+}
+
+/**
+ * Runs the periodic tasks main() schedules, one cycle is one pass of the scheduler, a ms apart.
+ * Every 10th cycle a Move arrives, the SCI sends everything the tasks enqueued.
+ */
+static void benchmarkSchedulerCycle(void)
+{
+	const unsigned long cycleCount = 200000;
+	uint8 move[SCI_CMD_AND_PAYLOAD_SIZE + 1] = { 0x01, 0x01 };
+	unsigned long sentBytes = 0;
+	unsigned long tasks = 0;
+	unsigned long i;
+	double start;
+
+	hal_init();
+	hal_setEncoderSpeed(480, 510);
+	malloc_init();
+	queue_init(&bt_sendQueue);
+	queue_init(&bt_receiveQueue);
+	pid_init(&motorPid[0]);
+	pid_init(&motorPid[1]);
+	scheduler_init(&scheduler, periodicTasks, PERIODIC_TASK_COUNT);
+
+	memset(&counts, 0, sizeof(counts));
+	start = now();
+	for (i = 0; i < cycleCount; ++i)
+	{
+		if (i % 10 == 0)
+		{
+			move[1] = (uint8)(i / 10);
+			move[SCI_CMD_AND_PAYLOAD_SIZE] = crc8(move + 1, SCI_CMD_AND_PAYLOAD_SIZE - 1);
+			if (!queue_enqueue(&bt_receiveQueue, move, sizeof(move)))
+				FATAL_ERROR();
+		}
+
+		while (scheduler_executeNext(&scheduler))
+		{
+			++tasks;
+		}
+		++tickcount;
+
+		while (queue_getUsedSpace(&bt_sendQueue) > 0)
+		{
+			sink += queue_dequeueByte(&bt_sendQueue);
+			++sentBytes;
+		}
+	}
+	printResult("scheduler cycle", cycleCount, now() - start);
+
+	printf("  per cycle: %.2f tasks, %.2f _malloc, %.2f _free, %.2f queue_enqueue, %.2f queue_dequeue, %.2f bytes sent\n",
+		(double)tasks / cycleCount,
+		(double)counts.mallocs / cycleCount,
+		(double)counts.frees / cycleCount,
+		(double)counts.queueEnqueues / cycleCount,
+		(double)counts.queueDequeues / cycleCount,
+		(double)sentBytes / cycleCount);
+}
+
+int main(void)
+{
+	benchmarkQueue();
+	benchmarkCrc8();
+	benchmarkFraming();
+	benchmarkTelemetry();
+	benchmarkTaskQueue();
+	benchmarkAllocation("_malloc + _free of a task", sizeof(Task), FALSE);
+	benchmarkAllocation("_malloc + _free of 3 pages", 3 * PAGE_SIZE, FALSE);
+	benchmarkAllocation("_malloc + _free of 2 pages, fragmented pool", 2 * PAGE_SIZE, TRUE);
+	benchmarkSwappableMemory();
+	benchmarkMath();
+	benchmarkSchedulerCycle();
+
+	return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * hal.c
+ *
+ * Stands in for hardware.c, encoder.c and the globals main.c shares with the drivers in the host build.
+ * bt_enqueue_crc(), bt_enqueue() and bt_sendQueued() have to do the same as in hardware.c.
+ */
+
+#include "hal.h"
+
+#include "encoder.h"
+#include "framing.h"
+#include "pid.h"
+#include "queue.h"
+#include "scheduler.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+Queue bt_sendQueue;
+Queue bt_receiveQueue;
+
+uint8 ledleftred = 0;
+uint8 ledleftgreen = 0;
+uint8 ledleftblue = 0;
+uint8 ledrightred = 0;
+uint8 ledrightgreen = 0;
+uint8 ledrightblue = 0;
+
+uint8 bt_send_busy;
+volatile uint8 bt_receiveErrors;
+uint8 bt_framing;
+
+uint16 linesensor[8];
+uint8  linepos;
+uint16 linewidth;
+uint16 voltage;
+uint16 current;
+uint16 charge_status;
+
+volatile uint16 tickcount;
+
+// darker in the middle, like a black line below the car
+static const uint16 lineProfile[8] = { 3000, 2900, 2400, 600, 500, 2300, 2900, 3000 };
+// what the line sensors see with all leds off
+#define LINE_DARK 200
+
+#define ADC_CURRENT 0x0100
+#define ADC_VOLTAGE 0x0a00
+#define ADC_CHARGE  0x0800
+
+static int16 encoderSpeedLeft;
+static int16 encoderSpeedRight;
+static Direction_t motorDirection;
+static long i2cTransferTime;
+static void (*schedulerStartHook)(void);
+
+void host_fatalError(const char* file, int line)
+{
+	fprintf(stderr, "FATAL_ERROR() in %s:%d\n", file, line);
+	abort();
+}
+
+void hal_init(void)
+{
+	uint8 i;
+
+	for (i = 0; i < 8; ++i)
+	{
+		linesensor[i] = lineProfile[i];
+	}
+	voltage = ADC_VOLTAGE;
+	current = ADC_CURRENT;
+	charge_status = ADC_CHARGE;
+
+	encoderSpeedLeft = 0;
+	encoderSpeedRight = 0;
+	motorDirection = STOP;
+}
+
+void hal_setEncoderSpeed(int16 left, int16 right)
+{
+	encoderSpeedLeft = left;
+	encoderSpeedRight = right;
+}
+
+Direction_t hal_getMotorDirection(void)
+{
+	return motorDirection;
+}
+
+void hal_setI2cTransferTime(long nanoseconds)
+{
+	i2cTransferTime = nanoseconds;
+}
+
+void hal_setSchedulerStartHook(void (*hook)(void))
+{
+	schedulerStartHook = hook;
+}
+
+uint16 hal_convertAdc(void)
+{
+	uint8 channel = ADCSC1_ADCH;
+	uint16 value = LINE_DARK;
+	int led;
+
+	switch (channel)
+	{
+	case 8:
+		return ADC_CURRENT;
+	case 9:
+		return ADC_VOLTAGE;
+	case 10:
+		return ADC_CHARGE;
+	default:
+		break;
+	}
+
+	// channel 7 sees the leds on PTAD4 and PTAD3, channel 6 those on PTAD3 and PTAD2 and so on, see isr_ADC()
+	if (channel >= 4 && channel <= 7)
+	{
+		for (led = channel - 4; led <= channel - 3; ++led)
+		{
+			if (!(PTAD & (1 << led)))	// lit
+			{
+				value += lineProfile[(7 - channel) + (4 - led)];
+			}
+		}
+	}
+	return value;
+}
+
+//### hardware.c ###
+void hardware_lowlevel_init(void)
+{
+	PTAD = PTAD_INIT;
+	SCI1C2 = SCI1C2_INIT;
+	ADCSC1 = ADCSC1_INIT;
+	RTCMOD = RTCMOD_INIT;
+	RTCSC = RTCSC_INIT;
+}
+
+Joy_ways_t getjoystick(void)
+{
+	return PUSH;
+}
+
+void motorcontrol(Direction_t dir, uint16 speedleft, uint16 speedright)
+{
+	motorDirection = dir;
+	TPM2C0V = (speedright >> (16 - MOT_RESOLUTION));
+	TPM2C1V = (speedleft  >> (16 - MOT_RESOLUTION));
+}
+
+void startadc(void)
+{
+	PTAD |= LS_LED_MASK;
+	ADCSC1_ADCH = 4;
+
+	// main() calls this right before scheduler_execute()
+	if (schedulerStartHook)
+	{
+		schedulerStartHook();
+	}
+}
+
+void bt_scibaud(uint16 baud)
+{
+	SCI1BDH = (uint8)(baud >> 8);
+	SCI1BDL = (uint8)baud;
+}
+
+void bt_enqueue_crc(uint8* data, uint8 size)
+{
+	if (!framing_enqueueMessage(&bt_sendQueue, bt_framing, data, size))
+		FATAL_ERROR();
+	bt_sendQueued();
+}
+
+uint16 gettickcount(void)
+{
+	return tickcount;
+}
+
+void bt_enqueue(uint8* data, uint8 size)
+{
+	uint8 frame[FRAMING_FRAME_SIZE] = { 0 };        // padding and checksum (zeroes)
+
+	_memcpy(data, frame, size);
+	if (!framing_enqueue(&bt_sendQueue, bt_framing, frame))
+		FATAL_ERROR();
+	bt_sendQueued();
+}
+
+void bt_sendQueued(void)
+{
+	if (!bt_send_busy)								// restart sci if stopped
+	{
+		if (queue_getUsedSpace(&bt_sendQueue) > 0)
+		{
+			bt_send_busy = TRUE;
+			SCI1C2_TCIE = 1;
+		}
+	}
+}
+
+//### encoder.c ###
+Com_Status_t setupencoder(enc_setup_t setup)
+{
+	(void)setup;
+	return COM_SUCCESS;
+}
+
+Com_Status_t readencoder(enc_data_t *data)
+{
+	// the MC is busy on the I2C bus while the encoder answers
+	if (i2cTransferTime > 0)
+	{
+		struct timespec start, now;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do
+		{
+			clock_gettime(CLOCK_MONOTONIC, &now);
+		} while ((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec) < i2cTransferTime);
+	}
+
+	data->fields.speed_l = encoderSpeedLeft;
+	data->fields.speed_r = encoderSpeedRight;
+	return COM_SUCCESS;
+}
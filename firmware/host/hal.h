@@ -0,0 +1,43 @@
+/*
+ * hal.h
+ *
+ * Host side of the HAL shim: hal.c stands in for hardware.c, encoder.c and the globals main.c shares
+ * with the drivers, these functions let the host set up what the sensors of the MC-Car would deliver.
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#include "hardware.h"
+
+/**
+ * resets the simulated car: line below the middle sensors, motors stopped
+ */
+void hal_init(void);
+
+/**
+ * speeds readencoder() reports from now on
+ */
+void hal_setEncoderSpeed(int16 left, int16 right);
+
+/**
+ * direction of the last motorcontrol() call
+ */
+Direction_t hal_getMotorDirection(void);
+
+/**
+ * time readencoder() keeps the MC busy like the I2C transfer does, 0 returns at once
+ */
+void hal_setI2cTransferTime(long nanoseconds);
+
+/**
+ * called by startadc(), after main() has scheduled its tasks and right before scheduler_execute()
+ */
+void hal_setSchedulerStartHook(void (*hook)(void));
+
+/**
+ * result of a conversion of the channel selected in ADCSC1, depends on the line sensor leds in PTAD
+ */
+uint16 hal_convertAdc(void);
+
+#endif /* HAL_H_ */
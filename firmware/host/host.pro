@@ -0,0 +1,50 @@
+#-------------------------------------------------
+#
+# Firmware core built for the host with a HAL shim
+# (platform.h, registers.h, hal.c) and benchmarked.
+# Needs gcc or clang with GNU ld for the operation counts.
+#
+#-------------------------------------------------
+
+CONFIG -= qt app_bundle
+CONFIG += console
+
+TARGET = firmware-benchmark
+TEMPLATE = app
+
+FIRMWARE = ../mccar-sync/Sources
+
+# platform.h has to come from here, the firmware sources include it by name
+INCLUDEPATH += . $$FIRMWARE
+
+SOURCES += benchmark.c \
+    hal.c \
+    registers.c \
+    $$FIRMWARE/baudNegotiation.c \
+    $$FIRMWARE/framing.c \
+    $$FIRMWARE/malloc.c \
+    $$FIRMWARE/mcmath.c \
+    $$FIRMWARE/pagepool.c \
+    $$FIRMWARE/pid.c \
+    $$FIRMWARE/queue.c \
+    $$FIRMWARE/reliableLink.c \
+    $$FIRMWARE/scheduler.c \
+    $$FIRMWARE/swappableMemory.c \
+    $$FIRMWARE/task.c \
+    $$FIRMWARE/taskQueue.c \
+    $$FIRMWARE/util.c
+
+HEADERS += hal.h \
+    platform.h \
+    registers.h
+
+# C89 as on the MC, with the // comments the firmware uses.
+# POSIX only as far as needed, getline() in stdio.h would collide with the one in hardware.h
+QMAKE_CFLAGS += -std=gnu89
+DEFINES += _POSIX_C_SOURCE=199309L
+QMAKE_CFLAGS_RELEASE += -O2
+
+# counts the calls between the firmware modules, see benchmark.c
+QMAKE_LFLAGS += -Wl,--wrap=_malloc -Wl,--wrap=_free \
+    -Wl,--wrap=queue_enqueue -Wl,--wrap=queue_dequeue \
+    -Wl,--wrap=taskqueue_enqueue -Wl,--wrap=taskqueue_dequeue
@@ -0,0 +1,509 @@
+/*
+ * loop.c
+ *
+ * Firmware in the loop (loop.pro): main() of main.c runs unchanged on the host. SCI1 is a pseudo terminal
+ * carsteuerung connects to, a timer signal raises the SCI1, ADC and RTC interrupts like the MC would.
+ * Measures what the firmware code does under load: command latency, receive queue overruns and swap round trips.
+ */
+
+// loop.pro renames main() of the firmware to firmware_main(), this main() is the host's
+#undef main
+
+#include "hal.h"
+#include "pseudoTerminal.h"
+
+#include "interrupts.h"
+#include "queue.h"
+#include "scheduler.h"
+#include "swappableMemory.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+void firmware_main(void);
+
+extern Queue bt_receiveQueue;
+extern Scheduler scheduler;
+extern SwappableMemoryPool swappableMemoryPool;
+
+#define TICK_NS             100000L     // interrupt period, 10 kHz
+#define FRAME_SIZE          (SCI_CMD_AND_PAYLOAD_SIZE + 1)
+#define MAX_SWAP_SIZE       90          // swapOut() queues all chunks at once, 15 of them and the swap in request fit into the reliable link
+#define PENDING_FRAMES      32          // more than the receive queue holds
+
+typedef struct
+{
+	const char* linkPath;
+	long adcRate;           // conversions per second
+	long i2cTime;           // ns per readencoder()
+	long swapInterval;      // ms, 0 swaps nothing
+	long swapSize;
+	long swapTimeout;       // ms
+	long duration;          // s, 0 runs until SIGINT
+} Configuration;
+
+typedef struct
+{
+	unsigned long receivedBytes;
+	unsigned long sentBytes;
+	unsigned long droppedBytes;     // nobody read the pty
+	unsigned long overruns;
+	unsigned long maxUsedReceiveQueue;
+	unsigned long adcConversions;
+
+	unsigned long commands;
+	double commandLatencySum;       // ns
+	double commandLatencyMax;
+
+	unsigned long swapsCompleted;
+	unsigned long swapsCorrupted;
+	unsigned long swapsTimedOut;    // the firmware keeps waiting for them
+	double swapRoundTripSum;        // ns
+	double swapRoundTripMax;
+} Statistics;
+
+typedef struct
+{
+	struct timespec time;
+	unsigned long end;      // receivedBytes after the last byte of the frame
+} Arrival;
+
+static Configuration config = { NULL, 140000, 375000, 0, 48, 2000, 0 };
+static Statistics stats;
+static PseudoTerminal terminal;
+
+static struct timespec startTime;
+static struct timespec lastTick;
+static double rxCredit;
+static double txCredit;
+static double adcCredit;
+static double rtcCredit;        // ms
+static volatile sig_atomic_t stopRequested;
+
+// frames received but not yet taken by handleSciReceive(), the tick adds, queue_dequeue() and queue_consume() remove
+static Arrival arrivals[PENDING_FRAMES];
+static unsigned pendingHead;
+static unsigned pendingTail;
+static unsigned long consumedBytes;
+
+static double nanosecondsBetween(const struct timespec* from, const struct timespec* to)
+{
+	return (to->tv_sec - from->tv_sec) * 1e9 + (to->tv_nsec - from->tv_nsec);
+}
+
+static long getBaudRate(void)
+{
+	uint16 sbr = (uint16)(((SCI1BDH & 0x1f) << 8) | SCI1BDL);
+	return sbr ? CLOCK / 16 / sbr : 0;
+}
+
+static void dropConsumedFrames(const struct timespec* now)
+{
+	while (pendingTail != pendingHead && arrivals[pendingTail % PENDING_FRAMES].end <= consumedBytes)
+	{
+		if (now)
+		{
+			double latency = nanosecondsBetween(&arrivals[pendingTail % PENDING_FRAMES].time, now);
+			++stats.commands;
+			stats.commandLatencySum += latency;
+			if (latency > stats.commandLatencyMax)
+				stats.commandLatencyMax = latency;
+		}
+		++pendingTail;
+	}
+}
+
+//### the receive queue, handleSciReceive() takes whole frames (-Wl,--wrap=queue_dequeue,--wrap=queue_consume) ###
+bool __real_queue_dequeue(Queue* pQueue, uint8* data, uint8 size);
+void __real_queue_consume(Queue* pQueue, uint8 size);
+
+static void countConsumed(Queue* pQueue, uint8 size)
+{
+	sigset_t tick, previous;
+	struct timespec now;
+
+	if (pQueue != &bt_receiveQueue)
+		return;
+
+	sigemptyset(&tick);
+	sigaddset(&tick, SIGALRM);
+	sigprocmask(SIG_BLOCK, &tick, &previous);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	consumedBytes += size;
+	dropConsumedFrames(&now);
+
+	sigprocmask(SIG_SETMASK, &previous, NULL);
+}
+
+bool __wrap_queue_dequeue(Queue* pQueue, uint8* data, uint8 size)
+{
+	bool result = __real_queue_dequeue(pQueue, data, size);
+	if (result)
+	{
+		countConsumed(pQueue, size);
+	}
+	return result;
+}
+
+// COBS frames are scanned in place, queue_dequeue() calls the real one inside queue.c
+void __wrap_queue_consume(Queue* pQueue, uint8 size)
+{
+	__real_queue_consume(pQueue, size);
+	countConsumed(pQueue, size);
+}
+
+//### interrupts ###
+static void receive(const struct timespec* now)
+{
+	uint8 buffer[64];
+	ssize_t size;
+	ssize_t i;
+
+	if (!SCI1C2_RE || !SCI1C2_RIE || rxCredit < 1)
+		return;
+
+	size = read(terminal.masterFd, buffer, rxCredit < sizeof(buffer) ? (size_t)rxCredit : sizeof(buffer));
+	for (i = 0; i < size; ++i)
+	{
+		uint8 used = queue_getUsedSpace(&bt_receiveQueue);
+
+		SCI1D = buffer[i];
+		SCI1S1_RDRF = 1;
+		isr_SCI1R();
+		SCI1S1_RDRF = 0;
+		++stats.receivedBytes;
+
+		// the queue cannot tell 256 used bytes from none, the byte after 255 empties it
+		if (used == 255)
+		{
+			++stats.overruns;
+			consumedBytes += 256;
+			dropConsumedFrames(NULL);
+		}
+		else if (used + 1UL > stats.maxUsedReceiveQueue)
+		{
+			stats.maxUsedReceiveQueue = used + 1UL;
+		}
+
+		if (stats.receivedBytes % FRAME_SIZE == 0)
+		{
+			if (pendingHead - pendingTail == PENDING_FRAMES)
+				++pendingTail;
+			arrivals[pendingHead % PENDING_FRAMES].time = *now;
+			arrivals[pendingHead % PENDING_FRAMES].end = stats.receivedBytes;
+			++pendingHead;
+		}
+	}
+	if (size > 0)
+		rxCredit -= size;
+}
+
+static void transmit(void)
+{
+	uint8 buffer[64];
+	size_t size = 0;
+	ssize_t written;
+
+	while (SCI1C2_TE && SCI1C2_TCIE && txCredit >= 1 && size < sizeof(buffer))
+	{
+		SCI1S1_TC = 1;
+		isr_SCI1T();
+		SCI1S1_TC = 0;
+		if (!SCI1C2_TCIE)
+			break;	// nothing left to send
+		buffer[size++] = SCI1D;
+		txCredit -= 1;
+	}
+	if (size == 0)
+		return;
+
+	stats.sentBytes += size;
+	written = write(terminal.masterFd, buffer, size);
+	if (written < (ssize_t)size)
+		stats.droppedBytes += size - (written > 0 ? (size_t)written : 0);
+}
+
+static void convert(void)
+{
+	while (ADCSC1_AIEN && adcCredit >= 1)
+	{
+		ADCR = hal_convertAdc();
+		ADCSC1_COCO = 1;
+		isr_ADC();
+		ADCSC1_COCO = 0;
+		++stats.adcConversions;
+		adcCredit -= 1;
+	}
+}
+
+static void count(void)
+{
+	while (RTCSC_RTIE && rtcCredit >= 1)
+	{
+		RTCSC_RTIF = 1;
+		isr_RTC();
+		RTCSC_RTIF = 0;
+		rtcCredit -= 1;
+	}
+}
+
+static void printStatistics(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	printf("ran %.1f s, SCI1 at %ld baud\n", nanosecondsBetween(&startTime, &now) / 1e9, getBaudRate());
+	printf("received bytes: %lu\n", stats.receivedBytes);
+	printf("sent bytes: %lu (%lu dropped, nobody read them)\n", stats.sentBytes, stats.droppedBytes);
+	printf("receive queue: max %lu bytes used, %lu overruns\n", stats.maxUsedReceiveQueue, stats.overruns);
+	printf("commands handled: %lu", stats.commands);
+	if (stats.commands)
+		printf(", latency avg %.0f us, max %.0f us", stats.commandLatencySum / stats.commands / 1e3, stats.commandLatencyMax / 1e3);
+	printf("\n");
+	printf("adc conversions: %lu\n", stats.adcConversions);
+	if (config.swapInterval)
+	{
+		printf("swaps: %lu completed, %lu corrupted, %lu timed out", stats.swapsCompleted, stats.swapsCorrupted, stats.swapsTimedOut);
+		if (stats.swapsCompleted)
+			printf(", round trip avg %.1f ms, max %.1f ms", stats.swapRoundTripSum / stats.swapsCompleted / 1e6, stats.swapRoundTripMax / 1e6);
+		printf("\n");
+	}
+	fflush(stdout);
+}
+
+/**
+ * the MC's interrupts, the firmware is interrupted wherever it is, as on the MC
+ */
+static void tick(int signal)
+{
+	struct timespec now;
+	double elapsed;
+	double maxCredit;
+	long baudRate = getBaudRate();
+	(void)signal;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	elapsed = nanosecondsBetween(&lastTick, &now);
+	lastTick = now;
+
+	// 8N1, a late tick catches up with two ticks at most
+	maxCredit = 2.0 * TICK_NS * baudRate / 10 / 1e9 + 1;
+	rxCredit += elapsed * baudRate / 10 / 1e9;
+	txCredit += elapsed * baudRate / 10 / 1e9;
+	if (rxCredit > maxCredit)
+		rxCredit = maxCredit;
+	if (txCredit > maxCredit)
+		txCredit = maxCredit;
+	adcCredit += elapsed * config.adcRate / 1e9;
+	if (adcCredit > 2.0 * TICK_NS * config.adcRate / 1e9 + 1)
+		adcCredit = 2.0 * TICK_NS * config.adcRate / 1e9 + 1;
+	rtcCredit += elapsed / 1e6;
+
+	receive(&now);
+	transmit();
+	convert();
+	count();
+
+	// firmware_main() never returns, the run ends here
+	if (stopRequested || (config.duration && nanosecondsBetween(&startTime, &now) >= config.duration * 1e9))
+	{
+		printStatistics();
+		pseudoTerminal_close(&terminal);
+		_exit(0);
+	}
+}
+
+static void requestStop(int signal)
+{
+	(void)signal;
+	stopRequested = 1;
+}
+
+//### swap load, scheduled next to the tasks of main() ###
+static void taskSwapLoad(void* unused)
+{
+	static uint8 outData[MAX_SWAP_SIZE];
+	static uint8 inData[MAX_SWAP_SIZE + SCI_CMD_AND_PAYLOAD_SIZE];	// handleResponse() copies whole frames
+	static struct timespec sent;
+	static struct timespec next;
+	static bool pending = FALSE;
+	static uint16 bufferNo;
+	static uint8 round = 0;
+	struct timespec now;
+	(void)unused;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!pending && nanosecondsBetween(&next, &now) >= 0)
+	{
+		long i;
+		++round;
+		for (i = 0; i < config.swapSize; ++i)
+		{
+			outData[i] = (uint8)(i * 7 + round);
+		}
+		memset(inData, 0, sizeof(inData));
+
+		// 0 while the reliable link still has the previous swap in flight, the next task run tries again
+		sent = now;
+		bufferNo = swappableMemoryPool_swapOut(&swappableMemoryPool, outData, (uint16)config.swapSize);
+		if (bufferNo != 0)
+		{
+			swappableMemoryPool_requestSwapIn(&swappableMemoryPool, bufferNo, inData, (uint16)config.swapSize);
+			pending = TRUE;
+		}
+	}
+	else if (pending)
+	{
+		double roundTrip = nanosecondsBetween(&sent, &now);
+		if (!swappableMemoryPool_isSwapInPending(&swappableMemoryPool, bufferNo))
+		{
+			if (memcmp(outData, inData, (size_t)config.swapSize) == 0)
+				++stats.swapsCompleted;
+			else
+				++stats.swapsCorrupted;
+			stats.swapRoundTripSum += roundTrip;
+			if (roundTrip > stats.swapRoundTripMax)
+				stats.swapRoundTripMax = roundTrip;
+			pending = FALSE;
+		}
+		else if (roundTrip >= config.swapTimeout * 1e6)
+		{
+			++stats.swapsTimedOut;
+			pending = FALSE;
+		}
+
+		if (!pending)
+		{
+			next = now;
+			next.tv_sec += config.swapInterval / 1000;
+			next.tv_nsec += (config.swapInterval % 1000) * 1000000L;
+			if (next.tv_nsec >= 1000000000L)
+			{
+				next.tv_nsec -= 1000000000L;
+				++next.tv_sec;
+			}
+		}
+	}
+
+	scheduler_scheduleTask(&scheduler, taskSwapLoad, NULL, TASK_PRIORITY_BACKGROUND);
+}
+
+static void startLoad(void)
+{
+	if (config.swapInterval)
+		scheduler_scheduleTask(&scheduler, taskSwapLoad, NULL, TASK_PRIORITY_BACKGROUND);
+}
+
+//### main ###
+static void printUsage(const char* program)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  --link <path>          symlink to the pty carsteuerung connects to\n"
+		"  --adc-rate <n>         adc conversions per second (default %ld)\n"
+		"  --i2c-time <us>        time readencoder() takes (default %ld)\n"
+		"  --swap-interval <ms>   swap out and back in every ms, 0 = never (default %ld)\n"
+		"  --swap-size <bytes>    bytes per swap, at most %d (default %ld)\n"
+		"  --swap-timeout <ms>    start the next swap if one does not come back (default %ld)\n"
+		"  --duration <s>         stop after s seconds, 0 = on SIGINT (default %ld)\n",
+		program, config.adcRate, config.i2cTime / 1000, config.swapInterval, MAX_SWAP_SIZE, config.swapSize,
+		config.swapTimeout, config.duration);
+}
+
+static bool parseArguments(int argc, char** argv)
+{
+	int i;
+	for (i = 1; i < argc; ++i)
+	{
+		const char* option = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+		char* end = NULL;
+		long number = value ? strtol(value, &end, 10) : 0;
+		bool isNumber = value && *value && *end == '\0' && number >= 0;
+
+		if (!value)
+			return FALSE;
+		++i;
+
+		if (strcmp(option, "--link") == 0)
+			config.linkPath = value;
+		else if (strcmp(option, "--adc-rate") == 0 && isNumber)
+			config.adcRate = number;
+		else if (strcmp(option, "--i2c-time") == 0 && isNumber)
+			config.i2cTime = number * 1000;
+		else if (strcmp(option, "--swap-interval") == 0 && isNumber)
+			config.swapInterval = number;
+		else if (strcmp(option, "--swap-size") == 0 && isNumber && number > 0 && number <= MAX_SWAP_SIZE)
+			config.swapSize = number;
+		else if (strcmp(option, "--swap-timeout") == 0 && isNumber)
+			config.swapTimeout = number;
+		else if (strcmp(option, "--duration") == 0 && isNumber)
+			config.duration = number;
+		else
+			return FALSE;
+	}
+	return TRUE;
+}
+
+int main(int argc, char** argv)
+{
+	struct sigaction action;
+	struct sigevent event;
+	struct itimerspec period;
+	timer_t timer;
+
+	if (!parseArguments(argc, argv))
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	if (pseudoTerminal_open(&terminal, config.linkPath) != 0)
+	{
+		fprintf(stderr, "%s: %s\n", terminal.error, strerror(errno));
+		return 1;
+	}
+	printf("firmware listening on %s\n", config.linkPath ? config.linkPath : terminal.deviceName);
+	fflush(stdout);
+
+	hal_init();
+	hal_setI2cTransferTime(config.i2cTime);
+	hal_setSchedulerStartHook(&startLoad);
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = &requestStop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	action.sa_handler = &tick;
+	sigaction(SIGALRM, &action, NULL);
+
+	memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_SIGNAL;
+	event.sigev_signo = SIGALRM;
+	if (timer_create(CLOCK_MONOTONIC, &event, &timer) != 0)
+	{
+		perror("timer_create");
+		pseudoTerminal_close(&terminal);
+		return 1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &startTime);
+	lastTick = startTime;
+
+	period.it_value.tv_sec = 0;
+	period.it_value.tv_nsec = TICK_NS;
+	period.it_interval = period.it_value;
+	timer_settime(timer, 0, &period, NULL);
+
+	firmware_main();
+
+	// not reached, see tick()
+	return 0;
+}
@@ -0,0 +1,57 @@
+#-------------------------------------------------
+#
+# Firmware in the loop: main() of the firmware runs
+# on the host, SCI1 is a pseudo terminal carsteuerung
+# connects to. Needs Linux and GNU ld.
+#
+#-------------------------------------------------
+
+CONFIG -= qt app_bundle
+CONFIG += console
+
+TARGET = firmware-loop
+TEMPLATE = app
+
+FIRMWARE = ../mccar-sync/Sources
+
+# platform.h has to come from here, the firmware sources include it by name
+INCLUDEPATH += . $$FIRMWARE
+
+SOURCES += loop.c \
+    pseudoTerminal.c \
+    hal.c \
+    registers.c \
+    $$FIRMWARE/baudNegotiation.c \
+    $$FIRMWARE/framing.c \
+    $$FIRMWARE/interrupts.c \
+    $$FIRMWARE/main.c \
+    $$FIRMWARE/malloc.c \
+    $$FIRMWARE/mcmath.c \
+    $$FIRMWARE/pagepool.c \
+    $$FIRMWARE/pid.c \
+    $$FIRMWARE/queue.c \
+    $$FIRMWARE/reliableLink.c \
+    $$FIRMWARE/scheduler.c \
+    $$FIRMWARE/swappableMemory.c \
+    $$FIRMWARE/task.c \
+    $$FIRMWARE/taskQueue.c \
+    $$FIRMWARE/util.c
+
+HEADERS += hal.h \
+    platform.h \
+    pseudoTerminal.h \
+    registers.h
+
+# C89 as on the MC, with the // comments the firmware uses.
+# POSIX only as far as needed, getline() in stdio.h would collide with the one in hardware.h
+QMAKE_CFLAGS += -std=gnu89
+DEFINES += _POSIX_C_SOURCE=199309L
+QMAKE_CFLAGS_RELEASE += -O2
+
+# main() of main.c becomes firmware_main(), loop.c has the host's main()
+DEFINES += main=firmware_main
+
+# the command latency is taken when handleSciReceive() takes a frame out of the queue, see loop.c
+QMAKE_LFLAGS += -Wl,--wrap=queue_dequeue -Wl,--wrap=queue_consume
+
+LIBS += -lutil -lrt
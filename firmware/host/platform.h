@@ -0,0 +1,45 @@
+/*
+ * platform.h
+ *
+ * Stand-in for MC_Library/Lib_Headers/platform.h when the firmware is built for the host.
+ * The types keep the sizes of the HCS08 compiler, the registers are simulated (registers.h).
+ */
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "registers.h"
+
+#define BUSCLOCK              24000000  // Hz
+
+#define BLUETOOTH_NAME        "MC-Car xyz"
+
+#define EnableInterrupts
+#define DisableInterrupts
+#define __RESET_WATCHDOG()
+
+#define _Stop
+#define _Wait
+
+// isr_* are plain functions, the host calls them where the MC would raise the interrupt
+#define interrupt
+
+// the MC hangs in an endless loop, the host reports where and aborts
+#define FATAL_ERROR() host_fatalError(__FILE__, __LINE__)
+void host_fatalError(const char* file, int line);
+
+// the HCS08 compiler has 16 bit ints
+typedef uint8_t uint8;
+typedef int8_t int8;
+typedef uint16_t uint16;
+typedef int16_t int16;
+typedef uint32_t uint32;
+typedef int32_t int32;
+typedef char bool;
+
+#define TRUE                1
+#define FALSE               0
+
+#endif /* PLATFORM_H_ */
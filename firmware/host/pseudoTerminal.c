@@ -0,0 +1,74 @@
+/*
+ * pseudoTerminal.c
+ *
+ * Only talks to the OS, the firmware headers stay out of here.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "pseudoTerminal.h"
+
+#include <fcntl.h>
+#include <pty.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+int pseudoTerminal_open(PseudoTerminal* pTerminal, const char* linkPath)
+{
+	struct termios attributes;
+	int flags;
+
+	memset(pTerminal, 0, sizeof(*pTerminal));
+	pTerminal->masterFd = -1;
+	pTerminal->slaveFd = -1;
+
+	memset(&attributes, 0, sizeof(attributes));
+	cfmakeraw(&attributes);
+	cfsetspeed(&attributes, B115200);
+
+	if (openpty(&pTerminal->masterFd, &pTerminal->slaveFd, pTerminal->deviceName, &attributes, NULL) != 0)
+	{
+		pTerminal->error = "openpty";
+		return -1;
+	}
+
+	// the slave side stays open here as well, the master would read EIO whenever carsteuerung closes the port
+	flags = fcntl(pTerminal->masterFd, F_GETFL);
+	if (flags < 0 || fcntl(pTerminal->masterFd, F_SETFL, flags | O_NONBLOCK) != 0)
+	{
+		pTerminal->error = "fcntl";
+		pseudoTerminal_close(pTerminal);
+		return -1;
+	}
+
+	if (linkPath)
+	{
+		unlink(linkPath);
+		if (symlink(pTerminal->deviceName, linkPath) != 0)
+		{
+			pTerminal->error = "symlink";
+			pseudoTerminal_close(pTerminal);
+			return -1;
+		}
+		strncpy(pTerminal->linkPath, linkPath, sizeof(pTerminal->linkPath) - 1);
+	}
+
+	return 0;
+}
+
+void pseudoTerminal_close(PseudoTerminal* pTerminal)
+{
+	if (pTerminal->linkPath[0])
+	{
+		unlink(pTerminal->linkPath);
+		pTerminal->linkPath[0] = '\0';
+	}
+	if (pTerminal->masterFd >= 0)
+	{
+		close(pTerminal->masterFd);
+		close(pTerminal->slaveFd);
+	}
+	pTerminal->masterFd = -1;
+	pTerminal->slaveFd = -1;
+}
@@ -0,0 +1,27 @@
+/*
+ * pseudoTerminal.h
+ *
+ * Pseudo terminal the host build of the firmware uses as its SCI1, carsteuerung opens the slave side.
+ */
+
+#ifndef PSEUDOTERMINAL_H_
+#define PSEUDOTERMINAL_H_
+
+typedef struct
+{
+	int masterFd;
+	int slaveFd;
+	char deviceName[64];
+	char linkPath[256];
+	const char* error;		// what failed, errno tells why
+} PseudoTerminal;
+
+/**
+ * opens a raw, non-blocking pty and links linkPath (may be NULL) to its slave side
+ * @returns 0, -1 on errors
+ */
+int pseudoTerminal_open(PseudoTerminal* pTerminal, const char* linkPath);
+
+void pseudoTerminal_close(PseudoTerminal* pTerminal);
+
+#endif /* PSEUDOTERMINAL_H_ */
@@ -0,0 +1,30 @@
+/*
+ * registers.c
+ */
+
+#include "registers.h"
+
+volatile HostRegister8 _PTAD;
+volatile HostRegister8 _PTBD;
+volatile HostRegister8 _PTCD;
+volatile HostRegister8 _PTDD;
+volatile HostRegister8 _PTED;
+volatile HostRegister8 _PTFD;
+volatile HostRegister8 _PTGD;
+volatile HostRegister8 _PTDDD;
+
+volatile HostRegister8 _SCI1BDH;
+volatile HostRegister8 _SCI1BDL;
+volatile HostRegister8 _SCI1C2;
+volatile HostRegister8 _SCI1S1;
+volatile HostRegister8 _SCI1D;
+
+volatile HostRegisterADCSC1 _ADCSC1;
+volatile HostRegister16 _ADCR;
+
+volatile HostRegister8 _TPM2SC;
+volatile HostRegister16 _TPM2C0V;
+volatile HostRegister16 _TPM2C1V;
+
+volatile HostRegister8 _RTCSC;
+volatile HostRegister8 _RTCMOD;
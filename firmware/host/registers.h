@@ -0,0 +1,161 @@
+/*
+ * registers.h
+ *
+ * Simulated MC9S08JM60 registers for the host build, a subset of mc9s08jm60.h with the same names.
+ * They are plain memory: writing SCI1D sends nothing and ADCR only changes when the host writes to it.
+ */
+#ifndef REGISTERS_H_
+#define REGISTERS_H_
+
+#include <stdint.h>
+
+typedef union
+{
+	uint8_t Byte;
+	struct
+	{
+		uint8_t bit0 : 1;
+		uint8_t bit1 : 1;
+		uint8_t bit2 : 1;
+		uint8_t bit3 : 1;
+		uint8_t bit4 : 1;
+		uint8_t bit5 : 1;
+		uint8_t bit6 : 1;
+		uint8_t bit7 : 1;
+	} Bits;
+} HostRegister8;
+
+typedef union
+{
+	uint16_t Word;
+} HostRegister16;
+
+//### Ports ###
+extern volatile HostRegister8 _PTAD;
+extern volatile HostRegister8 _PTBD;
+extern volatile HostRegister8 _PTCD;
+extern volatile HostRegister8 _PTDD;
+extern volatile HostRegister8 _PTED;
+extern volatile HostRegister8 _PTFD;
+extern volatile HostRegister8 _PTGD;
+extern volatile HostRegister8 _PTDDD;
+
+#define PTAD                _PTAD.Byte
+#define PTAD_PTAD0          _PTAD.Bits.bit0
+#define PTAD_PTAD1          _PTAD.Bits.bit1
+#define PTAD_PTAD2          _PTAD.Bits.bit2
+#define PTAD_PTAD3          _PTAD.Bits.bit3
+#define PTAD_PTAD4          _PTAD.Bits.bit4
+#define PTAD_PTAD5          _PTAD.Bits.bit5
+
+#define PTBD                _PTBD.Byte
+#define PTBD_PTBD3          _PTBD.Bits.bit3
+
+#define PTCD                _PTCD.Byte
+#define PTCD_PTCD4          _PTCD.Bits.bit4
+#define PTCD_PTCD6          _PTCD.Bits.bit6
+
+#define PTDD                _PTDD.Byte
+#define PTDD_PTDD3          _PTDD.Bits.bit3
+#define PTDDD               _PTDDD.Byte
+
+#define PTED                _PTED.Byte
+#define PTED_PTED7          _PTED.Bits.bit7
+
+#define PTFD                _PTFD.Byte
+#define PTFD_PTFD0          _PTFD.Bits.bit0
+#define PTFD_PTFD1          _PTFD.Bits.bit1
+#define PTFD_PTFD3          _PTFD.Bits.bit3
+#define PTFD_PTFD4          _PTFD.Bits.bit4
+#define PTFD_PTFD7          _PTFD.Bits.bit7
+
+#define PTGD                _PTGD.Byte
+#define PTGD_PTGD3          _PTGD.Bits.bit3
+
+//### SCI1, the bluetooth module ###
+extern volatile HostRegister8 _SCI1BDH;
+extern volatile HostRegister8 _SCI1BDL;
+extern volatile HostRegister8 _SCI1C2;
+extern volatile HostRegister8 _SCI1S1;
+extern volatile HostRegister8 _SCI1D;
+
+#define SCI1BDH             _SCI1BDH.Byte
+#define SCI1BDL             _SCI1BDL.Byte
+
+#define SCI1C2              _SCI1C2.Byte
+#define SCI1C2_SBK          _SCI1C2.Bits.bit0
+#define SCI1C2_RWU          _SCI1C2.Bits.bit1
+#define SCI1C2_RE           _SCI1C2.Bits.bit2
+#define SCI1C2_TE           _SCI1C2.Bits.bit3
+#define SCI1C2_ILIE         _SCI1C2.Bits.bit4
+#define SCI1C2_RIE          _SCI1C2.Bits.bit5
+#define SCI1C2_TCIE         _SCI1C2.Bits.bit6
+#define SCI1C2_TIE          _SCI1C2.Bits.bit7
+#define SCI1C2_RE_MASK      4U
+#define SCI1C2_TE_MASK      8U
+#define SCI1C2_RIE_MASK     32U
+#define SCI1C2_TCIE_MASK    64U
+
+#define SCI1S1              _SCI1S1.Byte
+#define SCI1S1_PF           _SCI1S1.Bits.bit0
+#define SCI1S1_FE           _SCI1S1.Bits.bit1
+#define SCI1S1_NF           _SCI1S1.Bits.bit2
+#define SCI1S1_OR           _SCI1S1.Bits.bit3
+#define SCI1S1_IDLE         _SCI1S1.Bits.bit4
+#define SCI1S1_RDRF         _SCI1S1.Bits.bit5
+#define SCI1S1_TC           _SCI1S1.Bits.bit6
+#define SCI1S1_TDRE         _SCI1S1.Bits.bit7
+
+#define SCI1D               _SCI1D.Byte
+
+//### ADC ###
+typedef union
+{
+	uint8_t Byte;
+	struct
+	{
+		uint8_t ADCH : 5;
+		uint8_t ADCO : 1;
+		uint8_t AIEN : 1;
+		uint8_t COCO : 1;
+	} Bits;
+} HostRegisterADCSC1;
+
+extern volatile HostRegisterADCSC1 _ADCSC1;
+extern volatile HostRegister16 _ADCR;
+
+#define ADCSC1              _ADCSC1.Byte
+#define ADCSC1_ADCH         _ADCSC1.Bits.ADCH
+#define ADCSC1_ADCO         _ADCSC1.Bits.ADCO
+#define ADCSC1_AIEN         _ADCSC1.Bits.AIEN
+#define ADCSC1_COCO         _ADCSC1.Bits.COCO
+#define ADCSC1_AIEN_MASK    64U
+#define ADCSC1_ADCH_MASK    31U
+
+#define ADCR                _ADCR.Word
+
+//### Timer 2, motor PWM and LED dimming ###
+extern volatile HostRegister8 _TPM2SC;
+extern volatile HostRegister16 _TPM2C0V;
+extern volatile HostRegister16 _TPM2C1V;
+
+#define TPM2SC              _TPM2SC.Byte
+#define TPM2SC_TOIE         _TPM2SC.Bits.bit6
+#define TPM2SC_TOF          _TPM2SC.Bits.bit7
+
+#define TPM2C0V             _TPM2C0V.Word
+#define TPM2C1V             _TPM2C1V.Word
+
+//### Real time counter, the ms tick ###
+extern volatile HostRegister8 _RTCSC;
+extern volatile HostRegister8 _RTCMOD;
+
+#define RTCSC               _RTCSC.Byte
+#define RTCSC_RTIE          _RTCSC.Bits.bit4
+#define RTCSC_RTIF          _RTCSC.Bits.bit7
+#define RTCSC_RTCPS3_MASK   8U
+#define RTCSC_RTIE_MASK     16U
+
+#define RTCMOD              _RTCMOD.Byte
+
+#endif /* REGISTERS_H_ */
@@ -0,0 +1,172 @@
+/*
+ * baudNegotiation.c
+ */
+
+#include "baudNegotiation.h"
+#include "hardware.h"
+#include "queue.h"
+#include "util.h"
+
+#define FRAME_SIZE (SCI_CMD_AND_PAYLOAD_SIZE + 1)
+
+extern Queue bt_receiveQueue;
+extern uint8 bt_send_busy;
+extern volatile uint8 bt_receiveErrors;
+
+#define BAUD_PRESCALER(baud)    (CLOCK / 16 / (baud))
+#define BAUD_REAL(baud)         (CLOCK / 16 / BAUD_PRESCALER(baud))
+#define BAUD_IS_EXACT(baud)     (BAUD_REAL(baud) * 1000 <= (baud) * (1000 + BT_BAUD_MAXERR) \
+								&& BAUD_REAL(baud) * 1000 >= (baud) * (1000 - BT_BAUD_MAXERR))
+
+// the bus clock / 16 divided by an integer prescaler, the standard rates above 115200 are 5% and more off at 24 MHz
+#define BAUD_RATE_0     115200      // 115385
+#define BAUD_RATE_1     250000
+#define BAUD_RATE_2     500000
+#define BAUD_RATE_3     1500000
+
+#if !BAUD_IS_EXACT(BAUD_RATE_0) || !BAUD_IS_EXACT(BAUD_RATE_1) || !BAUD_IS_EXACT(BAUD_RATE_2) || !BAUD_IS_EXACT(BAUD_RATE_3)
+	#error "Baud rate error for bluetooth module too high, see BT_BAUD_MAXERR"
+#endif
+
+static const BaudRateEntry baudRates[] =
+{
+	{ BAUD_RATE_0, BAUD_PRESCALER(BAUD_RATE_0) },
+	{ BAUD_RATE_1, BAUD_PRESCALER(BAUD_RATE_1) },
+	{ BAUD_RATE_2, BAUD_PRESCALER(BAUD_RATE_2) },
+	{ BAUD_RATE_3, BAUD_PRESCALER(BAUD_RATE_3) }
+};
+
+#define BAUD_RATE_COUNT (sizeof(baudRates) / sizeof(baudRates[0]))
+#define DEFAULT_RATE    0
+
+static uint32 getFrameBaudRate(uint8* pCommand)
+{
+	return (uint32)pCommand[1] << 16 | (uint32)pCommand[2] << 8 | pCommand[3];
+}
+
+static void sendFrame(uint8* pFrame)
+{
+	pFrame[FRAME_SIZE - 1] = crc8(pFrame + 1, SCI_CMD_AND_PAYLOAD_SIZE - 1);
+	bt_enqueue(pFrame, FRAME_SIZE);
+}
+
+static void sendRateFrame(uint8 cmd, uint32 baud, uint8 flag)
+{
+	uint8 frame[FRAME_SIZE] = { 0 };
+
+	frame[0] = cmd;
+	frame[1] = (uint8)(baud >> 16);
+	frame[2] = (uint8)(baud >> 8);
+	frame[3] = (uint8)baud;
+	frame[4] = flag;
+	sendFrame(frame);
+}
+
+static void switchTo(BaudNegotiation* pNegotiation, uint8 rate, uint16 now)
+{
+	uint16 start = gettickcount();
+
+	// whatever is queued has to leave at the old rate, no task can add to it meanwhile
+	while (bt_send_busy && (uint16)(gettickcount() - start) < 100)
+	{
+		__RESET_WATCHDOG();
+	}
+
+	DisableInterrupts;
+	bt_scibaud(baudRates[rate].prescaler);
+	queue_consume(&bt_receiveQueue, queue_getUsedSpace(&bt_receiveQueue));  // half a frame at the old rate would shift all frames after it
+	EnableInterrupts;
+
+	pNegotiation->current = rate;
+	pNegotiation->switchedAt = now;
+	pNegotiation->errorWindowStart = now;
+	pNegotiation->errorsAtWindowStart = bt_receiveErrors;
+}
+
+void baudNegotiation_init(BaudNegotiation* pNegotiation)
+{
+	pNegotiation->current = DEFAULT_RATE;
+	pNegotiation->committed = DEFAULT_RATE;
+	pNegotiation->isCommitPending = FALSE;
+	pNegotiation->switchedAt = 0;
+	pNegotiation->errorWindowStart = 0;
+	pNegotiation->errorsAtWindowStart = 0;
+}
+
+void baudNegotiation_handleCommand(BaudNegotiation* pNegotiation, uint8* pCommand, uint16 now)
+{
+	uint32 baud;
+	uint8 rate;
+
+	// a corrupted Propose or Probe must not be taken for a working link
+	if (crc8(pCommand + 1, SCI_CMD_AND_PAYLOAD_SIZE - 1) != pCommand[SCI_CMD_AND_PAYLOAD_SIZE])
+		return;
+
+	switch (pCommand[0])
+	{
+	case BAUD_PROPOSE_CMD:
+		baud = getFrameBaudRate(pCommand);
+		rate = 0;
+		while (rate < BAUD_RATE_COUNT && baudRates[rate].baud != baud)
+		{
+			++rate;
+		}
+		if (rate == BAUD_RATE_COUNT)
+		{
+			sendRateFrame(BAUD_ACCEPT_CMD, baud, FALSE);
+			break;
+		}
+
+		// a Propose before the Commit of the previous one replaces it
+		sendRateFrame(BAUD_ACCEPT_CMD, baud, TRUE);
+		switchTo(pNegotiation, rate, now);
+		pNegotiation->isCommitPending = rate != pNegotiation->committed;
+		break;
+
+	case BAUD_PROBE_CMD:
+		bt_enqueue(pCommand, FRAME_SIZE);
+		break;
+
+	case BAUD_COMMIT_CMD:
+		baud = getFrameBaudRate(pCommand);
+		if (baud == baudRates[pNegotiation->current].baud)
+		{
+			pNegotiation->committed = pNegotiation->current;
+			pNegotiation->isCommitPending = FALSE;
+			sendRateFrame(BAUD_COMMIT_CMD, baud, TRUE);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void baudNegotiation_poll(BaudNegotiation* pNegotiation, uint16 now)
+{
+	if (pNegotiation->isCommitPending && (uint16)(now - pNegotiation->switchedAt) >= BAUD_COMMIT_TIMEOUT)
+	{
+		pNegotiation->isCommitPending = FALSE;
+		switchTo(pNegotiation, pNegotiation->committed, now);
+		return;
+	}
+
+	if ((uint16)(now - pNegotiation->errorWindowStart) < BAUD_ERROR_WINDOW)
+		return;
+
+	if (pNegotiation->current != DEFAULT_RATE
+			&& (uint8)(bt_receiveErrors - pNegotiation->errorsAtWindowStart) >= BAUD_MAX_RECEIVE_ERRORS)
+	{
+		pNegotiation->committed = DEFAULT_RATE;
+		pNegotiation->isCommitPending = FALSE;
+		switchTo(pNegotiation, DEFAULT_RATE, now);
+		return;
+	}
+	pNegotiation->errorWindowStart = now;
+	pNegotiation->errorsAtWindowStart = bt_receiveErrors;
+}
+
+uint32 baudNegotiation_getBaudRate(BaudNegotiation* pNegotiation)
+{
+	return baudRates[pNegotiation->current].baud;
+}
@@ -0,0 +1,62 @@
+/*
+ * baudNegotiation.h
+ *
+ * Lets the host switch SCI1 to one of the faster rates of hardware.h at runtime.
+ *
+ * The host proposes a rate, the MC accepts it and switches right after the Accept has left at the old rate,
+ * so the Accept is the last frame at the old rate in one direction and the Propose in the other.
+ * At the new rate the host sends a burst of probes, the MC echoes each one that arrives intact.
+ * Only if all of them came back the host commits, otherwise both sides return to the previous rate:
+ * the host right away, the MC when no Commit arrives within BAUD_COMMIT_TIMEOUT.
+ *
+ * Away from BT_DEFAULT_BAUD, framing errors on the receiver mean the host lost the rate (e.g. restarted),
+ * the MC then falls back to BT_DEFAULT_BAUD on its own.
+ */
+
+#ifndef BAUDNEGOTIATION_H_
+#define BAUDNEGOTIATION_H_
+
+#include "platform.h"
+
+#define BAUD_PROPOSE_CMD            0x16    // host -> MC: rate
+#define BAUD_ACCEPT_CMD             0x17    // MC -> host: rate, accepted
+#define BAUD_PROBE_CMD              0x18    // host -> MC, echoed
+#define BAUD_COMMIT_CMD             0x19    // host -> MC: rate, echoed
+
+#define BT_DEFAULT_BAUD             115200  // after reset, see init()
+
+#define BAUD_COMMIT_TIMEOUT         1000    // ms at the new rate without a Commit
+#define BAUD_ERROR_WINDOW           1000    // ms
+#define BAUD_MAX_RECEIVE_ERRORS     8       // framing and noise errors per window before falling back
+
+typedef struct
+{
+	uint32 baud;
+	uint16 prescaler;
+} BaudRateEntry;
+
+typedef struct BaudNegotiationSTRUCT
+{
+	uint8 current;              // index into the rate table
+	uint8 committed;            // falls back to it if the host does not commit current
+	bool isCommitPending;
+	uint16 switchedAt;          // tick
+	uint16 errorWindowStart;    // tick
+	uint8 errorsAtWindowStart;
+} BaudNegotiation;
+
+void baudNegotiation_init(BaudNegotiation* pNegotiation);
+
+/**
+ * handles Propose, Probe and Commit, pCommand points to all SCI_CMD_AND_PAYLOAD_SIZE + 1 bytes of the frame
+ */
+void baudNegotiation_handleCommand(BaudNegotiation* pNegotiation, uint8* pCommand, uint16 now);
+
+/**
+ * falls back if the host did not commit in time or the receiver sees too many errors
+ */
+void baudNegotiation_poll(BaudNegotiation* pNegotiation, uint16 now);
+
+uint32 baudNegotiation_getBaudRate(BaudNegotiation* pNegotiation);
+
+#endif /* BAUDNEGOTIATION_H_ */
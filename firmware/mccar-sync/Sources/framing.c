@@ -0,0 +1,331 @@
+/*
+ * framing.c
+ */
+
+#include "framing.h"
+#include "util.h"
+
+extern uint8 bt_framing;
+extern Queue bt_sendQueue;
+
+/**
+ * decodes a COBS block without its delimiter
+ * @returns the size decoded, 0 if the block is malformed or longer than a frame
+ */
+static uint8 cobsDecode(uint8* pData, uint8 size, uint8* pTarget)
+{
+	uint8 i = 0;
+	uint8 decodedSize = 0;
+	uint8 code;
+
+	while (i < size)
+	{
+		code = pData[i++];
+		if (code - 1 > size - i || code - 1 > FRAMING_FRAME_SIZE - decodedSize)
+			return 0;
+
+		while (--code > 0)
+		{
+			pTarget[decodedSize++] = pData[i++];
+		}
+
+		// the zero a code stands for is implied at the end of the block
+		if (i < size)
+		{
+			if (decodedSize == FRAMING_FRAME_SIZE)
+				return 0;
+			pTarget[decodedSize++] = 0;
+		}
+	}
+	return decodedSize;
+}
+
+#define COBS_WIRE_SIZE(size)    ((size) + 3)    // the crc, code byte and delimiter
+
+/**
+ * COBS encodes size bytes (up to 252) and the crc straight into the ring and appends the delimiter
+ * @param pTarget COBS_WIRE_SIZE(size) bytes
+ * @returns the size on the wire
+ */
+static uint8 cobsEncode(uint8* pData, uint8 size, uint8 crc, QueueRegion* pTarget)
+{
+	uint8 codePos = 0;
+	uint8 targetSize = 1;
+	uint8 value;
+	uint8 i;
+
+	for (i = 0; i <= size; ++i)
+	{
+		value = i < size ? pData[i] : crc;
+		if (value == 0)
+		{
+			QUEUE_REGION_AT(pTarget, codePos) = targetSize - codePos;
+			codePos = targetSize++;
+		}
+		else
+		{
+			QUEUE_REGION_AT(pTarget, targetSize) = value;
+			++targetSize;
+		}
+	}
+	QUEUE_REGION_AT(pTarget, codePos) = targetSize - codePos;
+	QUEUE_REGION_AT(pTarget, targetSize) = 0;
+	return targetSize + 1;
+}
+
+/**
+ * cmd and the payload without its trailing zeros
+ */
+static uint8 trimPadding(uint8* pMessage, uint8 size)
+{
+	while (size > 1 && pMessage[size - 1] == 0)
+	{
+		--size;
+	}
+	return size;
+}
+
+static void switchTo(FrameReceiver* pReceiver, uint8 framing)
+{
+	bt_framing = framing;
+	pReceiver->size = 0;
+	pReceiver->isDiscarding = FALSE;
+	pReceiver->decodeErrors = 0;
+}
+
+void framing_init(FrameReceiver* pReceiver)
+{
+	switchTo(pReceiver, FRAMING_FIXED);
+}
+
+bool framing_enqueue(Queue* pQueue, uint8 framing, uint8* pFrame)
+{
+	QueueRegion region;
+	uint8 size;
+
+	if (framing != FRAMING_COBS)
+		return queue_enqueue(pQueue, pFrame, FRAMING_FRAME_SIZE);
+
+	size = trimPadding(pFrame, SCI_CMD_AND_PAYLOAD_SIZE);
+	if (!queue_reserve(pQueue, COBS_WIRE_SIZE(size), &region))
+		return FALSE;
+
+	queue_commit(pQueue, cobsEncode(pFrame, size, pFrame[SCI_CMD_AND_PAYLOAD_SIZE], &region));
+	return TRUE;
+}
+
+bool framing_enqueueMessage(Queue* pQueue, uint8 framing, uint8* pMessage, uint8 size)
+{
+	QueueRegion region;
+	uint8 crc = 0;
+	uint8 i;
+
+	if (framing != FRAMING_COBS)
+	{
+		if (!queue_reserve(pQueue, FRAMING_FRAME_SIZE, &region))
+			return FALSE;
+
+		QUEUE_REGION_AT(&region, 0) = pMessage[0];
+		for (i = 1; i < size; ++i)                  // the crc follows the payload as it is copied
+		{
+			QUEUE_REGION_AT(&region, i) = pMessage[i];
+			crc = CRC8_UPDATE(crc, pMessage[i]);
+		}
+		for (; i < SCI_CMD_AND_PAYLOAD_SIZE; ++i)   // and covers the padding
+		{
+			QUEUE_REGION_AT(&region, i) = 0;
+			crc = CRC8_UPDATE(crc, 0);
+		}
+		QUEUE_REGION_AT(&region, SCI_CMD_AND_PAYLOAD_SIZE) = crc;
+		queue_commit(pQueue, FRAMING_FRAME_SIZE);
+		return TRUE;
+	}
+
+	for (i = 1; i < size; ++i)
+	{
+		crc = CRC8_UPDATE(crc, pMessage[i]);
+	}
+	for (; i < SCI_CMD_AND_PAYLOAD_SIZE; ++i)
+	{
+		crc = CRC8_UPDATE(crc, 0);
+	}
+
+	size = trimPadding(pMessage, size);
+	if (!queue_reserve(pQueue, COBS_WIRE_SIZE(size), &region))
+		return FALSE;
+
+	queue_commit(pQueue, cobsEncode(pMessage, size, crc, &region));
+	return TRUE;
+}
+
+bool framing_nextFrame(FrameReceiver* pReceiver, Queue* pQueue, uint8* pFrame)
+{
+	QueueRegion region;
+	uint8 used;
+	uint8 i;
+	uint8 value;
+	uint8 decodedSize;
+	uint8 crc;
+
+	if (bt_framing != FRAMING_COBS)
+	{
+		if (queue_getUsedSpace(pQueue) < FRAMING_FRAME_SIZE)
+			return FALSE;
+
+		if (!queue_dequeue(pQueue, pFrame, FRAMING_FRAME_SIZE))
+			FATAL_ERROR();
+		return TRUE;
+	}
+
+	// the bytes are scanned in place and consumed at once, isr_SCI1R() may append meanwhile
+	used = queue_getUsedSpace(pQueue);
+	if (!queue_peek(pQueue, used, &region))
+		FATAL_ERROR();
+
+	for (i = 0; i < used; ++i)
+	{
+		value = QUEUE_REGION_AT(&region, i);
+		if (value != 0)
+		{
+			if (pReceiver->size < sizeof(pReceiver->buffer))
+			{
+				pReceiver->buffer[pReceiver->size++] = value;
+			}
+			else
+			{
+				pReceiver->isDiscarding = TRUE;
+			}
+			continue;
+		}
+
+		// a delimiter right after the previous one carries no frame
+		if (pReceiver->size == 0 && !pReceiver->isDiscarding)
+			continue;
+
+		decodedSize = pReceiver->isDiscarding ? 0 : cobsDecode(pReceiver->buffer, pReceiver->size, pFrame);
+		pReceiver->size = 0;
+		pReceiver->isDiscarding = FALSE;
+
+		if (decodedSize < 2)
+		{
+			if (++pReceiver->decodeErrors >= FRAMING_MAX_DECODE_ERRORS)
+			{
+				// whatever is buffered was sent in fixed framing as well, but does not start at a frame,
+				// isr_SCI1R() only moves writePos
+				switchTo(pReceiver, FRAMING_FIXED);
+				queue_consume(pQueue, queue_getUsedSpace(pQueue));
+				return FALSE;
+			}
+			continue;
+		}
+
+		// move the crc behind the padding
+		crc = pFrame[decodedSize - 1];
+		for (--decodedSize; decodedSize < SCI_CMD_AND_PAYLOAD_SIZE; ++decodedSize)
+		{
+			pFrame[decodedSize] = 0;
+		}
+		pFrame[SCI_CMD_AND_PAYLOAD_SIZE] = crc;
+
+		pReceiver->decodeErrors = 0;
+		queue_consume(pQueue, i + 1);
+		return TRUE;
+	}
+	queue_consume(pQueue, used);
+	return FALSE;
+}
+
+void framing_handleCommand(FrameReceiver* pReceiver, uint8* pCommand)
+{
+	uint8 frame[FRAMING_FRAME_SIZE] = { 0 };
+	uint8 framing = pCommand[1];
+
+	if (pCommand[0] != FRAMING_PROPOSE_CMD || crc8(pCommand + 1, SCI_CMD_AND_PAYLOAD_SIZE - 1) != pCommand[SCI_CMD_AND_PAYLOAD_SIZE])
+		return;
+
+	frame[0] = FRAMING_ACCEPT_CMD;
+	frame[1] = framing;
+	frame[2] = framing == FRAMING_FIXED || framing == FRAMING_COBS;
+	frame[SCI_CMD_AND_PAYLOAD_SIZE] = crc8(frame + 1, SCI_CMD_AND_PAYLOAD_SIZE - 1);
+	bt_enqueue(frame, sizeof(frame));
+
+	// the Accept is encoded already, everything after it goes in the new framing
+	if (frame[2])
+	{
+		switchTo(pReceiver, framing);
+	}
+}
+
+void framing_initSuperFrame(SuperFrame* pSuperFrame)
+{
+	pSuperFrame->content[0] = FRAMING_SUPER_CMD;
+	pSuperFrame->size = 0;
+	pSuperFrame->crc = 0;
+}
+
+void framing_addToSuperFrame(SuperFrame* pSuperFrame, uint8* pMessage, uint8 size)
+{
+	uint8* pContent;
+	uint8 crc;
+	uint8 i;
+
+	if (bt_framing != FRAMING_COBS || pMessage[0] > FRAMING_MAX_SUPER_MESSAGE_CMD)
+	{
+		bt_enqueue_crc(pMessage, size);
+		return;
+	}
+
+	// zeros at the end of the payload are padding, as in framing_enqueue()
+	size = trimPadding(pMessage, size);
+
+	// the message takes its header (cmd and size of its payload) and its payload
+	if (pSuperFrame->size + size > FRAMING_MAX_SUPER_SIZE)
+	{
+		framing_flushSuperFrame(pSuperFrame);
+	}
+	pContent = pSuperFrame->content + 1 + pSuperFrame->size;
+	pContent[0] = FRAMING_SUPER_MESSAGE_HEADER(pMessage[0], size - 1);
+	crc = CRC8_UPDATE(pSuperFrame->crc, pContent[0]);
+	for (i = 1; i < size; ++i)                      // the crc follows the payload as it is copied
+	{
+		pContent[i] = pMessage[i];
+		crc = CRC8_UPDATE(crc, pMessage[i]);
+	}
+	pSuperFrame->crc = crc;
+	pSuperFrame->size += size;
+}
+
+void framing_flushSuperFrame(SuperFrame* pSuperFrame)
+{
+	uint8 frame[SCI_CMD_AND_PAYLOAD_SIZE];
+	QueueRegion region;
+	uint8* pContent = pSuperFrame->content + 1;
+	uint8 pos = 0;
+	uint8 payloadSize;
+
+	if (pSuperFrame->size == 0)
+		return;
+
+	// a single message does without the overhead, fixed framing (the host fell back meanwhile) has no room
+	if (bt_framing != FRAMING_COBS || pSuperFrame->size == 1 + FRAMING_SUPER_MESSAGE_PAYLOAD_SIZE(pContent[0]))
+	{
+		while (pos < pSuperFrame->size)
+		{
+			payloadSize = FRAMING_SUPER_MESSAGE_PAYLOAD_SIZE(pContent[pos]);
+			frame[0] = FRAMING_SUPER_MESSAGE_CMD(pContent[pos]);
+			_memcpy(pContent + pos + 1, frame + 1, payloadSize);
+			bt_enqueue_crc(frame, 1 + payloadSize);
+			pos += 1 + payloadSize;
+		}
+	}
+	else
+	{
+		if (!queue_reserve(&bt_sendQueue, COBS_WIRE_SIZE(1 + pSuperFrame->size), &region))
+			FATAL_ERROR();
+
+		queue_commit(&bt_sendQueue, cobsEncode(pSuperFrame->content, 1 + pSuperFrame->size, pSuperFrame->crc, &region));
+		bt_sendQueued();
+	}
+	pSuperFrame->size = 0;
+	pSuperFrame->crc = 0;
+}
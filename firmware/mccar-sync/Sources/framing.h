@@ -0,0 +1,98 @@
+/*
+ * framing.h
+ *
+ * How frames travel on SCI1. After reset every frame takes FRAMING_FRAME_SIZE bytes, the payload padded with zeros.
+ * The host may switch both directions to COBS framing: the zeros at the end of the payload are dropped,
+ * cmd, the rest of the payload and the crc are COBS encoded, so they contain no zero byte, and a zero byte
+ * ends the frame. A Move takes 5 bytes instead of 12 then. The crc still covers the padded payload,
+ * so both framings carry the same frames.
+ *
+ * The host proposes a framing and holds back everything after it, the MC accepts and switches right after
+ * its Accept. A receiver that gets nothing but broken frames falls back to fixed framing (e.g. the host restarted).
+ *
+ * In COBS framing a frame may be longer than FRAMING_FRAME_SIZE, so the MC packs its telemetry into super-frames:
+ * FRAMING_SUPER_CMD, then per message a header byte (its cmd in the upper nibble, the size of its payload
+ * in the lower one) and the payload without padding, then a crc over everything after FRAMING_SUPER_CMD.
+ * A receiver can skip messages whose cmd it does not know. Status and Resource share the crc, code byte
+ * and delimiter then, which saves 2 bytes over two frames.
+ */
+
+#ifndef FRAMING_H_
+#define FRAMING_H_
+
+#include "platform.h"
+#include "hardware.h"
+#include "queue.h"
+
+#define FRAMING_PROPOSE_CMD         0x1A    // host -> MC: framing
+#define FRAMING_ACCEPT_CMD          0x1B    // MC -> host: framing, accepted
+#define FRAMING_SUPER_CMD           0x1C    // MC -> host, COBS framing only: several messages
+
+#define FRAMING_FIXED               0
+#define FRAMING_COBS                1
+
+#define FRAMING_FRAME_SIZE          (SCI_CMD_AND_PAYLOAD_SIZE + 1)
+#define FRAMING_MAX_WIRE_SIZE       (FRAMING_FRAME_SIZE + 2)    // code byte and delimiter
+#define FRAMING_MAX_DECODE_ERRORS   4       // broken COBS frames in a row before falling back
+
+#define FRAMING_MAX_SUPER_SIZE      24      // messages in a super-frame, Status and Resource take 21 bytes at most
+#define FRAMING_MAX_SUPER_MESSAGE_CMD   0x0f    // larger cmds do not fit the header, they are sent as frames of their own
+
+#define FRAMING_SUPER_MESSAGE_HEADER(cmd, payloadSize)  ((uint8)((cmd) << 4 | (payloadSize)))
+#define FRAMING_SUPER_MESSAGE_CMD(header)               ((uint8)((header) >> 4))
+#define FRAMING_SUPER_MESSAGE_PAYLOAD_SIZE(header)      ((uint8)((header) & 0x0f))
+
+typedef struct FrameReceiverSTRUCT
+{
+	uint8 buffer[FRAMING_MAX_WIRE_SIZE - 1];    // the frame so far, without its delimiter
+	uint8 size;
+	bool isDiscarding;                          // the frame got too long, skip to the next delimiter
+	uint8 decodeErrors;                         // in a row
+} FrameReceiver;
+
+typedef struct SuperFrameSTRUCT
+{
+	uint8 content[1 + FRAMING_MAX_SUPER_SIZE];      // FRAMING_SUPER_CMD, messages
+	uint8 size;                                     // of the messages so far
+	uint8 crc;                                      // of the messages so far
+} SuperFrame;
+
+void framing_init(FrameReceiver* pReceiver);
+
+/**
+ * encodes pFrame (FRAMING_FRAME_SIZE bytes, crc included) for the wire, straight into pQueue
+ * @returns FALSE if pQueue has no room
+ */
+bool framing_enqueue(Queue* pQueue, uint8 framing, uint8* pFrame);
+
+/**
+ * as framing_enqueue() for a message (cmd and payload), pads it and adds the crc on the way
+ */
+bool framing_enqueueMessage(Queue* pQueue, uint8 framing, uint8* pMessage, uint8 size);
+
+/**
+ * takes the next frame out of pQueue, in the framing of bt_enqueue()
+ * @param pFrame FRAMING_FRAME_SIZE bytes, the payload padded with zeros
+ * @returns FALSE if no whole frame has arrived yet
+ */
+bool framing_nextFrame(FrameReceiver* pReceiver, Queue* pQueue, uint8* pFrame);
+
+/**
+ * handles a Propose, answers in the current framing and switches right after
+ */
+void framing_handleCommand(FrameReceiver* pReceiver, uint8* pCommand);
+
+void framing_initSuperFrame(SuperFrame* pSuperFrame);
+
+/**
+ * holds back a message (cmd and payload, as for bt_enqueue_crc()) until framing_flushSuperFrame(),
+ * in fixed framing, or if its cmd exceeds FRAMING_MAX_SUPER_MESSAGE_CMD, it is sent right away
+ */
+void framing_addToSuperFrame(SuperFrame* pSuperFrame, uint8* pMessage, uint8 size);
+
+/**
+ * sends the messages held back, a single one as a frame of its own
+ */
+void framing_flushSuperFrame(SuperFrame* pSuperFrame);
+
+#endif /* FRAMING_H_ */
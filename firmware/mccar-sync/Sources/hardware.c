@@ -7,6 +7,7 @@
 
 #include "platform.h"
 #include "hardware.h"
+#include "framing.h"
 #include "queue.h"
 #include "util.h"
 
@@ -24,6 +25,8 @@ uint8 ledrightgreen = 0;
 uint8 ledrightblue = 0;
 
 uint8 bt_send_busy;
+volatile uint8 bt_receiveErrors;    // framing and noise errors, counted by isr_SCI1R()
+uint8 bt_framing;                   // FRAMING_FIXED or FRAMING_COBS, how bt_enqueue() puts frames on the wire
 
 uint16 linesensor[8];
 uint8  linepos;
@@ -32,6 +35,8 @@ uint16 voltage;
 uint16 current;
 uint16 charge_status;
 
+volatile uint16 tickcount;      // ms since startup, see isr_RTC()
+
 /**
  * Initialise clock module, ports and timer
  * @author daniw
@@ -161,6 +166,10 @@ void hardware_lowlevel_init(void)
     TPM2C0V  = TPM2C0V_INIT;
     TPM2C1V  = TPM2C1V_INIT;
 
+    //### Real time counter ###
+    RTCMOD = RTCMOD_INIT;
+    RTCSC  = RTCSC_INIT;
+
     //### Analog digital converter ###
     ADCSC1 = ADCSC1_INIT;
     ADCSC2 = ADCSC2_INIT;
@@ -277,6 +286,20 @@ Joy_ways_t getjoystick(void)
 }
 
 
+//### Time ###
+/**
+ * Milliseconds since startup, wraps after 65 s
+ * Compare ticks by their difference only, do not call from an isr
+ */
+uint16 gettickcount(void)
+{
+    uint16 ticks;
+    DisableInterrupts;      // the isr may change the high byte between the two reads
+    ticks = tickcount;
+    EnableInterrupts;
+    return ticks;
+}
+
 //### Initialize ADC conversions ###
 /**
  * Start first adc conversion
@@ -435,42 +458,23 @@ void bt_senddata(uint8* data, uint8 size)
 
 void bt_enqueue_crc(uint8* data, uint8 size)
 {
-	int i;
-
-	if (!queue_enqueue(&bt_sendQueue, data, size))
-		FATAL_ERROR();
-
-	for (i = size; i < SCI_CMD_AND_PAYLOAD_SIZE; i++)
-	{
-		if (!queue_enqueueByte(&bt_sendQueue, 0x00)) //padding (zeroes)
-			FATAL_ERROR();
-	}
-	if (!queue_enqueueByte(&bt_sendQueue, 0x00)) //checksum
+	if (!framing_enqueueMessage(&bt_sendQueue, bt_framing, data, size))
 		FATAL_ERROR();
-
-	if (!bt_send_busy)								// restart sci if stopped
-	{
-		if (queue_getUsedSpace(&bt_sendQueue) > 0)
-		{
-			bt_send_busy = TRUE;
-			SCI1C2_TCIE = 1;
-		}
-	}
+	bt_sendQueued();
 }
 
 void bt_enqueue(uint8* data, uint8 size)
 {
-	int i;
+	uint8 frame[FRAMING_FRAME_SIZE] = { 0 };        // padding and checksum (zeroes)
 
-	if (!queue_enqueue(&bt_sendQueue, data, size))
+	_memcpy(data, frame, size);
+	if (!framing_enqueue(&bt_sendQueue, bt_framing, frame))
 		FATAL_ERROR();
+	bt_sendQueued();
+}
 
-	for (i = size; i < SCI_CMD_AND_PAYLOAD_SIZE; i++)
-	{
-		if (!queue_enqueueByte(&bt_sendQueue, 0x00)) //padding (zeroes)
-			FATAL_ERROR();
-	}
-
+void bt_sendQueued(void)
+{
 	if (!bt_send_busy)								// restart sci if stopped
 	{
 		if (queue_getUsedSpace(&bt_sendQueue) > 0)
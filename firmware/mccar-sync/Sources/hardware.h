@@ -260,6 +260,13 @@ D: High drive strength enabled (PTxDS)
 #define TPM2C1V_INIT    (0)
 
 
+//### Real time counter ###
+// 1 kHz low power oscillator, no prescaler, interrupt enabled
+#define RTCSC_INIT      (RTCSC_RTIE_MASK | RTCSC_RTCPS3_MASK)
+// Interrupt every ms, counted in tickcount
+#define RTCMOD_INIT     (0)
+
+
 //### Analog digital converter ###
 //--- Single conversion, interrupt enabled, module disabled as no channel selected ---
 #define ADCSC1_INIT     (ADCSC1_AIEN_MASK | ADCSC1_ADCH_MASK)
@@ -378,5 +385,7 @@ void bt_sendbyte(uint8 data);
 void bt_senddata(uint8* data, uint8 size);
 void bt_enqueue_crc(uint8* data, uint8 size);
 void bt_enqueue(uint8* data, uint8 size);
+void bt_sendQueued(void);                           // restarts the sci for what was written to bt_sendQueue
+uint16 gettickcount(void);
 
 #endif /* HARDWARE_H_ */
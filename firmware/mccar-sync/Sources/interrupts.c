@@ -20,6 +20,7 @@ extern uint8 driveval;
 extern Queue bt_sendQueue;
 extern Queue bt_receiveQueue;
 extern uint8 bt_send_busy;
+extern volatile uint8 bt_receiveErrors;
 
 extern uint8 ledleftred;
 extern uint8 ledleftgreen;
@@ -33,9 +34,15 @@ extern uint16 voltage;
 extern uint16 current;
 extern uint16 charge_status;
 
+extern volatile uint16 tickcount;
+
+/**
+ * RTC interrupt service routine, counts the ms for gettickcount()
+ */
 interrupt void isr_RTC(void)        // RTC
 {
-    return;
+    RTCSC_RTIF = 1;                 // clear the flag
+    ++tickcount;
 }
 
 interrupt void isr_IIC(void)        // IIC
@@ -293,6 +300,10 @@ interrupt void isr_SCI1T(void)      // SCI1 transmit
 interrupt void isr_SCI1R(void)      // SCI1 receive
 {
 	uint8 temp;
+	if (SCI1S1_FE || SCI1S1_NF)     // cleared by reading SCI1D below
+	{
+		++bt_receiveErrors;
+	}
 	if (SCI1S1_RDRF)
 	{
 		queue_enqueueByte(&bt_receiveQueue, SCI1D);
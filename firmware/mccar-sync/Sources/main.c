@@ -46,6 +46,10 @@ extern uint8 ledrightgreen;
 extern uint8 ledrightblue;
 
 extern SwappableMemoryPool swappableMemoryPool;
+extern ReliableLink reliableLink;
+extern BaudNegotiation baudNegotiation;
+extern FrameReceiver frameReceiver;
+extern SuperFrame telemetry;
 
 Pid motorPid[2];
 
@@ -63,7 +67,11 @@ void init()
     malloc_init();
     queue_init(&bt_sendQueue);
     queue_init(&bt_receiveQueue);
+    framing_init(&frameReceiver);       // fixed framing until the host proposes COBS, see framing.h
+    framing_initSuperFrame(&telemetry);
     swappableMemoryPool_init(&swappableMemoryPool, malloc_getPagePool(), &bt_enqueue_crc);
+    reliableLink_init(&reliableLink, &bt_enqueue, &handleReliableCommand);
+    swappableMemoryPool_setReliableLink(&swappableMemoryPool, &reliableLink);
 
     hardware_lowlevel_init();
     EnableInterrupts;               // Interrupts aktivieren
@@ -88,7 +96,8 @@ void init()
         for (i = 0; i < 10000; i++);
         bt_cmdoff();
     #endif
-    bt_scibaud(BT_PRESCALER_115200);
+    bt_scibaud(BT_PRESCALER_115200);    // the host may negotiate a faster rate, see baudNegotiation.h
+    baudNegotiation_init(&baudNegotiation);
     
     pid_init(&motorPid[0]);
     pid_init(&motorPid[1]);
@@ -101,14 +110,7 @@ void main(void)
 {
     init();
 
-	scheduler_init(&scheduler);
-
-    //scheduler_scheduleTask(&scheduler, taskIrSensor, NULL);
-    scheduler_scheduleTask(&scheduler, taskControlMotors, NULL);
-    scheduler_scheduleTask(&scheduler, taskSciReceive, NULL);
-    scheduler_scheduleTask(&scheduler, taskSendRessource, NULL);
-    scheduler_scheduleTask(&scheduler, taskSendStatus, NULL);
-    scheduler_scheduleTask(&scheduler, taskCalcLine, NULL);
+	scheduler_init(&scheduler, periodicTasks, PERIODIC_TASK_COUNT);     // the tasks and their periods, see task.c
 
     startadc();			// Schould not be started before scheduler is set up
 
@@ -43,8 +43,8 @@ uint16 var1(uint16* x, uint8 size)
 uint16 var2(uint16* x, uint8 size, uint8 expv)
 {
 	uint8 i;
-	uint32 z;
-	uint16 n;
+	uint32 z = 0;
+	uint16 n = 0;
 	for (i = 0; i < size; i++)
 	{
 		z += ((i << STATSHIFT) - expv)*(i - expv)*(x[i]);
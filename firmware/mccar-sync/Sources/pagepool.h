@@ -15,7 +15,7 @@
 
 typedef char Page[PAGE_SIZE];
 
-typedef struct
+typedef struct PagePoolSTRUCT
 {
 	uint8 amountOfOccupiedPagesAhead[PAGE_POOL_SIZE];
 	Page pages[PAGE_POOL_SIZE];
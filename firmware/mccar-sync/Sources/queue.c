@@ -10,18 +10,26 @@
 #include "malloc.h"
 #include "util.h"
 
+static void getRegion(Queue* pQueue, uint8 pos, uint8 size, QueueRegion* pRegion)
+{
+	uint16 untilWrap = sizeof(pQueue->buffer) - pos;
+
+	pRegion->pFirst = pQueue->buffer + pos;
+	pRegion->firstSize = size < untilWrap ? size : (uint8)untilWrap;
+	pRegion->pSecond = pQueue->buffer;
+	pRegion->secondSize = size - pRegion->firstSize;
+}
+
 void queue_init(Queue* pQueue)
 {
 	(void)_memset(pQueue->buffer, 0, 256);
+	pQueue->readPos = 0;
+	pQueue->writePos = 0;
 }
 
 uint8 queue_getFreeSpace(Queue* pQueue)
 {
-	uint8 spaceInBuffer = (uint8)(pQueue->readPos - pQueue->writePos);
-	if (spaceInBuffer == 0)
-		return -1; //max uint8
-	else
-		return spaceInBuffer;
+	return QUEUE_CAPACITY - queue_getUsedSpace(pQueue);
 }
 
 uint8 queue_getUsedSpace(Queue* pQueue)
@@ -30,47 +38,77 @@ uint8 queue_getUsedSpace(Queue* pQueue)
 	return usedSpace;
 }
 
+bool queue_reserve(Queue* pQueue, uint8 size, QueueRegion* pRegion)
+{
+	if (queue_getFreeSpace(pQueue) < size)
+		return FALSE;
+
+	getRegion(pQueue, pQueue->writePos, size, pRegion);
+	return TRUE;
+}
+
+void queue_commit(Queue* pQueue, uint8 size)
+{
+	pQueue->writePos += size;
+}
+
+bool queue_peek(Queue* pQueue, uint8 size, QueueRegion* pRegion)
+{
+	if (queue_getUsedSpace(pQueue) < size)
+		return FALSE;
+
+	getRegion(pQueue, pQueue->readPos, size, pRegion);
+	return TRUE;
+}
+
+void queue_consume(Queue* pQueue, uint8 size)
+{
+	pQueue->readPos += size;
+}
+
 bool queue_enqueue(Queue* pQueue, uint8* data, uint8 size)
 {
-	if (queue_getFreeSpace(pQueue) >= size)
-	{
-		int i;
-		for (i = 0; i < size; i++)
-		{
-			pQueue->buffer[pQueue->writePos] = *(data++);
-			++pQueue->writePos;
-		}
-
-		return TRUE;
-	}
-	return FALSE;
+	QueueRegion region;
+
+	if (!queue_reserve(pQueue, size, &region))
+		return FALSE;
+
+	_memcpy(data, region.pFirst, region.firstSize);
+	_memcpy(data + region.firstSize, region.pSecond, region.secondSize);
+	queue_commit(pQueue, size);
+	return TRUE;
 }
 
 bool queue_enqueueByte(Queue* pQueue, uint8 data)
 {
-	return queue_enqueue(pQueue, &data, 1);
+	if (queue_getUsedSpace(pQueue) == QUEUE_CAPACITY)
+		return FALSE;
+
+	pQueue->buffer[pQueue->writePos] = data;
+	++pQueue->writePos;
+	return TRUE;
 }
 
 bool queue_dequeue(Queue* pQueue, uint8* data, uint8 size)
 {
-	if (queue_getUsedSpace(pQueue) >= size)
-	{
-		int i;
-		for (i = 0; i < size; i++)
-		{
-			*(data++) = pQueue->buffer[pQueue->readPos];
-			++pQueue->readPos;
-		}
-		return TRUE;
-	}
-	return FALSE;
+	QueueRegion region;
+
+	if (!queue_peek(pQueue, size, &region))
+		return FALSE;
+
+	_memcpy(region.pFirst, data, region.firstSize);
+	_memcpy(region.pSecond, data + region.firstSize, region.secondSize);
+	queue_consume(pQueue, size);
+	return TRUE;
 }
 
 uint8 queue_dequeueByte(Queue* pQueue)
 {
 	uint8 value;
-	if (!queue_dequeue(pQueue, &value, 1))
+	if (pQueue->readPos == pQueue->writePos)
 		FATAL_ERROR();
-	
+
+	value = pQueue->buffer[pQueue->readPos];
+	++pQueue->readPos;
 	return value;
 }
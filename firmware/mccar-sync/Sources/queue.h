@@ -10,6 +10,12 @@
 
 #include "platform.h"
 
+#define QUEUE_CAPACITY      255     // one byte stays free, a full buffer would look empty
+
+/**
+ * Ring buffer between an ISR and a task: one side only moves writePos, the other only readPos,
+ * each with a single store, so the data is in place before the other side sees it.
+ */
 typedef struct
 {
 	uint8 buffer[256];
@@ -17,11 +23,49 @@ typedef struct
 	uint8 writePos;
 } Queue;
 
+/**
+ * Bytes of the ring in place, split in two where they wrap around the end of the buffer
+ */
+typedef struct QueueRegionSTRUCT
+{
+	uint8* pFirst;
+	uint8 firstSize;
+	uint8* pSecond;                 // the start of the buffer, secondSize is 0 if the region does not wrap
+	uint8 secondSize;
+} QueueRegion;
+
+/**
+ * byte i of a region, to read or write
+ */
+#define QUEUE_REGION_AT(pRegion, i) (*((i) < (pRegion)->firstSize ? (pRegion)->pFirst + (i) : (pRegion)->pSecond + ((i) - (pRegion)->firstSize)))
+
 void queue_init(Queue* pQueue);
 
 uint8 queue_getFreeSpace(Queue* pQueue);
 uint8 queue_getUsedSpace(Queue* pQueue);
 
+/**
+ * the writing side: size bytes behind the queued ones to be written in place
+ * @returns FALSE if there is not enough free space
+ */
+bool queue_reserve(Queue* pQueue, uint8 size, QueueRegion* pRegion);
+
+/**
+ * hands the first size bytes of the region reserved last to the reading side
+ */
+void queue_commit(Queue* pQueue, uint8 size);
+
+/**
+ * the reading side: the first size queued bytes to be read in place, they stay queued until queue_consume()
+ * @returns FALSE if fewer bytes are queued
+ */
+bool queue_peek(Queue* pQueue, uint8 size, QueueRegion* pRegion);
+
+/**
+ * removes size bytes from the front
+ */
+void queue_consume(Queue* pQueue, uint8 size);
+
 bool queue_enqueue(Queue* pQueue, uint8* data, uint8 size);
 bool queue_enqueueByte(Queue* pQueue, uint8 data);
 
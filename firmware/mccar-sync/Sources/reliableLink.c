@@ -0,0 +1,320 @@
+/*
+ * reliableLink.c
+ */
+
+#include "reliableLink.h"
+#include "hardware.h"
+#include "util.h"
+
+#define FRAME_SIZE (SCI_CMD_AND_PAYLOAD_SIZE + 1)
+
+static void sendAck(ReliableLink* pLink, uint8 flags, uint8 nextSeq)
+{
+	uint8 frame[FRAME_SIZE] = { 0 };
+	uint8 i;
+
+	frame[0] = RELIABLE_ACK_CMD;
+	frame[1] = flags;
+	frame[2] = nextSeq;
+	if (flags == 0)
+	{
+		// bit i: nextSeq + 1 + i is buffered
+		for (i = 0; i < RELIABLE_WINDOW_SIZE - 1; ++i)
+		{
+			if (pLink->receivedMask & (1 << ((uint8)(nextSeq + 1 + i) % RELIABLE_WINDOW_SIZE)))
+			{
+				frame[3] |= 1 << i;
+			}
+		}
+	}
+	frame[FRAME_SIZE - 1] = crc8(frame + 1, SCI_CMD_AND_PAYLOAD_SIZE - 1);
+	pLink->fnWriteBuf(frame, FRAME_SIZE);
+}
+
+static void transmit(ReliableLink* pLink, uint8 seq, uint16 now)
+{
+	ReliableSendSlot* pSlot = &pLink->sendSlots[seq % RELIABLE_SEND_BUFFER_SIZE];
+	uint8 frame[FRAME_SIZE];
+
+	frame[0] = RELIABLE_CMD;
+	frame[1] = seq;
+	_memcpy(pSlot->command, frame + 2, 1 + RELIABLE_DATA_SIZE);
+	frame[FRAME_SIZE - 1] = crc8(frame + 1, SCI_CMD_AND_PAYLOAD_SIZE - 1);
+	pLink->fnWriteBuf(frame, FRAME_SIZE);
+
+	if (pSlot->transmissions < 0xff)
+	{
+		++pSlot->transmissions;
+	}
+	if (pSlot->transmissions > 1)
+	{
+		++pLink->retransmissions;
+	}
+	pSlot->sentAt = now;
+}
+
+static void startSync(ReliableLink* pLink, uint16 now)
+{
+	pLink->senderState = RELIABLE_SYNCING;
+	pLink->syncSentAt = now;
+	sendAck(pLink, RELIABLE_ACK_SYNC, pLink->sendBase);
+}
+
+static void updateRto(ReliableLink* pLink, uint16 roundTrip)
+{
+	int16 delta;
+
+	if (roundTrip > RELIABLE_MAX_RTO)
+	{
+		roundTrip = RELIABLE_MAX_RTO;
+	}
+
+	if (pLink->srtt == 0)
+	{
+		pLink->srtt = roundTrip * 8;
+		pLink->rttvar = roundTrip * 2;
+	}
+	else
+	{
+		// srtt = 7/8 srtt + 1/8 r, rttvar = 3/4 rttvar + 1/4 |srtt - r|, both kept scaled
+		delta = (int16)roundTrip - (int16)(pLink->srtt / 8);
+		pLink->srtt += delta;
+		pLink->rttvar += (delta < 0 ? -delta : delta) - pLink->rttvar / 4;
+	}
+
+	pLink->rto = pLink->srtt / 8 + (pLink->rttvar > 1 ? pLink->rttvar : 1);
+	if (pLink->rto < RELIABLE_MIN_RTO)
+	{
+		pLink->rto = RELIABLE_MIN_RTO;
+	}
+	if (pLink->rto > RELIABLE_MAX_RTO)
+	{
+		pLink->rto = RELIABLE_MAX_RTO;
+	}
+}
+
+static void acknowledge(ReliableLink* pLink, ReliableSendSlot* pSlot, uint16 now)
+{
+	if (pSlot->isAcked)
+		return;
+
+	pSlot->isAcked = TRUE;
+	if (pSlot->transmissions == 1) // the round trip of a retransmitted frame is ambiguous
+	{
+		updateRto(pLink, now - pSlot->sentAt);
+	}
+}
+
+static void handleAck(ReliableLink* pLink, uint8* pFrame, uint16 now)
+{
+	uint8 flags = pFrame[1];
+	uint8 nextSeq = pFrame[2];
+	uint8 selectiveAcks = pFrame[3];
+	uint8 inFlight = pLink->sendNext - pLink->sendBase;
+	uint8 lastAcked;
+	uint8 seq;
+	uint8 i;
+
+	if (flags & RELIABLE_ACK_SYNC)
+	{
+		// the peer's sender starts over, whatever was buffered belongs to its previous run
+		pLink->isReceiverSynchronized = TRUE;
+		pLink->receiveBase = nextSeq;
+		pLink->receivedMask = 0;
+		sendAck(pLink, RELIABLE_ACK_SYNC_ACK, nextSeq);
+		return;
+	}
+
+	if (flags & RELIABLE_ACK_SYNC_ACK)
+	{
+		if (pLink->senderState == RELIABLE_SYNCING && nextSeq == pLink->sendBase)
+		{
+			// the receiver lost everything not acknowledged, all of it goes out again
+			for (seq = pLink->sendBase; seq != pLink->sendNext; ++seq)
+			{
+				pLink->sendSlots[seq % RELIABLE_SEND_BUFFER_SIZE].transmissions = 0;
+				pLink->sendSlots[seq % RELIABLE_SEND_BUFFER_SIZE].isAcked = FALSE;
+			}
+			pLink->senderState = RELIABLE_SYNCHRONIZED;
+		}
+		return;
+	}
+
+	if (flags & RELIABLE_ACK_RESYNC)
+	{
+		if (pLink->senderState == RELIABLE_SYNCHRONIZED)
+		{
+			startSync(pLink, now);
+		}
+		return;
+	}
+
+	if (pLink->senderState != RELIABLE_SYNCHRONIZED)
+		return;
+
+	// everything before nextSeq has arrived
+	if ((uint8)(nextSeq - pLink->sendBase) <= inFlight)
+	{
+		while (pLink->sendBase != nextSeq)
+		{
+			acknowledge(pLink, &pLink->sendSlots[pLink->sendBase % RELIABLE_SEND_BUFFER_SIZE], now);
+			++pLink->sendBase;
+		}
+	}
+
+	// and the frames after it marked in the bitmap
+	inFlight = pLink->sendNext - pLink->sendBase;
+	lastAcked = pLink->sendBase;
+	for (i = 0; i < RELIABLE_WINDOW_SIZE - 1; ++i)
+	{
+		seq = nextSeq + 1 + i;
+		if ((selectiveAcks & (1 << i)) && (uint8)(seq - pLink->sendBase) < inFlight)
+		{
+			acknowledge(pLink, &pLink->sendSlots[seq % RELIABLE_SEND_BUFFER_SIZE], now);
+			lastAcked = seq;
+		}
+	}
+
+	// a frame missing before one that arrived is probably lost, unless it was sent less than a round trip ago
+	for (seq = pLink->sendBase; seq != lastAcked; ++seq)
+	{
+		ReliableSendSlot* pSlot = &pLink->sendSlots[seq % RELIABLE_SEND_BUFFER_SIZE];
+		if (!pSlot->isAcked && pSlot->transmissions > 0 && (uint16)(now - pSlot->sentAt) >= pLink->srtt / 8)
+		{
+			transmit(pLink, seq, now);
+		}
+	}
+}
+
+static void handleData(ReliableLink* pLink, uint8* pFrame)
+{
+	uint8 seq = pFrame[1];
+	uint8 command[SCI_CMD_AND_PAYLOAD_SIZE + 1];
+
+	if (!pLink->isReceiverSynchronized)
+	{
+		sendAck(pLink, RELIABLE_ACK_RESYNC, 0);
+		return;
+	}
+
+	// a duplicate or beyond the window is acknowledged again only, so the sender learns what arrived
+	pLink->isAckPending = TRUE;
+	if ((uint8)(seq - pLink->receiveBase) >= RELIABLE_WINDOW_SIZE)
+		return;
+
+	if (!(pLink->receivedMask & (1 << (seq % RELIABLE_WINDOW_SIZE))))
+	{
+		_memcpy(pFrame + 2, pLink->received[seq % RELIABLE_WINDOW_SIZE], 1 + RELIABLE_DATA_SIZE);
+		pLink->receivedMask |= 1 << (seq % RELIABLE_WINDOW_SIZE);
+	}
+
+	// deliver in sequence, the handlers may send reliably themselves
+	_memset(command, 0, sizeof(command));
+	while (pLink->receivedMask & (1 << (pLink->receiveBase % RELIABLE_WINDOW_SIZE)))
+	{
+		_memcpy(pLink->received[pLink->receiveBase % RELIABLE_WINDOW_SIZE], command, 1 + RELIABLE_DATA_SIZE);
+		pLink->receivedMask &= ~(1 << (pLink->receiveBase % RELIABLE_WINDOW_SIZE));
+		++pLink->receiveBase;
+		pLink->fnDeliver(command);
+	}
+}
+
+void reliableLink_init(ReliableLink* pLink, callback_writeBuf fnWriteBuf, callback_deliverCommand fnDeliver)
+{
+	_memset(pLink, 0, sizeof(ReliableLink));
+	pLink->fnWriteBuf = fnWriteBuf;
+	pLink->fnDeliver = fnDeliver;
+	pLink->senderState = RELIABLE_UNSYNCHRONIZED;
+	pLink->rto = RELIABLE_INITIAL_RTO;
+}
+
+bool reliableLink_send(ReliableLink* pLink, uint8* pCommand, uint8 size, uint16 now)
+{
+	ReliableSendSlot* pSlot;
+
+	if (reliableLink_getFreeSlots(pLink) == 0 || size > 1 + RELIABLE_DATA_SIZE)
+		return FALSE;
+
+	pSlot = &pLink->sendSlots[pLink->sendNext % RELIABLE_SEND_BUFFER_SIZE];
+	_memset(pSlot->command, 0, sizeof(pSlot->command));
+	_memcpy(pCommand, pSlot->command, size);
+	pSlot->transmissions = 0;
+	pSlot->isAcked = FALSE;
+	++pLink->sendNext;
+
+	if (pLink->senderState == RELIABLE_UNSYNCHRONIZED)
+	{
+		startSync(pLink, now);
+	}
+	else if (pLink->senderState == RELIABLE_SYNCHRONIZED && (uint8)(pLink->sendNext - 1 - pLink->sendBase) < RELIABLE_WINDOW_SIZE)
+	{
+		transmit(pLink, pLink->sendNext - 1, now);
+	}
+	return TRUE;
+}
+
+uint8 reliableLink_getFreeSlots(ReliableLink* pLink)
+{
+	return RELIABLE_SEND_BUFFER_SIZE - (uint8)(pLink->sendNext - pLink->sendBase);
+}
+
+void reliableLink_receive(ReliableLink* pLink, uint8* pFrame, uint16 now)
+{
+	if (crc8(pFrame + 1, SCI_CMD_AND_PAYLOAD_SIZE - 1) != pFrame[SCI_CMD_AND_PAYLOAD_SIZE])
+	{
+		++pLink->checksumFailures;
+		return;
+	}
+
+	if (pFrame[0] == RELIABLE_ACK_CMD)
+	{
+		handleAck(pLink, pFrame, now);
+	}
+	else
+	{
+		handleData(pLink, pFrame);
+	}
+}
+
+void reliableLink_poll(ReliableLink* pLink, uint16 now)
+{
+	uint8 seq;
+	bool hasTimedOut = FALSE;
+
+	if (pLink->senderState == RELIABLE_SYNCING && (uint16)(now - pLink->syncSentAt) >= pLink->rto)
+	{
+		pLink->rto = pLink->rto < RELIABLE_MAX_RTO / 2 ? pLink->rto * 2 : RELIABLE_MAX_RTO;
+		startSync(pLink, now);
+	}
+	else if (pLink->senderState == RELIABLE_SYNCHRONIZED)
+	{
+		for (seq = pLink->sendBase; seq != pLink->sendNext && (uint8)(seq - pLink->sendBase) < RELIABLE_WINDOW_SIZE; ++seq)
+		{
+			ReliableSendSlot* pSlot = &pLink->sendSlots[seq % RELIABLE_SEND_BUFFER_SIZE];
+			if (pSlot->isAcked)
+				continue;
+
+			if (pSlot->transmissions == 0)
+			{
+				transmit(pLink, seq, now);
+			}
+			else if ((uint16)(now - pSlot->sentAt) >= pLink->rto)
+			{
+				hasTimedOut = TRUE;
+				transmit(pLink, seq, now);
+			}
+		}
+
+		// back off once per poll, not per frame
+		if (hasTimedOut)
+		{
+			pLink->rto = pLink->rto < RELIABLE_MAX_RTO / 2 ? pLink->rto * 2 : RELIABLE_MAX_RTO;
+		}
+	}
+
+	if (pLink->isAckPending)
+	{
+		pLink->isAckPending = FALSE;
+		sendAck(pLink, 0, pLink->receiveBase);
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * reliableLink.h
+ *
+ * Selective-repeat ARQ for the commands that must not get lost on the link (swap data, ConfigPID),
+ * everything else stays best effort.
+ *
+ * A reliable frame carries a sequence number, the command and up to RELIABLE_DATA_SIZE bytes of its payload.
+ * The receiver keeps frames arriving out of order, delivers them in sequence and answers with an Ack that
+ * acknowledges everything before nextSeq and, in a bitmap, the frames after it that have arrived.
+ * The sender retransmits a frame when its timeout expires or when an Ack shows that later frames arrived without it.
+ * The timeout follows the measured round trip time (RFC 6298, only frames sent once are measured).
+ *
+ * Before its first frame, a sender announces its sequence number with a sync the receiver has to acknowledge.
+ * A receiver that got no sync asks for one, so either side may restart at any time.
+ */
+
+#ifndef RELIABLELINK_H_
+#define RELIABLELINK_H_
+
+#include "platform.h"
+#include "swappableMemory.h"
+
+#define RELIABLE_CMD                0x12
+#define RELIABLE_ACK_CMD            0x13
+
+#define RELIABLE_DATA_SIZE          8       // payload bytes of a command sent reliably
+#define RELIABLE_WINDOW_SIZE        8       // frames in flight, and frames a receiver keeps out of order
+#define RELIABLE_SEND_BUFFER_SIZE   16      // commands queued, including those in flight
+
+#define RELIABLE_INITIAL_RTO        500     // ms
+#define RELIABLE_MIN_RTO            50
+#define RELIABLE_MAX_RTO            4000
+
+//--- flags of an Ack ---
+#define RELIABLE_ACK_SYNC           0x01    // the sender starts over at nextSeq
+#define RELIABLE_ACK_SYNC_ACK       0x02    // answers the sync for nextSeq
+#define RELIABLE_ACK_RESYNC         0x04    // the receiver got no sync, the sender has to send one
+
+typedef void(*callback_deliverCommand)(uint8* pCommand);
+
+typedef enum ReliableSenderState_
+{
+	RELIABLE_UNSYNCHRONIZED,
+	RELIABLE_SYNCING,
+	RELIABLE_SYNCHRONIZED
+} ReliableSenderState_t;
+
+typedef struct
+{
+	uint8 command[1 + RELIABLE_DATA_SIZE];
+	uint16 sentAt;              // tick of the last transmission
+	uint8 transmissions;        // 0 if not sent yet
+	bool isAcked;
+} ReliableSendSlot;
+
+typedef struct ReliableLinkSTRUCT
+{
+	callback_writeBuf fnWriteBuf;           // gets whole frames, including the crc
+	callback_deliverCommand fnDeliver;
+
+	//--- sender ---
+	ReliableSendSlot sendSlots[RELIABLE_SEND_BUFFER_SIZE];  // indexed by seq % RELIABLE_SEND_BUFFER_SIZE
+	uint8 sendBase;                         // oldest seq not acknowledged
+	uint8 sendNext;                         // seq of the next command queued
+	ReliableSenderState_t senderState;
+	uint16 syncSentAt;
+	uint16 srtt;                            // smoothed round trip time in ms * 8
+	uint16 rttvar;                          // its variation in ms * 4
+	uint16 rto;                             // ms
+
+	//--- receiver ---
+	bool isReceiverSynchronized;
+	uint8 receiveBase;                      // next seq to deliver
+	uint8 receivedMask;                     // bit seq % RELIABLE_WINDOW_SIZE is set if that frame is buffered
+	uint8 received[RELIABLE_WINDOW_SIZE][1 + RELIABLE_DATA_SIZE];
+	bool isAckPending;
+
+	uint16 retransmissions;
+	uint16 checksumFailures;
+} ReliableLink;
+
+void reliableLink_init(ReliableLink* pLink, callback_writeBuf fnWriteBuf, callback_deliverCommand fnDeliver);
+
+/**
+ * queues pCommand (cmd and payload) for reliable transmission
+ * @param size at most 1 + RELIABLE_DATA_SIZE
+ * @returns FALSE if the send buffer is full
+ */
+bool reliableLink_send(ReliableLink* pLink, uint8* pCommand, uint8 size, uint16 now);
+uint8 reliableLink_getFreeSlots(ReliableLink* pLink);
+
+/**
+ * handles a received reliable frame or Ack, pFrame points to all SCI_CMD_AND_PAYLOAD_SIZE + 1 bytes of it
+ */
+void reliableLink_receive(ReliableLink* pLink, uint8* pFrame, uint16 now);
+
+/**
+ * sends what is due: new frames the window allows, retransmissions, syncs and the Ack of received frames
+ */
+void reliableLink_poll(ReliableLink* pLink, uint16 now);
+
+#endif /* RELIABLELINK_H_ */
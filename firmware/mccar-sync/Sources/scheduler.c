@@ -6,39 +6,193 @@
  */
 
 #include "scheduler.h"
+#include "hardware.h"
 #include "util.h"
-#include "malloc.h"
 
-#define MAX_NUM_TASKS 20
+static void startPass(Scheduler* pScheduler)
+{
+	uint8 priority;
+
+	pScheduler->priority = 0;
+	pScheduler->nextPeriodicTask = 0;
+	pScheduler->passTick = gettickcount();
+	for (priority = 0; priority < TASK_PRIORITY_COUNT; ++priority)
+	{
+		pScheduler->oneShotTasksLeft[priority] = taskqueue_getLevelUsedSpace(&pScheduler->taskQueue, priority);
+	}
+	if (pScheduler->oneShotTasksLeft[TASK_PRIORITY_BACKGROUND] > SCHEDULER_BACKGROUND_TASKS_PER_PASS)
+	{
+		pScheduler->oneShotTasksLeft[TASK_PRIORITY_BACKGROUND] = SCHEDULER_BACKGROUND_TASKS_PER_PASS;
+	}
+}
 
-void scheduler_init(Scheduler* pScheduler)
+static void countWait(Scheduler* pScheduler, uint8 priority, uint16 since)
 {
-	taskqueue_init(&pScheduler->taskQueue);
+	uint16 wait = gettickcount() - since;
+
+	if (wait > 255)
+	{
+		wait = 255;
+	}
+	if (wait > pScheduler->maxWait[priority])
+	{
+		pScheduler->maxWait[priority] = (uint8)wait;
+	}
 }
 
-void scheduler_execute(Scheduler* pScheduler)
+/**
+ * @returns TRUE if the task is due in this pass, its next run is due a period later then
+ */
+static bool isDue(Scheduler* pScheduler, PeriodicTask* pTask)
 {
-	for (;;)
+	uint16 now = pScheduler->passTick;
+
+	if (pTask->period == 0)
+	{
+		countWait(pScheduler, pTask->priority, pTask->due);
+		pTask->due = now;
+		return TRUE;
+	}
+	if ((int16)(now - pTask->due) < 0)
+		return FALSE;
+
+	countWait(pScheduler, pTask->priority, pTask->due);
+
+	// a late run does not make the next one earlier, runs missed under load are dropped
+	pTask->due += pTask->period;
+	if ((int16)(now - pTask->due) >= 0)
+	{
+		pTask->due = now + pTask->period;
+	}
+	return TRUE;
+}
+
+/**
+ * after a task of the priority, the one-shot tasks scheduled meanwhile for higher priorities run before the pass
+ * goes on, those they schedule for their own priority wait for the next task of a lower one
+ */
+static void preempt(Scheduler* pScheduler, uint8 priority)
+{
+	uint8 higher;
+
+	for (higher = TASK_PRIORITY_CONTROL; higher < priority; ++higher)
 	{
-		Task* pTask = taskqueue_dequeue(&pScheduler->taskQueue);
-		if (pTask)
+		pScheduler->oneShotTasksLeft[higher] = taskqueue_getLevelUsedSpace(&pScheduler->taskQueue, higher);
+	}
+}
+
+static bool runNextPeriodicTask(Scheduler* pScheduler)
+{
+	PeriodicTask* pTask;
+
+	while (pScheduler->nextPeriodicTask < pScheduler->periodicTaskCount)
+	{
+		pTask = &pScheduler->pPeriodicTasks[pScheduler->nextPeriodicTask++];
+		if (pTask->priority == pScheduler->priority && isDue(pScheduler, pTask))
 		{
 			pTask->execute(pTask->pData);
-			_free(pTask);
+			preempt(pScheduler, pTask->priority);
+			return TRUE;
 		}
 	}
+	return FALSE;
 }
 
-void scheduler_scheduleTask(Scheduler* pScheduler, void (*fnExecute)(void* pData), void* pData)
+static bool runNextOneShotTask(Scheduler* pScheduler, uint8 priority)
+{
+	Task* pTask;
+	Task task;
+
+	if (pScheduler->oneShotTasksLeft[priority] == 0)
+		return FALSE;
+
+	--pScheduler->oneShotTasksLeft[priority];
+	pTask = taskqueue_dequeue(&pScheduler->taskQueue, priority);
+	if (!pTask)
+		FATAL_ERROR();
+
+	// the slot is free before the task runs, it may schedule the next one
+	task = *pTask;
+	pScheduler->freeOneShotTasks[pScheduler->freeOneShotTaskCount++] = pTask;
+	countWait(pScheduler, task.priority, task.scheduledAt);
+	task.execute(task.pData);
+	preempt(pScheduler, priority);
+	return TRUE;
+}
+
+void scheduler_init(Scheduler* pScheduler, PeriodicTask* pPeriodicTasks, uint8 periodicTaskCount)
+{
+	uint16 now = gettickcount();
+	uint8 i;
+
+	pScheduler->pPeriodicTasks = pPeriodicTasks;
+	pScheduler->periodicTaskCount = periodicTaskCount;
+	for (i = 0; i < periodicTaskCount; ++i)
+	{
+		pPeriodicTasks[i].due = now + pPeriodicTasks[i].offset;
+	}
+
+	taskqueue_init(&pScheduler->taskQueue);
+	for (i = 0; i < SCHEDULER_MAX_ONE_SHOT_TASKS; ++i)
+	{
+		pScheduler->freeOneShotTasks[i] = &pScheduler->oneShotTasks[i];
+	}
+	pScheduler->freeOneShotTaskCount = SCHEDULER_MAX_ONE_SHOT_TASKS;
+	(void)_memset(pScheduler->maxWait, 0, sizeof(pScheduler->maxWait));
+
+	startPass(pScheduler);
+}
+
+void scheduler_execute(Scheduler* pScheduler)
+{
+	for (;;)
+	{
+		(void)scheduler_executeNext(pScheduler);
+	}
+}
+
+bool scheduler_executeNext(Scheduler* pScheduler)
+{
+	uint8 priority;
+
+	for (priority = TASK_PRIORITY_CONTROL; priority < pScheduler->priority; ++priority)
+	{
+		if (runNextOneShotTask(pScheduler, priority))
+			return TRUE;
+	}
+
+	while (pScheduler->priority < TASK_PRIORITY_COUNT)
+	{
+		if (runNextPeriodicTask(pScheduler) || runNextOneShotTask(pScheduler, pScheduler->priority))
+			return TRUE;
+
+		++pScheduler->priority;
+		pScheduler->nextPeriodicTask = 0;
+	}
+
+	startPass(pScheduler);
+	return FALSE;
+}
+
+void scheduler_scheduleTask(Scheduler* pScheduler, void (*fnExecute)(void* pData), void* pData, uint8 priority)
 {
 	Task* pNewTask;
-	pNewTask = _malloc(sizeof(Task));
-	if (!pNewTask)
+	if (pScheduler->freeOneShotTaskCount == 0)
 		FATAL_ERROR();
-	
+
+	pNewTask = pScheduler->freeOneShotTasks[--pScheduler->freeOneShotTaskCount];
 	pNewTask->execute = fnExecute;
 	pNewTask->pData = pData;
+	pNewTask->priority = priority;
+	pNewTask->scheduledAt = gettickcount();
 	
 	if (!taskqueue_enqueue(&pScheduler->taskQueue, pNewTask))
 		FATAL_ERROR();
 }
+
+uint8 scheduler_takeMaxWait(Scheduler* pScheduler, uint8 priority)
+{
+	uint8 maxWait = pScheduler->maxWait[priority];
+	pScheduler->maxWait[priority] = 0;
+	return maxWait;
+}
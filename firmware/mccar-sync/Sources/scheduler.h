@@ -10,13 +10,59 @@
 
 #include "taskQueue.h"
 
+#define SCHEDULER_MAX_ONE_SHOT_TASKS    TASKQUEUE_LEVEL_SIZE
+#define SCHEDULER_BACKGROUND_TASKS_PER_PASS 2   // one-shot, the control loop waits for no more than these
+
+/**
+ * A task that runs every period ticks (ms, see isr_RTC()), declared in a static table instead of rescheduling itself
+ */
+typedef struct PeriodicTaskSTRUCT
+{
+	void (*execute)(void* pData);
+	void* pData;
+	uint8 priority;                 // TASK_PRIORITY_...
+	uint16 period;                  // 0 = every pass
+	uint16 offset;                  // of the first run after scheduler_init(), spreads tasks with the same period
+	uint16 due;                     // tick of the next run, of the last run with period 0
+} PeriodicTask;
+
+/**
+ * One pass runs the priorities in turn: the periodic tasks that are due in the order of their table,
+ * then the one-shot tasks that were scheduled before the pass started. After every task of a lower priority
+ * the one-shot tasks scheduled meanwhile for a higher one run first, so control work waits for one task
+ * of the link or the background at most. Background work gets SCHEDULER_BACKGROUND_TASKS_PER_PASS of its
+ * one-shot tasks in every pass, however busy the other priorities are, the rest waits for the next pass.
+ * Neither kind of task needs _malloc().
+ */
 typedef struct
 {
-	TaskQueue taskQueue;
+	PeriodicTask* pPeriodicTasks;
+	uint8 periodicTaskCount;
+	uint8 priority;                 // running in this pass
+	uint8 nextPeriodicTask;         // of the priority
+	uint16 passTick;                // when this pass started
+
+	TaskQueue taskQueue;            // one-shot tasks, in slots of oneShotTasks
+	uint8 oneShotTasksLeft[TASK_PRIORITY_COUNT];    // in this pass, those scheduled meanwhile wait for the next one or a preempt()
+	Task oneShotTasks[SCHEDULER_MAX_ONE_SHOT_TASKS];
+	Task* freeOneShotTasks[SCHEDULER_MAX_ONE_SHOT_TASKS];
+	uint8 freeOneShotTaskCount;
+
+	uint8 maxWait[TASK_PRIORITY_COUNT];             // ms, see scheduler_takeMaxWait()
 } Scheduler;
 
-void scheduler_init(Scheduler* pScheduler);
+/**
+ * @param pPeriodicTasks stays in use, the first runs are due offset ticks from now
+ */
+void scheduler_init(Scheduler* pScheduler, PeriodicTask* pPeriodicTasks, uint8 periodicTaskCount);
 void scheduler_execute(Scheduler* pScheduler);
-void scheduler_scheduleTask(Scheduler* pScheduler, void (*fnExecute)(void* pData), void* pData);
+bool scheduler_executeNext(Scheduler* pScheduler); //! @returns FALSE at the end of a pass, instead of running a task
+void scheduler_scheduleTask(Scheduler* pScheduler, void (*fnExecute)(void* pData), void* pData, uint8 priority); //! runs once, in the next pass or after the running task if its priority is higher
+
+/**
+ * @returns the longest a task of the priority waited since the last call, in ms, 255 for longer:
+ * a periodic task from its due tick or, with period 0, from its last run, a one-shot task from being scheduled
+ */
+uint8 scheduler_takeMaxWait(Scheduler* pScheduler, uint8 priority);
 
 #endif /* SCHEDULER_H_ */
@@ -8,23 +8,69 @@
 
 #include "swappableMemory.h"
 #include "hardware.h"
+#include "reliableLink.h"
 
 #define HANDLE_RESPONSE_HEADER_SIZE 2
 
+//--- chunks on the reliable link: cmd, bufferNo and data, the offset follows from the order ---
+#define RELIABLE_WRITE_DATA_CMD         0x14
+#define RELIABLE_HANDLE_RESPONSE_CMD    0x15
+#define RELIABLE_CHUNK_SIZE             (RELIABLE_DATA_SIZE - 2)
+#define RELIABLE_FIRST_CHUNK            0x80    // in the high byte of bufferNo, the host starts the buffer over
+
 void swappableMemoryPool_init(SwappableMemoryPool* pPool, PagePool* pPagePool, callback_writeBuf fnWriteBuf)
 {
 	pPool->fnWriteBuf = fnWriteBuf;
+	pPool->pReliableLink = NULL;
 	pPool->lastPageNo = 0;
 	pPool->pAwaitingSwapIns = NULL;
 	pPool->pPagePool = pPagePool;
 }
 
+void swappableMemoryPool_setReliableLink(SwappableMemoryPool* pPool, ReliableLink* pReliableLink)
+{
+	pPool->pReliableLink = pReliableLink;
+}
+
+static uint16 swapOutReliably(SwappableMemoryPool* pPool, uint8* pData, uint16 size)
+{
+	uint16 pageNo;
+	uint16 i;
+	uint16 now = gettickcount();
+
+	// all or nothing, half a buffer would be overwritten by the next try anyway
+	if (reliableLink_getFreeSlots(pPool->pReliableLink) < (size + RELIABLE_CHUNK_SIZE - 1) / RELIABLE_CHUNK_SIZE)
+		return 0;
+
+	pageNo = ++pPool->lastPageNo;
+	for (i = 0; i < size; i += RELIABLE_CHUNK_SIZE)
+	{
+		uint8 data[1 + RELIABLE_DATA_SIZE] = { 0 };
+		uint16 j;
+
+		data[0] = RELIABLE_WRITE_DATA_CMD;
+		data[1] = (pageNo >> 8) | (i == 0 ? RELIABLE_FIRST_CHUNK : 0);
+		data[2] = (uint8)pageNo;
+		for (j = 0; j < RELIABLE_CHUNK_SIZE && (i + j) < size; ++j)
+		{
+			data[3 + j] = pData[i + j];
+		}
+		reliableLink_send(pPool->pReliableLink, data, sizeof(data), now);
+	}
+
+	return pageNo;
+}
+
 uint16 swappableMemoryPool_swapOut(SwappableMemoryPool* pPool, void* pData, uint16 size)
 {
-	uint16 pageNo = ++pPool->lastPageNo;
+	uint16 pageNo;
 	char* pCharData = pData;
 	uint16 i;
 
+	if (pPool->pReliableLink)
+		return swapOutReliably(pPool, pData, size);
+
+	pageNo = ++pPool->lastPageNo;
 	for (i = 0; i < size;)
 	{
 		uint8 data[SCI_CMD_AND_PAYLOAD_SIZE] = { 0 };
@@ -59,7 +105,11 @@ void swappableMemoryPool_requestSwapIn(SwappableMemoryPool* pPool, uint16 buffer
 	data[1] = bufferNo >> 8;
 	data[2] = (uint8)bufferNo;
 
-	pPool->fnWriteBuf(data, 3);
+	// on the reliable link the request cannot overtake the chunks of the buffer
+	if (!pPool->pReliableLink || !reliableLink_send(pPool->pReliableLink, data, 3, gettickcount()))
+	{
+		pPool->fnWriteBuf(data, 3);
+	}
 
 	pNewSwapInInfo = pagePool_malloc(pPool->pPagePool, sizeof(SwappableMemorySwapIn));
 
@@ -70,7 +120,7 @@ void swappableMemoryPool_requestSwapIn(SwappableMemoryPool* pPool, uint16 buffer
 	pNewSwapInInfo->currentOffset = 0;
 
 	pCurr = pPool->pAwaitingSwapIns;
-	if (pCurr && pCurr->next)
+	while (pCurr && pCurr->next)
 	{
 		pCurr = pCurr->next;
 	}
@@ -107,19 +157,21 @@ void swappableMemoryPool_handleResponse(SwappableMemoryPool* pPool, void* pData)
 	SwappableMemorySwapIn* pPrevCurr = NULL;
 	uint8* pCharData = (uint8*)pData;
 	uint16 bufferNo = ((uint8)pCharData[2]) | pCharData[1] << 8; 
+	uint8 dataEnd = pCharData[0] == RELIABLE_HANDLE_RESPONSE_CMD ? HANDLE_RESPONSE_HEADER_SIZE + 1 + RELIABLE_CHUNK_SIZE : SCI_CMD_AND_PAYLOAD_SIZE;
 
 	pCurr = pPool->pAwaitingSwapIns;
 	while (pCurr)
 	{
 		if (pCurr->bufferNo == bufferNo)
 		{
-			for (i = HANDLE_RESPONSE_HEADER_SIZE + 1; i < SCI_CMD_AND_PAYLOAD_SIZE; ++i)
+			for (i = HANDLE_RESPONSE_HEADER_SIZE + 1; i < dataEnd; ++i)
 			{
 				uint8* pDataTarget = (uint8*)pCurr->target;
 				pDataTarget[pCurr->currentOffset++] = pCharData[i];
 				if (pCurr->currentOffset >= pCurr->targetSize)
 				{
 					finishedReading = TRUE;
+					break;	// the padding of the last chunk does not belong to the target
 				}
 			}
 			if (finishedReading)
@@ -130,7 +182,7 @@ void swappableMemoryPool_handleResponse(SwappableMemoryPool* pPool, void* pData)
 				}
 				else
 				{
-					pPool->pAwaitingSwapIns = NULL;
+					pPool->pAwaitingSwapIns = pCurr->next;
 				}
 				pagePool_free(pPool->pPagePool, pCurr);
 			}
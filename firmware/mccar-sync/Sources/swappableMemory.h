@@ -9,7 +9,7 @@
 #define swappableMemoryPool_H_
 
 #include "platform.h"
-#include "pagePool.h"
+#include "pagepool.h"
 
 typedef void(*callback_writeBuf)(uint8* pBuffer, uint8 bufferSize);
 
@@ -30,6 +30,7 @@ typedef struct SwappableMemoryPoolSTRUCT
 	
 	uint16 lastPageNo; //TODO: register and free pages
 	callback_writeBuf fnWriteBuf;
+	struct ReliableLinkSTRUCT* pReliableLink; // NULL sends everything best effort through fnWriteBuf
 	
 	SwappableMemorySwapIn* pAwaitingSwapIns;
 } SwappableMemoryPool;
@@ -37,7 +38,8 @@ typedef struct SwappableMemoryPoolSTRUCT
 typedef struct PagePoolSTRUCT PagePool;
 
 void swappableMemoryPool_init(SwappableMemoryPool* pPool, PagePool* pPagePool, callback_writeBuf fnWriteBuf);
-uint16 swappableMemoryPool_swapOut(SwappableMemoryPool* pPool, void* pData, uint16 size); //! @returns bufferNo
+void swappableMemoryPool_setReliableLink(SwappableMemoryPool* pPool, struct ReliableLinkSTRUCT* pReliableLink);
+uint16 swappableMemoryPool_swapOut(SwappableMemoryPool* pPool, void* pData, uint16 size); //! @returns bufferNo, 0 if the reliable link has no room for it
 void swappableMemoryPool_requestSwapIn(SwappableMemoryPool* pPool, uint16 bufferNo, void* pData, uint16 size);
 bool swappableMemoryPool_isSwapInPending(SwappableMemoryPool* pPool, uint16 bufferNo);
 void swappableMemoryPool_handleResponse(SwappableMemoryPool* pPool, void* pData);
@@ -51,6 +51,107 @@ void handleMemoryPoolResponse(void* data)
 	_free(pData);
 }
 
+SwappableMemoryPool swappableMemoryPool;
+ReliableLink reliableLink;
+BaudNegotiation baudNegotiation;
+FrameReceiver frameReceiver;
+SuperFrame telemetry;
+
+/**
+ * Executes a command received best effort or delivered by the reliable link
+ * @param command SCI_CMD_AND_PAYLOAD_SIZE + 1 bytes
+ */
+static void handleCommand(uint8* command, SwappableMemoryPool* pSwappableMemoryPool)
+{
+	switch (command[0])
+	{
+    // Null command
+    case 0x00:
+        // No valid command
+        break;
+    // Move
+	case 0x01:
+		{
+			driveval = command[1];
+		}
+		break;
+    // FollowLine
+    case 0x02:
+        // not implemented yet
+        break;
+    // ConfigPID
+    case 0x03:
+    	pid_setCalibrationData(&motorPid[0], command[1], command[2], command[3]);
+    	pid_setCalibrationData(&motorPid[1], command[4], command[5], command[6]);
+        break;
+    // LEDColor
+    case 0x04:
+        ledleftred    = command[1];
+        break;
+    // Colorsensor
+    case 0x05:
+        // not implemented yet
+        break;
+    // Acceleration
+    case 0x06:
+        // not implemented yet
+        break;
+    // Beep
+    case 0x07:
+        // not implemented yet
+        break;
+    // RequestData
+    case 0x08:
+        // not implemented yet
+        break;
+    // WriteData
+    case 0x09:
+        // not implemented yet
+        break;
+    // HandleRequestedData
+	case 0x0A:
+    // ReliableHandleRequestedData, comes in order with 6 instead of 8 bytes
+    case 0x15:
+		{
+			MemoryPoolResponseData* pData = _malloc(sizeof(MemoryPoolResponseData));
+			_memcpy(command, pData->command, SCI_CMD_AND_PAYLOAD_SIZE + 1);
+			pData->pSwappableMemoryPool = pSwappableMemoryPool;
+			scheduler_scheduleTask(&scheduler, handleMemoryPoolResponse, pData, TASK_PRIORITY_BACKGROUND);
+		}
+		break;
+    // Status
+    case 0x0B:
+        // not implemented yet
+        break;
+    // Display
+    case 0x0C:
+        // not implemented yet
+        break;
+    // Reliable, Ack
+    case 0x12:
+    case 0x13:
+        reliableLink_receive(&reliableLink, command, gettickcount());
+        break;
+    // BaudPropose, BaudProbe, BaudCommit
+    case 0x16:
+    case 0x18:
+    case 0x19:
+        baudNegotiation_handleCommand(&baudNegotiation, command, gettickcount());
+        break;
+    // FramingPropose
+    case 0x1A:
+        framing_handleCommand(&frameReceiver, command);
+        break;
+	default:
+		break;
+	}
+}
+
+void handleReliableCommand(uint8* pCommand)
+{
+	handleCommand(pCommand, &swappableMemoryPool);
+}
+
 /**
  * Task to handle received commands
  */
@@ -58,75 +159,21 @@ void handleSciReceive(SwappableMemoryPool* pSwappableMemoryPool)
 {
 	uint8 maxCommandsToProcessAtATime = 5;
 	uint8 command[SCI_CMD_AND_PAYLOAD_SIZE + 1];
-	while (queue_getUsedSpace(&bt_receiveQueue) >= sizeof(command))
+
+	// a rate that does not work garbles the frames as well, that says nothing about the framing
+	if (baudNegotiation.isCommitPending)
 	{
-		if (!queue_dequeue(&bt_receiveQueue, command, sizeof(command)))
-			FATAL_ERROR();
+		frameReceiver.decodeErrors = 0;
+	}
 
-		switch (command[0])
+	// a frame may release a window of the reliable lane, each may take a one-shot task
+	while (scheduler.freeOneShotTaskCount >= RELIABLE_WINDOW_SIZE
+		&& framing_nextFrame(&frameReceiver, &bt_receiveQueue, command))
+	{
+		// a corrupt command is dropped, the host repeats what has to arrive on the reliable lane
+		if (crc8(command + 1, SCI_CMD_AND_PAYLOAD_SIZE - 1) == command[SCI_CMD_AND_PAYLOAD_SIZE])
 		{
-        // Null command
-        case 0x00:
-            // No valid command
-            break;
-        // Move
-		case 0x01:
-			{
-				driveval = command[1];
-			}
-			break;
-        // FollowLine
-        case 0x02:
-            // not implemented yet
-            break;
-        // ConfigPID
-        case 0x03:
-        	pid_setCalibrationData(&motorPid[0], command[1], command[2], command[3]);
-        	pid_setCalibrationData(&motorPid[1], command[4], command[5], command[6]);
-            break;
-        // LEDColor
-        case 0x04:
-            ledleftred    = command[1];
-            break;
-        // Colorsensor
-        case 0x05:
-            // not implemented yet
-            break;
-        // Acceleration
-        case 0x06:
-            // not implemented yet
-            break;
-        // Beep
-        case 0x07:
-            // not implemented yet
-            break;
-        // RequestData
-        case 0x08:
-            // not implemented yet
-            break;
-        // WriteData
-        case 0x09:
-            // not implemented yet
-            break;
-        // HandleRequestedData
-		case 0x0A:
-			{
-				MemoryPoolResponseData* pData = _malloc(sizeof(MemoryPoolResponseData));
-				_memcpy(pData->command, command, SCI_CMD_AND_PAYLOAD_SIZE + 1);
-				pData->pSwappableMemoryPool = pSwappableMemoryPool;
-				scheduler_scheduleTask(&scheduler, handleMemoryPoolResponse, pData);
-			}
-			break;
-        // Status
-        case 0x0B:
-            // not implemented yet
-            break;
-        // Display
-        case 0x0C:
-            // not implemented yet
-            break;
-		default:
-			break;
+			handleCommand(command, pSwappableMemoryPool);
 		}
 
 		if (--maxCommandsToProcessAtATime == 0)
@@ -134,8 +181,6 @@ void handleSciReceive(SwappableMemoryPool* pSwappableMemoryPool)
 	}
 }
 
-SwappableMemoryPool swappableMemoryPool;
-
 /**
  * Task to read the ir sensor to detect obstacles in front of the mccar
  */
@@ -165,8 +210,6 @@ void taskIrSensor(void* unused)
     {
         myirtimer = 0;
     }
-
-    scheduler_scheduleTask(&scheduler, taskIrSensor, NULL);
 }
 
 /**
@@ -278,8 +321,6 @@ void taskControlMotors(void* unused)
     	}
     }
     olddriveval = driveval;
-
-    scheduler_scheduleTask(&scheduler, taskControlMotors, NULL);
 }
 
 /**
@@ -289,8 +330,8 @@ void taskSciReceive(void* unused)
 {
     (void)unused;
 	handleSciReceive(&swappableMemoryPool);
-
-    scheduler_scheduleTask(&scheduler, taskSciReceive, NULL);
+	reliableLink_poll(&reliableLink, gettickcount());
+	baudNegotiation_poll(&baudNegotiation, gettickcount());
 }
 
 /**
@@ -298,24 +339,28 @@ void taskSciReceive(void* unused)
  */
 void taskSendStatus(void* unused)
 {
-	static counter = 500;
+	uint8 cmd[10];
     (void)unused;
-	if ((++counter % 1000) == 0)
-	{
-		uint8 cmd[10];
-		cmd[0] = 0x0b;
-		cmd[1] = (uint8) (voltage >> 8);
-		cmd[2] = (uint8) (voltage);
-		cmd[3] = (uint8) (current >> 8);
-		cmd[4] = (uint8) (current);
-		cmd[5] = (uint8) (charge_status >> 8);
-		cmd[6] = (uint8) (charge_status);
-		cmd[7] = linepos;
-		cmd[8] = (uint8) (linewidth >> 8);
-		cmd[9] = (uint8) (linewidth);
-		bt_enqueue_crc(cmd, sizeof(cmd));
-	}
-	scheduler_scheduleTask(&scheduler, taskSendStatus, NULL);
+	cmd[0] = 0x0b;
+	cmd[1] = (uint8) (voltage >> 8);
+	cmd[2] = (uint8) (voltage);
+	cmd[3] = (uint8) (current >> 8);
+	cmd[4] = (uint8) (current);
+	cmd[5] = (uint8) (charge_status >> 8);
+	cmd[6] = (uint8) (charge_status);
+	cmd[7] = linepos;
+	cmd[8] = (uint8) (linewidth >> 8);
+	cmd[9] = (uint8) (linewidth);
+	framing_addToSuperFrame(&telemetry, cmd, sizeof(cmd));
+}
+
+/**
+ * @returns the one-shot tasks waiting in the priority, up to 15 to fit a nibble
+ */
+static uint8 queuedTasks(uint8 priority)
+{
+	uint8 count = taskqueue_getLevelUsedSpace(&scheduler.taskQueue, priority);
+	return count > 15 ? 15 : count;
 }
 
 /**
@@ -323,35 +368,42 @@ void taskSendStatus(void* unused)
  */
 void taskSendRessource(void* unused)
 {
-	static counter = 0;
 	uint8 i;
 	uint8 usedPages = 0;
 	uint8 freePages;
 	PagePool* pool;
+	uint8 cmd[11];
     (void)unused;
-	if ((++counter % 1000) == 0)
+	cmd[0] = 0x0d;
+	cmd[1] = taskqueue_getUsedSpace(&scheduler.taskQueue);
+	pool = malloc_getPagePool();
+	for (i = 0; i < PAGE_POOL_SIZE; ++i)
 	{
-		uint8 cmd[7];
-		cmd[0] = 0x0d;
-		cmd[1] = taskqueue_getUsedSpace(&scheduler.taskQueue);
-		pool = malloc_getPagePool();
-		for (i = 0; i < PAGE_POOL_SIZE; ++i)
-		{
-			usedPages += pool->amountOfOccupiedPagesAhead[i];
-		}
-		freePages = PAGE_POOL_SIZE - usedPages;
-		cmd[2] = usedPages;
-		cmd[3] = freePages;
-		cmd[4] = PAGE_SIZE;
-		cmd[5] = queue_getUsedSpace(&bt_receiveQueue);
-		cmd[6] = queue_getFreeSpace(&bt_receiveQueue);
-		bt_enqueue_crc(cmd, sizeof(cmd));
-
-		//test: sending up memory pool
-	    //bufferNo = swappableMemoryPool_swapOut(&swappableMemoryPool, pool->pages, sizeof(Page) * PAGE_POOL_SIZE);
+		usedPages += pool->amountOfOccupiedPagesAhead[i];
 	}
+	freePages = PAGE_POOL_SIZE - usedPages;
+	cmd[2] = usedPages;
+	cmd[3] = freePages;
+	cmd[4] = PAGE_SIZE;
+	cmd[5] = queue_getUsedSpace(&bt_receiveQueue);
+	cmd[6] = queue_getFreeSpace(&bt_receiveQueue);
+	cmd[7] = scheduler_takeMaxWait(&scheduler, TASK_PRIORITY_CONTROL);
+	cmd[8] = scheduler_takeMaxWait(&scheduler, TASK_PRIORITY_COMMUNICATION);
+	cmd[9] = scheduler_takeMaxWait(&scheduler, TASK_PRIORITY_BACKGROUND);
+	cmd[10] = (uint8)(queuedTasks(TASK_PRIORITY_COMMUNICATION) << 4 | queuedTasks(TASK_PRIORITY_BACKGROUND));   // control: the rest of cmd[1]
+	framing_addToSuperFrame(&telemetry, cmd, sizeof(cmd));
+
+	//test: sending up memory pool
+    //bufferNo = swappableMemoryPool_swapOut(&swappableMemoryPool, pool->pages, sizeof(Page) * PAGE_POOL_SIZE);
+}
 
-    scheduler_scheduleTask(&scheduler, taskSendRessource, NULL);
+/**
+ * Task to send the telemetry the other tasks collected during this pass
+ */
+void taskSendTelemetry(void* unused)
+{
+    (void)unused;
+	framing_flushSuperFrame(&telemetry);
 }
 
 /**
@@ -359,25 +411,36 @@ void taskSendRessource(void* unused)
  */
 void taskCalcLine(void* unused)
 {
-	static counter = 250;
 	uint16 linesensorcorr[8];
 	uint8 i;
 	uint16 max = 0;
     (void)unused;
-	if ((++counter % 1000) == 0)
+	// invert results for detecting a black line, not needed for a white line
+	for (i = 0; i < 8; i++)
 	{
-		// invert results for detecting a black line, not needed for a white line
-		for (i = 0; i < 8; i++)
-		{
-			max = linesensor[i] > max ? linesensor[i] : max;
-		}
-		for (i = 0; i < 8; i++)
-		{
-			linesensorcorr[i] = max - linesensor[i];
-		}
-		// Calculate Position
-		linepos = expv(linesensorcorr, 8);
-		linewidth = var2(linesensorcorr, 8, linepos);
+		max = linesensor[i] > max ? linesensor[i] : max;
+	}
+	for (i = 0; i < 8; i++)
+	{
+		linesensorcorr[i] = max - linesensor[i];
 	}
-	scheduler_scheduleTask(&scheduler, taskCalcLine, NULL);
+	// Calculate Position
+	linepos = expv(linesensorcorr, 8);
+	linewidth = var2(linesensorcorr, 8, linepos);
 }
+
+/**
+ * In the order they run within a priority: Status and Resource are collected before taskSendTelemetry() sends
+ * them in one super-frame, taskCalcLine() runs half a period earlier so the two do not share a pass.
+ */
+PeriodicTask periodicTasks[PERIODIC_TASK_COUNT] =
+{
+	// execute            pData   priority                        period              offset                  due (scheduler_init())
+	//{ taskIrSensor,     NULL,   TASK_PRIORITY_CONTROL,          0,                  0,                      0 },
+	{ taskControlMotors,  NULL,   TASK_PRIORITY_CONTROL,          0,                  0,                      0 },
+	{ taskSciReceive,     NULL,   TASK_PRIORITY_COMMUNICATION,    0,                  0,                      0 },
+	{ taskCalcLine,       NULL,   TASK_PRIORITY_BACKGROUND,       TELEMETRY_PERIOD,   0,                      0 },
+	{ taskSendRessource,  NULL,   TASK_PRIORITY_COMMUNICATION,    TELEMETRY_PERIOD,   TELEMETRY_PERIOD / 2,   0 },
+	{ taskSendStatus,     NULL,   TASK_PRIORITY_COMMUNICATION,    TELEMETRY_PERIOD,   TELEMETRY_PERIOD / 2,   0 },
+	{ taskSendTelemetry,  NULL,   TASK_PRIORITY_COMMUNICATION,    TELEMETRY_PERIOD,   TELEMETRY_PERIOD / 2,   0 }
+};
@@ -16,6 +16,12 @@
 #include "scheduler.h"
 #include "i2c.h"
 #include "encoder.h"
+#include "reliableLink.h"
+#include "baudNegotiation.h"
+#include "framing.h"
+
+#define TELEMETRY_PERIOD        250     // ms between two Status and Resource frames
+#define PERIODIC_TASK_COUNT     6
 
 typedef struct
 {
@@ -23,13 +29,17 @@ typedef struct
 	SwappableMemoryPool* pSwappableMemoryPool;
 } MemoryPoolResponseData;
 
+extern PeriodicTask periodicTasks[PERIODIC_TASK_COUNT];     // for scheduler_init()
+
 void handleMemoryPoolResponse(void* data);
+void handleReliableCommand(uint8* pCommand);
 void handleSciReceive(SwappableMemoryPool* pSwappableMemoryPool);
 void taskIrSensor(void* unused);
 void taskControlMotors(void* unused);
 void taskSciReceive(void* unused);
 void taskSendStatus(void* unused);
 void taskSendRessource(void* unused);
+void taskSendTelemetry(void* unused);
 void taskCalcLine(void* unused);
 
 #endif /* TASK_H_ */
@@ -12,44 +12,49 @@
 
 void taskqueue_init(TaskQueue* pQueue)
 {
-	(void)_memset(pQueue->buffer, 0, 256);
+	(void)_memset(pQueue, 0, sizeof(TaskQueue));
 }
 
 bool taskqueue_enqueue(TaskQueue* pQueue, Task* pTask)
 {
-	if (taskqueue_getFreeSpace(pQueue) >= 1)
-	{
-		pQueue->buffer[pQueue->writePos] = pTask;
-		++pQueue->writePos;
+	TaskQueueLevel* pLevel = &pQueue->levels[pTask->priority];
 
-		return TRUE;
-	}
-	return FALSE;
+	if (taskqueue_getLevelUsedSpace(pQueue, pTask->priority) >= TASKQUEUE_LEVEL_SIZE)
+		return FALSE;
+
+	pLevel->buffer[pLevel->writePos & (TASKQUEUE_LEVEL_SIZE - 1)] = pTask;
+	++pLevel->writePos;
+	return TRUE;
 }
 
-Task* taskqueue_dequeue(TaskQueue* pQueue)
+Task* taskqueue_dequeue(TaskQueue* pQueue, uint8 priority)
 {
-	if (taskqueue_getUsedSpace(pQueue) >= 1)
-	{
-		Task* pTask = pQueue->buffer[pQueue->readPos];
-		++pQueue->readPos;
-		return pTask;
-	}
-	return NULL;
+	TaskQueueLevel* pLevel = &pQueue->levels[priority];
+	Task* pTask;
+
+	if (pLevel->readPos == pLevel->writePos)
+		return NULL;
+
+	pTask = pLevel->buffer[pLevel->readPos & (TASKQUEUE_LEVEL_SIZE - 1)];
+	++pLevel->readPos;
+	return pTask;
 }
 
-uint8 taskqueue_getFreeSpace(TaskQueue* pQueue)
+uint8 taskqueue_getUsedSpace(TaskQueue* pQueue)
 {
-	uint8 spaceInBuffer = (uint8)(pQueue->readPos - pQueue->writePos);
-	if (spaceInBuffer == 0)
-		return -1; //max uint8
-	else
-		return spaceInBuffer;
+	uint8 usedSpace = 0;
+	uint8 priority;
+
+	for (priority = 0; priority < TASK_PRIORITY_COUNT; ++priority)
+	{
+		usedSpace += taskqueue_getLevelUsedSpace(pQueue, priority);
+	}
+	return usedSpace;
 }
 
-uint8 taskqueue_getUsedSpace(TaskQueue* pQueue)
+uint8 taskqueue_getLevelUsedSpace(TaskQueue* pQueue, uint8 priority)
 {
-	uint8 usedSpace = (uint8)(pQueue->writePos - pQueue->readPos);
+	uint8 usedSpace = (uint8)(pQueue->levels[priority].writePos - pQueue->levels[priority].readPos);
 	return usedSpace;
 }
 
@@ -10,25 +10,42 @@
 
 #include "platform.h"
 
+#define TASK_PRIORITY_CONTROL           0       // the motors
+#define TASK_PRIORITY_COMMUNICATION     1       // the link and the telemetry
+#define TASK_PRIORITY_BACKGROUND        2       // swap work and whatever else may wait
+#define TASK_PRIORITY_COUNT             3
+
+#define TASKQUEUE_LEVEL_SIZE            16      // a power of 2, as many as the scheduler has one-shot slots
+
 typedef struct
 {
 	void (*execute)(void* pData);
 	void* pData;
+	uint8 priority;                 // TASK_PRIORITY_...
+	uint16 scheduledAt;             // tick
 } Task;
 
-typedef struct
+typedef struct TaskQueueLevelSTRUCT
 {
-	Task* buffer[256];
-	uint8 readPos;
+	Task* buffer[TASKQUEUE_LEVEL_SIZE];
+	uint8 readPos;                  // both count on, they are masked when the buffer is accessed
 	uint8 writePos;
+} TaskQueueLevel;
+
+/**
+ * A FIFO per priority
+ */
+typedef struct
+{
+	TaskQueueLevel levels[TASK_PRIORITY_COUNT];
 } TaskQueue;
 
 void taskqueue_init(TaskQueue* pQueue);
 
-uint8 taskqueue_getFreeSpace(TaskQueue* pQueue);
-uint8 taskqueue_getUsedSpace(TaskQueue* pQueue);
+uint8 taskqueue_getUsedSpace(TaskQueue* pQueue);                          // of all priorities
+uint8 taskqueue_getLevelUsedSpace(TaskQueue* pQueue, uint8 priority);
 
-bool taskqueue_enqueue(TaskQueue* pQueue, Task* pTask);
-Task* taskqueue_dequeue(TaskQueue* pQueue);
+bool taskqueue_enqueue(TaskQueue* pQueue, Task* pTask);                     // behind the tasks of pTask->priority
+Task* taskqueue_dequeue(TaskQueue* pQueue, uint8 priority);
 
 #endif /* TASKQUEUE_H_ */
@@ -17,6 +17,20 @@ void _memset(void* pData, uint8 value, int num);
 
 void _memcpy(void* pSrc, void* pTarget, int num);
 
+/**
+ * CRC-8 of the link to the host: polynomial 0x9B, init 0, no reflection, no final xor
+ */
+uint8 crc8(uint8* pData, uint8 size);
+
+extern const uint8 crc8Table[256];
+
+/**
+ * adds a byte to a running crc8(), for checksums computed while the bytes are copied
+ */
+#define CRC8_UPDATE(crc, data)      (crc8Table[(uint8)((crc) ^ (data))])
+
+#ifndef FATAL_ERROR //the host build reports and aborts instead
 #define FATAL_ERROR() do { } while (1)
+#endif
 
 #endif /* UTIL_H_ */